@@ -0,0 +1,275 @@
+#include "AdminLive.h"
+
+#define LIVE_SLOW_CLIENT_MS 1           // Sende-Timeout (s) – ein hängender Browser soll den Loop nicht blockieren
+
+void AdminLive::begin() {
+    if (_running) return;
+    _server.begin();
+    _server.setNoDelay(true);
+    _running = true;
+    _tokens = LIVE_BURST_BYTES;
+    _lastDiff = _lastWrite = millis();
+    Serial.printf("[WEB] Live-Ansicht auf Port %u%s\n", LIVE_PORT, LIVE_PATH);
+}
+
+void AdminLive::stop() {
+    if (!_running) return;
+    for (WiFiClient& c : _clients) c.stop();
+    for (Pending& p : _pending) p.client.stop();
+    _server.end();
+    _running = false;
+    // Nächster Client bekommt ohnehin einen Snapshot, alte Sendestände sind bedeutungslos
+    for (Metric& m : _metrics) m.everSent = false;
+    for (Node& n : _nodes) n.sent = false;
+    Serial.println("[WEB] Live-Ansicht beendet");
+}
+
+void AdminLive::setMetric(const char* key, int32_t value, int32_t deadband) {
+    Metric* free = nullptr;
+    for (Metric& m : _metrics) {
+        if (m.key == key || (m.key && strcmp(m.key, key) == 0)) {
+            m.value = value;
+            m.deadband = deadband;
+            return;
+        }
+        if (!m.key && !free) free = &m;
+    }
+    if (!free) return;
+    free->key = key;
+    free->value = value;
+    free->deadband = deadband;
+    free->everSent = false;
+}
+
+void AdminLive::beginNodes() {
+    for (Node& n : _nodes) n.seen = false;
+}
+
+void AdminLive::node(uint32_t id, int8_t rssi) {
+    Node* free = nullptr;
+    for (Node& n : _nodes) {
+        if (n.id == id) {
+            n.rssi = rssi;
+            n.seen = true;
+            return;
+        }
+        if (!n.id && !free) free = &n;
+    }
+    if (!free) return;
+    free->id = id;
+    free->rssi = rssi;
+    free->seen = true;
+    free->sent = false;
+}
+
+uint8_t AdminLive::clients() const {
+    uint8_t count = 0;
+    for (WiFiClient& c : _clients) {
+        if (c.connected()) count++;
+    }
+    return count;
+}
+
+bool AdminLive::changed(int32_t a, int32_t b, int32_t deadband) {
+    int32_t d = a > b ? a - b : b - a;
+    return d > deadband;
+}
+
+void AdminLive::accept(uint32_t now) {
+    // 1. Neue Verbindungen nur annehmen; gelesen wird erst, wenn Daten vorliegen
+    while (_server.hasClient()) {
+        Pending* free = nullptr;
+        for (Pending& p : _pending) {
+            if (!p.client) {
+                free = &p;
+                break;
+            }
+        }
+        WiFiClient client = _server.available();
+        if (!free) {
+            client.print("HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+            client.stop();
+            continue;
+        }
+        client.setTimeout(LIVE_SLOW_CLIENT_MS);
+        *free = Pending();
+        free->client = client;
+        free->deadline = now + LIVE_REQUEST_TIMEOUT_MS;
+    }
+
+    // 2. Angefangene Anfragen fortsetzen
+    for (Pending& p : _pending) {
+        if (!p.client) continue;
+        if (readRequest(p)) {
+            answer(p.client, p.line);
+            p.client = WiFiClient();
+        } else if (!p.client.connected() || (int32_t)(now - p.deadline) >= 0) {
+            _timeouts++;
+            p.client.stop();
+            p.client = WiFiClient();
+        }
+    }
+}
+
+bool AdminLive::readRequest(Pending& p) {
+    // Nur was schon im Empfangspuffer liegt, ohne zu warten
+    int avail = p.client.available();
+    while (avail-- > 0) {
+        int c = p.client.read();
+        if (c < 0) break;
+        if (c == '\r') continue;
+        if (c == '\n') {
+            p.lineDone = true;
+            if (++p.newlines == 2) return true;
+            continue;
+        }
+        p.newlines = 0;
+        if (!p.lineDone && p.len < sizeof(p.line) - 1) {
+            p.line[p.len++] = (char)c;
+            p.line[p.len] = '\0';
+        }
+    }
+    return false;
+}
+
+void AdminLive::answer(WiFiClient& client, const char* request) {
+    if (strncmp(request, "GET " LIVE_PATH, strlen("GET " LIVE_PATH)) != 0) {
+        client.print("HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+        client.stop();
+        return;
+    }
+
+    WiFiClient* slot = nullptr;
+    for (WiFiClient& c : _clients) {
+        if (!c.connected()) {
+            c.stop();
+            slot = &c;
+            break;
+        }
+    }
+    if (!slot) {
+        client.print("HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+        client.stop();
+        return;
+    }
+
+    // Admin-Seite kommt von Port 80, daher CORS für die EventSource
+    String snap = snapshot();
+    String out = "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\n"
+                 "Access-Control-Allow-Origin: *\r\nConnection: keep-alive\r\n\r\nretry: 3000\n\nevent: snap\ndata: ";
+    out += snap;
+    out += "\n\n";
+    if (client.print(out) != out.length()) {
+        client.stop();
+        return;
+    }
+    _bytes += out.length();
+    *slot = client;
+    Serial.printf("[WEB] Live-Client %s verbunden (%u aktiv)\n", client.remoteIP().toString().c_str(), clients());
+}
+
+String AdminLive::snapshot() const {
+    // Stand, gegen den die folgenden Diffs gerechnet werden (= zuletzt gesendete Werte)
+    String out = "{";
+    bool first = true;
+    for (const Metric& m : _metrics) {
+        if (!m.key || !m.everSent) continue;
+        if (!first) out += ',';
+        out += "\"" + String(m.key) + "\":" + String(m.sent);
+        first = false;
+    }
+    String nodes;
+    for (const Node& n : _nodes) {
+        if (!n.id || !n.sent) continue;
+        if (nodes.length()) nodes += ',';
+        nodes += "\"" + String(n.id) + "\":" + String(n.sentRssi);
+    }
+    if (nodes.length()) out += String(first ? "" : ",") + "\"n\":{" + nodes + "}";
+    out += "}";
+    return out;
+}
+
+String AdminLive::buildDiff(bool commit) {
+    String out;
+    for (Metric& m : _metrics) {
+        if (!m.key || (m.everSent && !changed(m.value, m.sent, m.deadband))) continue;
+        out += out.length() ? "," : "";
+        out += "\"" + String(m.key) + "\":" + String(m.value);
+        if (commit) {
+            m.sent = m.value;
+            m.everSent = true;
+        }
+    }
+
+    String added, removed;
+    for (Node& n : _nodes) {
+        if (!n.id) continue;
+        if (!n.seen) {
+            if (n.sent) {
+                if (removed.length()) removed += ',';
+                removed += String(n.id);
+            }
+            if (commit || !n.sent) n = Node();
+            continue;
+        }
+        if (n.sent && !changed(n.rssi, n.sentRssi, LIVE_RSSI_DEADBAND)) continue;
+        if (added.length()) added += ',';
+        added += "\"" + String(n.id) + "\":" + String(n.rssi);
+        if (commit) {
+            n.sentRssi = n.rssi;
+            n.sent = true;
+        }
+    }
+    if (added.length()) out += String(out.length() ? "," : "") + "\"n\":{" + added + "}";
+    if (removed.length()) out += String(out.length() ? "," : "") + "\"x\":[" + removed + "]";
+    return out.length() ? "{" + out + "}" : out;
+}
+
+void AdminLive::broadcast(const char* event, const String& data, uint32_t now) {
+    String out = event ? "event: " + String(event) + "\ndata: " + data + "\n\n" : data;
+    for (WiFiClient& c : _clients) {
+        if (!c.connected()) continue;
+        if (c.print(out) != out.length()) {
+            // Puffer voll oder Verbindung weg: Client abwerfen, EventSource verbindet sich neu
+            c.stop();
+            continue;
+        }
+        _bytes += out.length();
+    }
+    _lastWrite = now;
+}
+
+void AdminLive::loop(uint32_t now) {
+    if (!_running) return;
+    accept(now);
+
+    uint32_t elapsed = min(now - _lastDiff, (uint32_t)10000);
+    if (elapsed < LIVE_MIN_GAP_MS) return;
+
+    if (!clients()) {
+        // Niemand schaut zu: Sendestand trotzdem fortschreiben, damit der Snapshot aktuell ist
+        buildDiff(true);
+        _lastDiff = now;
+        return;
+    }
+
+    _tokens = min((int32_t)LIVE_BURST_BYTES, _tokens + (int32_t)(elapsed * LIVE_BYTES_PER_S / 1000));
+    _lastDiff = now;
+    String diff = buildDiff(false);
+    if (diff.length() && _tokens > 0) {
+        diff = buildDiff(true);
+        broadcast("diff", diff, now);
+        _tokens -= diff.length();
+        _diffs++;
+    } else if (diff.length()) {
+        _deferred++;
+    } else if (now - _lastWrite >= LIVE_KEEPALIVE_MS) {
+        broadcast(nullptr, ": ka\n\n", now);
+    }
+}
+
+String AdminLive::statusText() const {
+    if (!_running) return "Live-Ansicht aus";
+    return String(clients()) + " Clients, " + String(_diffs) + " Diffs, " + String(_deferred) + " verschoben, "
+         + String(_bytes / 1024) + " KB gesendet, " + String(_timeouts) + " Anfragen abgelaufen";
+}
@@ -0,0 +1,106 @@
+#ifndef ADMIN_LIVE_H
+#define ADMIN_LIVE_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+
+// =====================
+// LIVE-ANSICHT (SSE)
+// =====================
+
+#define LIVE_PORT 81
+#define LIVE_PATH "/events"
+#define LIVE_MAX_CLIENTS 3
+#define LIVE_MAX_METRICS 12
+#define LIVE_MAX_NODES 48
+#define LIVE_MIN_GAP_MS 1000            // Höchstens ein Diff pro Sekunde
+#define LIVE_BYTES_PER_S 512            // Byte-Budget für Diffs (alle Clients bekommen denselben Strom)
+#define LIVE_BURST_BYTES 1024
+#define LIVE_RSSI_DEADBAND 3            // dBm; kleineres Rauschen erzeugt keinen Diff
+#define LIVE_KEEPALIVE_MS 15000         // Kommentarzeile, damit Proxies/Browser die Verbindung halten
+#define LIVE_MAX_PENDING 2              // Verbindungen, deren Anfrage noch nicht vollständig ist
+#define LIVE_REQUEST_TIMEOUT_MS 2000    // So lange darf ein Client für Anfragezeile und Header brauchen
+#define LIVE_REQUEST_LINE_LEN 48        // Mehr als "GET /events HTTP/1.1" wird nicht gebraucht
+
+/**
+ * Server-Sent Events für die Admin-Seite auf einem eigenen Port.
+ *
+ * Der synchrone WebServer kann keine Verbindung offen halten, daher nimmt ein
+ * WiFiServer die EventSource-Verbindungen an. Ein neuer Client bekommt einmal
+ * den ganzen Stand ("snap"), danach nur noch Änderungen ("diff"): Metriken,
+ * die sich um mehr als ihr Totband geändert haben, neue bzw. geänderte Knoten
+ * ("n": {id: rssi}) und verschwundene Knoten ("x": [id]). Diffs sind auf
+ * LIVE_MIN_GAP_MS und ein Byte-Budget begrenzt; was nicht gesendet wurde, geht
+ * im nächsten Diff mit.
+ *
+ * Anfragen werden nicht blockierend gelesen: jede neue Verbindung bekommt einen
+ * Platz in _pending, loop() sammelt pro Aufruf die vorliegenden Bytes ein, bis
+ * die Header vollständig sind oder LIVE_REQUEST_TIMEOUT_MS abgelaufen ist.
+ */
+class AdminLive {
+public:
+    void begin();
+    void stop();
+    bool running() const { return _running; }
+
+    // key muss ein String-Literal sein; Änderungen kleiner als deadband werden nicht gemeldet
+    void setMetric(const char* key, int32_t value, int32_t deadband = 0);
+    // Knotenliste pro Durchlauf: beginNodes(), node() für jeden Knoten (rssi 0 = unbekannt)
+    void beginNodes();
+    void node(uint32_t id, int8_t rssi);
+
+    void loop(uint32_t now);
+
+    uint8_t clients() const;
+    String statusText() const;
+
+private:
+    struct Metric {
+        const char* key = nullptr;
+        int32_t value = 0;
+        int32_t sent = 0;
+        int32_t deadband = 0;
+        bool everSent = false;
+    };
+
+    struct Node {
+        uint32_t id = 0;
+        int8_t rssi = 0;
+        int8_t sentRssi = 0;
+        bool seen = false;
+        bool sent = false;
+    };
+
+    struct Pending {
+        WiFiClient client;
+        char line[LIVE_REQUEST_LINE_LEN] = "";  // Anfragezeile (gekürzt)
+        uint8_t len = 0;
+        bool lineDone = false;
+        uint8_t newlines = 0;                   // aufeinanderfolgende Zeilenenden, 2 = Header zu Ende
+        uint32_t deadline = 0;
+    };
+
+    WiFiServer _server{LIVE_PORT};
+    mutable WiFiClient _clients[LIVE_MAX_CLIENTS];  // connected() ist in WiFiClient nicht const
+    bool _running = false;
+    Metric _metrics[LIVE_MAX_METRICS];
+    Node _nodes[LIVE_MAX_NODES];
+    Pending _pending[LIVE_MAX_PENDING];
+    int32_t _tokens = LIVE_BURST_BYTES;
+    uint32_t _lastDiff = 0;
+    uint32_t _lastWrite = 0;
+    uint32_t _bytes = 0;
+    uint32_t _diffs = 0;
+    uint32_t _deferred = 0;         // Diffs, die das Budget verschoben hat
+    uint32_t _timeouts = 0;         // Anfragen, die nicht rechtzeitig vollständig waren
+
+    void accept(uint32_t now);
+    bool readRequest(Pending& p);
+    void answer(WiFiClient& client, const char* request);
+    String snapshot() const;
+    String buildDiff(bool commit);
+    void broadcast(const char* event, const String& data, uint32_t now);
+    static bool changed(int32_t a, int32_t b, int32_t deadband);
+};
+
+#endif
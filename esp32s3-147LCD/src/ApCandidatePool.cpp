@@ -0,0 +1,160 @@
+#include "ApCandidatePool.h"
+#include <WiFi.h>
+
+int ApCandidatePool::findSlot(uint32_t hash, const char* ssid) const {
+    for (uint8_t pos = hash & (AP_INDEX_SIZE - 1); _index[pos]; pos = (pos + 1) & (AP_INDEX_SIZE - 1)) {
+        const Candidate& c = _slots[_index[pos] - 1];
+        if (c.hash == hash && strcmp(c.ssid, ssid) == 0) return _index[pos] - 1;
+    }
+    return -1;
+}
+
+void ApCandidatePool::rebuildIndex() {
+    // Höchstens REG_MAX_CANDIDATES Einträge: neu aufbauen ist billiger als Löschmarken
+    memset(_index, 0, sizeof(_index));
+    for (uint8_t i = 0; i < _count; i++) {
+        uint8_t pos = _slots[i].hash & (AP_INDEX_SIZE - 1);
+        while (_index[pos]) pos = (pos + 1) & (AP_INDEX_SIZE - 1);
+        _index[pos] = i + 1;
+    }
+}
+
+const ApCandidatePool::Candidate* ApCandidatePool::find(const char* ssid) const {
+    int i = findSlot(NetworkRegistry::hash(ssid), ssid);
+    return i < 0 ? nullptr : &_slots[i];
+}
+
+const ApCandidatePool::Candidate* ApCandidatePool::findHash(uint32_t hash) const {
+    // Im Survey steht nur der SSID-Hash; bei höchstens 16 Kandidaten sind Kollisionen vernachlässigbar
+    for (uint8_t pos = hash & (AP_INDEX_SIZE - 1); _index[pos]; pos = (pos + 1) & (AP_INDEX_SIZE - 1)) {
+        if (_slots[_index[pos] - 1].hash == hash) return &_slots[_index[pos] - 1];
+    }
+    return nullptr;
+}
+
+uint8_t ApCandidatePool::sync(const NetworkRegistry& registry) {
+    uint16_t best[REG_MAX_CANDIDATES];
+    uint8_t n = registry.candidates(best, REG_MAX_CANDIDATES);
+    uint8_t changes = 0;
+
+    // 1. Entfernen, was nicht mehr zu den Kandidaten gehört (Slot mit dem letzten füllen)
+    bool keep[REG_MAX_CANDIDATES] = {};
+    for (uint8_t k = 0; k < n; k++) {
+        const NetEntry& e = registry.at(best[k]);
+        int i = findSlot(e.hash, e.ssid);
+        if (i >= 0) keep[i] = true;
+    }
+    for (int i = _count - 1; i >= 0; i--) {
+        if (keep[i]) continue;
+        _slots[i] = _slots[--_count];
+        keep[i] = keep[_count];
+        _removes++;
+        changes++;
+    }
+    if (changes) rebuildIndex();
+
+    // 2. Neue Netze anhängen, geänderte Passwörter/Prioritäten übernehmen
+    for (uint8_t k = 0; k < n; k++) {
+        const NetEntry& e = registry.at(best[k]);
+        int i = findSlot(e.hash, e.ssid);
+        if (i >= 0) {
+            Candidate& c = _slots[i];
+            if (c.prio == e.prio && strcmp(c.pass, e.pass) == 0) continue;
+            c.prio = e.prio;
+            strlcpy(c.pass, e.pass, sizeof(c.pass));
+            _updates++;
+            changes++;
+            continue;
+        }
+        Candidate& c = _slots[_count];
+        c.hash = e.hash;
+        c.prio = e.prio;
+        strlcpy(c.ssid, e.ssid, sizeof(c.ssid));
+        strlcpy(c.pass, e.pass, sizeof(c.pass));
+        uint8_t pos = c.hash & (AP_INDEX_SIZE - 1);
+        while (_index[pos]) pos = (pos + 1) & (AP_INDEX_SIZE - 1);
+        _index[pos] = ++_count;
+        _adds++;
+        changes++;
+    }
+    return changes;
+}
+
+wl_status_t ApCandidatePool::connect(const Candidate& c, int32_t channel, const uint8_t* bssid, uint32_t timeoutMs) {
+    WiFi.begin(c.ssid, c.pass, channel, bssid);
+    uint32_t start = millis();
+    wl_status_t status = WiFi.status();
+    while (status != WL_CONNECTED && status != WL_CONNECT_FAILED && millis() - start < timeoutMs) {
+        delay(10);
+        status = WiFi.status();
+    }
+    return status;
+}
+
+wl_status_t ApCandidatePool::run(SiteSurvey& survey, uint8_t channel, uint32_t timeoutMs) {
+    _offChannel = 0;
+    if (!_count) return WiFi.status();
+
+    // 1. Frische Beobachtungen (eigene oder von Nachbarn): kein Scan
+    const SiteSurvey::Observation* o = survey.best([this](uint32_t hash) {
+        const Candidate* c = findHash(hash);
+        return c ? (int)c->prio : SURVEY_NO_PRIO;
+    }, millis(), channel);
+    if (o) {
+        const Candidate* c = findHash(o->ssidHash);
+        uint8_t bssid[6];
+        memcpy(bssid, o->bssid, 6);
+        Serial.printf("[WLAN] Verbinde laut Survey mit %s (Prio %d, %d dBm bei %u, Kanal %u)\n", c->ssid, c->prio, o->rssi, o->observer, o->channel);
+        wl_status_t status = connect(*c, o->channel, bssid, timeoutMs);
+        survey.noteConnect(status == WL_CONNECTED);
+        if (status == WL_CONNECTED) return status;
+        // AP weg oder umgezogen: Beobachtung verwerfen und selbst nachsehen
+        survey.forget(bssid);
+        WiFi.disconnect();
+    }
+
+    // 2. Selbst scannen
+    int n = WiFi.scanNetworks();
+    survey.recordScan(n, [this](const char* ssid) { return find(ssid) != nullptr; }, millis());
+    int bestScan = -1;
+    int bestOff = -1;
+    const Candidate* best = nullptr;
+    const Candidate* off = nullptr;
+    for (int i = 0; i < n; i++) {
+        const Candidate* c = find(WiFi.SSID(i).c_str());
+        if (!c) continue;
+        if (channel && WiFi.channel(i) != channel) {
+            // Station darf den Kanal nicht wechseln: nur merken, der Aufrufer kündigt den Wechsel an
+            if (!off || c->prio > off->prio || (c->prio == off->prio && WiFi.RSSI(i) > WiFi.RSSI(bestOff))) {
+                off = c;
+                bestOff = i;
+            }
+            continue;
+        }
+        if (!best || c->prio > best->prio || (c->prio == best->prio && WiFi.RSSI(i) > WiFi.RSSI(bestScan))) {
+            best = c;
+            bestScan = i;
+        }
+    }
+    if (!best) {
+        if (off) {
+            _offChannel = WiFi.channel(bestOff);
+            Serial.printf("[WLAN] %s nur auf Kanal %u, Mesh auf Kanal %u\n", off->ssid, _offChannel, channel);
+        }
+        WiFi.scanDelete();
+        return WiFi.status();
+    }
+
+    // Gezielt auf Kanal und BSSID aus dem Scan verbinden, kein zweiter Scan im Treiber
+    Serial.printf("[WLAN] Verbinde mit %s (Prio %d, %d dBm, Kanal %d)\n", best->ssid, best->prio, WiFi.RSSI(bestScan), WiFi.channel(bestScan));
+    uint8_t bssid[6];
+    memcpy(bssid, WiFi.BSSID(bestScan), 6);
+    int32_t channel = WiFi.channel(bestScan);
+    WiFi.scanDelete();
+    return connect(*best, channel, bssid, timeoutMs);
+}
+
+String ApCandidatePool::statusText() const {
+    return String(_count) + " Kandidaten, " + String(_adds) + " hinzugefügt, " + String(_updates) + " geändert, "
+         + String(_removes) + " entfernt";
+}
@@ -0,0 +1,65 @@
+#ifndef AP_CANDIDATE_POOL_H
+#define AP_CANDIDATE_POOL_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include "NetworkRegistry.h"
+#include "SiteSurvey.h"
+
+// =====================
+// WLAN-KANDIDATEN
+// =====================
+
+#define AP_INDEX_SIZE 32                // Zweierpotenz, mindestens 2 * REG_MAX_CANDIDATES
+#define AP_CONNECT_TIMEOUT_MS 5000      // Wie WiFiMulti::run()
+
+/**
+ * Verbindungskandidaten für die Station, Ersatz für WiFiMulti.
+ *
+ * WiFiMulti kennt kein Entfernen und hat bei jedem addAP() Duplikate angelegt.
+ * Der Pool hält genau die besten Einträge der Registry (NetworkRegistry::candidates)
+ * und gleicht sich nach jeder Config-Änderung per Diff ab: neue Netze kommen
+ * dazu, geänderte Passwörter/Prioritäten werden ersetzt, weggefallene entfernt.
+ * Scan-Ergebnisse werden über einen Hash-Index nach SSID zugeordnet, der Abgleich
+ * beim Verbinden ist damit O(Scan-Ergebnisse). Liegen frische Beobachtungen
+ * im Site Survey vor, wird ohne eigenen Scan direkt verbunden.
+ */
+class ApCandidatePool {
+public:
+    struct Candidate {
+        uint32_t hash = 0;          // FNV-1a der SSID (wie NetworkRegistry)
+        int8_t prio = 0;
+        char ssid[REG_SSID_LEN] = "";
+        char pass[REG_PASS_LEN] = "";
+    };
+
+    // Pool an die aktuelle Registry angleichen; liefert die Anzahl der Änderungen
+    uint8_t sync(const NetworkRegistry& registry);
+    // Kandidat zur SSID oder nullptr
+    const Candidate* find(const char* ssid) const;
+    const Candidate* findHash(uint32_t hash) const;
+    // Besten bekannten AP wählen (Priorität, dann RSSI) und verbinden: aus dem Survey,
+    // sonst per eigenem Scan (dessen Ergebnisse wiederum in den Survey gehen).
+    // channel != 0: nur APs auf diesem Kanal (Mesh-Kanal), siehe offChannel()
+    wl_status_t run(SiteSurvey& survey, uint8_t channel = 0, uint32_t timeoutMs = AP_CONNECT_TIMEOUT_MS);
+    // Kanal des besten Kandidaten, der beim letzten eingeschränkten run() übersprungen wurde, 0 = keiner
+    uint8_t offChannel() const { return _offChannel; }
+
+    uint8_t size() const { return _count; }
+    String statusText() const;
+
+private:
+    Candidate _slots[REG_MAX_CANDIDATES];
+    uint8_t _count = 0;
+    uint8_t _index[AP_INDEX_SIZE] = {};    // Slot + 1, 0 = frei
+    uint8_t _offChannel = 0;
+    uint32_t _adds = 0;
+    uint32_t _updates = 0;
+    uint32_t _removes = 0;
+
+    int findSlot(uint32_t hash, const char* ssid) const;
+    wl_status_t connect(const Candidate& c, int32_t channel, const uint8_t* bssid, uint32_t timeoutMs);
+    void rebuildIndex();
+};
+
+#endif
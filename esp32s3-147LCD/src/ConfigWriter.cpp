@@ -0,0 +1,78 @@
+#include "ConfigWriter.h"
+#include <LittleFS.h>
+
+void ConfigWriter::begin(const char* path) {
+    if (_task) return;
+    _path = path;
+    _lock = xSemaphoreCreateMutex();
+    xTaskCreate(taskMain, "cfgWriter", CFG_WRITER_STACK, this, CFG_WRITER_PRIO, &_task);
+}
+
+void ConfigWriter::submit(String& content) {
+    if (!_task) {
+        // Noch nicht gestartet (sehr früh im Setup): direkt schreiben
+        write(content);
+        return;
+    }
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    if (_pending) _coalesced++;
+    _next = std::move(content);
+    _pending = true;
+    xSemaphoreGive(_lock);
+    xTaskNotifyGive(_task);
+}
+
+bool ConfigWriter::flush(uint32_t timeoutMs) {
+    uint32_t start = millis();
+    while (!idle()) {
+        if (millis() - start >= timeoutMs) return false;
+        delay(5);
+    }
+    return true;
+}
+
+void ConfigWriter::taskMain(void* arg) {
+    ConfigWriter* self = static_cast<ConfigWriter*>(arg);
+    String content;
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        while (true) {
+            xSemaphoreTake(self->_lock, portMAX_DELAY);
+            if (!self->_pending) {
+                xSemaphoreGive(self->_lock);
+                break;
+            }
+            content = std::move(self->_next);
+            // idle() liest ohne Lock: nie beide Flags gleichzeitig false, solange geschrieben wird
+            self->_writing = true;
+            self->_pending = false;
+            xSemaphoreGive(self->_lock);
+
+            self->write(content);
+            content = String();
+            self->_writing = false;
+        }
+    }
+}
+
+void ConfigWriter::write(const String& content) {
+    uint32_t start = millis();
+    String tmp = String(_path) + ".tmp";
+    File f = LittleFS.open(tmp, "w");
+    bool ok = f && f.print(content) == content.length();
+    if (f) f.close();
+    ok = ok && LittleFS.rename(tmp, _path);
+    if (!ok) {
+        _failures++;
+        Serial.println("[ERROR] Konnte Datei nicht schreiben!");
+        return;
+    }
+    _writes++;
+    _lastMs = millis() - start;
+    _maxMs = max(_maxMs, _lastMs);
+}
+
+String ConfigWriter::statusText() const {
+    return String(_writes) + " geschrieben, " + String(_coalesced) + " zusammengefasst, " + String(_failures) + " Fehler, Dauer "
+         + String(_lastMs) + " ms (max " + String(_maxMs) + " ms)" + (idle() ? "" : ", schreibt...");
+}
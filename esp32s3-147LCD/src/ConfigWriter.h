@@ -0,0 +1,52 @@
+#ifndef CONFIG_WRITER_H
+#define CONFIG_WRITER_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+// =====================
+// FLASH-WORKER
+// =====================
+
+#define CFG_WRITER_STACK 6144
+#define CFG_WRITER_PRIO 1               // unter Loop und WLAN: schreibt, wenn sonst nichts zu tun ist
+
+/**
+ * Schreibt die Config in einem eigenen FreeRTOS-Task nach LittleFS.
+ *
+ * Die Hauptschleife serialisiert nur (schnell, im RAM) und übergibt den Text;
+ * das eigentliche Schreiben blockiert damit nie mesh.update(). Kommt ein neuer
+ * Stand, bevor der alte geschrieben ist, wird nur der neueste geschrieben.
+ * Geschrieben wird in eine temporäre Datei mit anschließendem Umbenennen, ein
+ * Leser sieht also immer einen vollständigen Stand.
+ */
+class ConfigWriter {
+public:
+    void begin(const char* path);
+    // Übernimmt den Inhalt von content
+    void submit(String& content);
+    // Wartet, bis nichts mehr aussteht (vor Neustart/Deep Sleep oder erneutem Lesen)
+    bool flush(uint32_t timeoutMs);
+
+    bool idle() const { return !_pending && !_writing; }
+    String statusText() const;
+
+private:
+    const char* _path = nullptr;
+    TaskHandle_t _task = nullptr;
+    SemaphoreHandle_t _lock = nullptr;
+    String _next;
+    volatile bool _pending = false;
+    volatile bool _writing = false;
+    uint32_t _writes = 0;
+    uint32_t _coalesced = 0;
+    uint32_t _failures = 0;
+    uint32_t _lastMs = 0;
+    uint32_t _maxMs = 0;
+
+    static void taskMain(void* arg);
+    void write(const String& content);
+};
+
+#endif
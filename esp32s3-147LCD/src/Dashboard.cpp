@@ -0,0 +1,215 @@
+/**
+ * @file Dashboard.cpp
+ * @brief Multi-panel LVGL status dashboard with change detection and a render budget.
+ *
+ * Widgets are only touched when the value they show actually changed, so LVGL
+ * invalidates (and re-renders) just those areas. Rendering itself is rate-capped
+ * and backs off when a frame exceeds DASH_RENDER_BUDGET_MS, leaving the loop free
+ * for mesh processing.
+ *
+ * LVGL time comes from esp_timer (monotonic, microseconds) and is advanced right
+ * before lv_timer_handler(); there is no tick interrupt.
+ */
+#include "Dashboard.h"
+#include <esp_timer.h>
+
+#define DASH_RSSI_HYST 3 // dB change needed before the WLAN label is redrawn
+
+static lv_obj_t *label_time;
+static lv_obj_t *label_wifi;
+static lv_obj_t *label_mesh;
+static lv_obj_t *label_cfg;
+static lv_obj_t *label_heap;
+static lv_obj_t *label_load;
+static lv_obj_t *chart_rssi;
+static lv_chart_series_t *ser_rssi;
+
+static DashboardModel shown;
+static bool shownValid = false;
+static DashboardFrameStats stats = {0, 0, 0, 0, 0, DASH_MIN_FRAME_MS};
+static uint32_t lastFrame = 0;
+static uint32_t lastSpark = 0;
+static uint32_t flushAccUs = 0;
+static uint32_t convertAccUs = 0;
+static int64_t lastTickUs = 0;
+static bool suspended = false;
+
+// =====================
+// Frame statistics
+// =====================
+// Called by LVGL after every refresh with the total refresh time and pixel count
+static void dashboard_monitor_cb(lv_disp_drv_t *disp_drv, uint32_t time, uint32_t px)
+{
+  uint32_t flushMs = flushAccUs / 1000;
+  stats.frames++;
+  stats.flushUs = flushAccUs;
+  stats.convertUs = convertAccUs;
+  stats.renderMs = time > flushMs ? time - flushMs : 0;
+  stats.pixels = px;
+  flushAccUs = 0;
+  convertAccUs = 0;
+
+  // Over budget: halve the frame rate; within budget: recover towards the cap
+  if (time > DASH_RENDER_BUDGET_MS)
+    stats.periodMs = min((uint32_t)DASH_MAX_FRAME_MS, stats.periodMs * 2);
+  else
+    stats.periodMs = max((uint32_t)DASH_MIN_FRAME_MS, stats.periodMs / 2);
+
+  log_d("[UI] Frame %u: render %u ms, flush %u us (convert %u us), %u px, period %u ms",
+        stats.frames, stats.renderMs, stats.flushUs, stats.convertUs, stats.pixels, stats.periodMs);
+}
+
+void Dashboard_NoteFlush(uint32_t us, uint32_t convertUs)
+{
+  flushAccUs += us;
+  convertAccUs += convertUs;
+}
+
+const DashboardFrameStats &Dashboard_Stats(void)
+{
+  return stats;
+}
+
+// =====================
+// Layout
+// =====================
+void Dashboard_Init(lv_disp_drv_t *disp_drv)
+{
+  // The driver is referenced by pointer after registration, so this takes effect immediately
+  disp_drv->monitor_cb = dashboard_monitor_cb;
+
+  lv_obj_t *scr = lv_scr_act();
+
+  label_time = lv_label_create(scr);
+  lv_label_set_text(label_time, "--:--:--");
+  lv_obj_set_style_text_font(label_time, &lv_font_montserrat_48, 0);
+  lv_obj_set_pos(label_time, 8, 4);
+
+  // RSSI sparkline
+  chart_rssi = lv_chart_create(scr);
+  lv_obj_set_size(chart_rssi, 110, 52);
+  lv_obj_align(chart_rssi, LV_ALIGN_TOP_RIGHT, -6, 8);
+  lv_chart_set_type(chart_rssi, LV_CHART_TYPE_LINE);
+  lv_chart_set_point_count(chart_rssi, DASH_SPARK_POINTS);
+  lv_chart_set_range(chart_rssi, LV_CHART_AXIS_PRIMARY_Y, -100, -30);
+  lv_chart_set_div_line_count(chart_rssi, 0, 0);
+  lv_obj_set_style_size(chart_rssi, 0, LV_PART_INDICATOR);
+  ser_rssi = lv_chart_add_series(chart_rssi, lv_palette_main(LV_PALETTE_GREEN), LV_CHART_AXIS_PRIMARY_Y);
+
+  label_mesh = lv_label_create(scr);
+  lv_obj_set_pos(label_mesh, 8, 72);
+  label_cfg = lv_label_create(scr);
+  lv_obj_set_pos(label_cfg, 8, 96);
+  label_heap = lv_label_create(scr);
+  lv_obj_set_pos(label_heap, 180, 72);
+  label_load = lv_label_create(scr);
+  lv_obj_set_pos(label_load, 180, 96);
+
+  label_wifi = lv_label_create(scr);
+  lv_label_set_text(label_wifi, "📡 WLAN...");
+  lv_obj_align(label_wifi, LV_ALIGN_BOTTOM_MID, 0, -10);
+}
+
+// =====================
+// Change detection
+// =====================
+bool Dashboard_Update(const DashboardModel &m)
+{
+  bool all = !shownValid;
+  bool significant = false;
+
+  if (all || strcmp(m.time, shown.time) != 0)
+  {
+    lv_label_set_text(label_time, m.time);
+    memcpy(shown.time, m.time, sizeof(shown.time));
+  }
+
+  bool rssiMoved = abs(m.rssi - shown.rssi) >= DASH_RSSI_HYST;
+  if (all || m.wifiUp != shown.wifiUp || strcmp(m.wifi, shown.wifi) != 0 || (m.wifiUp && rssiMoved))
+  {
+    if (m.wifiUp)
+      lv_label_set_text_fmt(label_wifi, "%s (%ddBm)", m.wifi, m.rssi);
+    else
+      lv_label_set_text(label_wifi, m.wifi);
+    significant |= m.wifiUp != shown.wifiUp || strcmp(m.wifi, shown.wifi) != 0;
+    shown.wifiUp = m.wifiUp;
+    shown.rssi = m.rssi;
+    memcpy(shown.wifi, m.wifi, sizeof(shown.wifi));
+  }
+
+  if (all || m.meshNodes != shown.meshNodes || m.meshDepth != shown.meshDepth)
+  {
+    lv_label_set_text_fmt(label_mesh, "Mesh: %u nodes, depth %u", m.meshNodes, m.meshDepth);
+    significant = true;
+    shown.meshNodes = m.meshNodes;
+    shown.meshDepth = m.meshDepth;
+  }
+
+  if (all || m.cfgVersion != shown.cfgVersion)
+  {
+    lv_label_set_text_fmt(label_cfg, "Config: v%u", m.cfgVersion);
+    significant = true;
+    shown.cfgVersion = m.cfgVersion;
+  }
+
+  if (all || m.heapKb != shown.heapKb)
+  {
+    lv_label_set_text_fmt(label_heap, "Heap: %u kB", m.heapKb);
+    shown.heapKb = m.heapKb;
+  }
+
+  if (all || m.loopLoad != shown.loopLoad)
+  {
+    lv_label_set_text_fmt(label_load, "Load: %u %%", m.loopLoad);
+    shown.loopLoad = m.loopLoad;
+  }
+
+  // The sparkline scrolls on a fixed period instead of on every RSSI wobble
+  if (m.wifiUp && millis() - lastSpark >= DASH_SPARK_PERIOD_MS)
+  {
+    lastSpark = millis();
+    lv_chart_set_next_value(chart_rssi, ser_rssi, m.rssi);
+  }
+
+  shownValid = true;
+  return significant && !all;
+}
+
+// =====================
+// Render with frame cap
+// =====================
+// Feed LVGL the elapsed whole milliseconds; the remainder carries over
+static void dashboard_tick(void)
+{
+  int64_t nowUs = esp_timer_get_time();
+  if (lastTickUs == 0)
+    lastTickUs = nowUs;
+  uint32_t ms = (nowUs - lastTickUs) / 1000;
+  if (ms)
+  {
+    lv_tick_inc(ms);
+    lastTickUs += (int64_t)ms * 1000;
+  }
+}
+
+uint32_t Dashboard_Render(void)
+{
+  dashboard_tick();
+  if (suspended)
+    return UINT32_MAX;
+
+  uint32_t now = millis();
+  uint32_t since = now - lastFrame;
+  if (since < stats.periodMs)
+    return stats.periodMs - since;
+  lastFrame = now;
+
+  // LVGL reports when its next timer (refresh, animation) is due
+  uint32_t next = lv_timer_handler();
+  return max(next, stats.periodMs);
+}
+
+void Dashboard_Suspend(bool suspend)
+{
+  suspended = suspend;
+}
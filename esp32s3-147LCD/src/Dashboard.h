@@ -0,0 +1,51 @@
+#pragma once
+
+#include <Arduino.h>
+#include <lvgl.h>
+
+// =====================
+// Dashboard tuning
+// =====================
+#define DASH_MIN_FRAME_MS      50    // frame-rate cap (20 fps)
+#define DASH_MAX_FRAME_MS      500   // slowest frame period when over budget
+#define DASH_RENDER_BUDGET_MS  12    // render+flush time allowed per frame
+#define DASH_SPARK_POINTS      32    // RSSI samples in the sparkline
+#define DASH_SPARK_PERIOD_MS   5000  // one sparkline sample every 5 s
+
+// Snapshot of everything the dashboard shows. Filled once per UI tick by the
+// caller; only fields that differ from the previous snapshot touch LVGL.
+struct DashboardModel
+{
+  char time[9];        // "HH:MM:SS" or "--:--:--"
+  bool wifiUp;
+  char wifi[64];       // "IP@SSID" or "NO WLAN"
+  int8_t rssi;         // dBm, only valid when wifiUp
+  uint16_t meshNodes;  // nodes in the mesh incl. this one
+  uint8_t meshDepth;   // hops to the farthest node
+  uint32_t cfgVersion;
+  uint32_t heapKb;     // free heap in kB (coarse on purpose: fewer redraws)
+  uint8_t loopLoad;    // % of wall time the main loop was busy
+};
+
+// Per-frame render statistics (from the LVGL monitor callback)
+struct DashboardFrameStats
+{
+  uint32_t frames;
+  uint32_t renderMs;   // last frame: LVGL render time without flush
+  uint32_t flushUs;    // last frame: time spent in the flush callback
+  uint32_t convertUs;  // last frame: part of flushUs spent converting pixels
+  uint32_t pixels;     // last frame: pixels refreshed
+  uint32_t periodMs;   // current frame period (grows when over budget)
+};
+
+void Dashboard_Init(lv_disp_drv_t *disp_drv);
+// Returns true when something operator-relevant changed (WLAN, mesh, config),
+// i.e. a reason to wake a dimmed/sleeping panel. Clock/heap/load ticks are not.
+bool Dashboard_Update(const DashboardModel &model);
+// Advances the LVGL tick from esp_timer (no periodic interrupt) and renders if the
+// frame cap allows. Returns the ms until the next call is useful.
+uint32_t Dashboard_Render(void);
+// While suspended LVGL is not run at all (panel asleep); widgets still track values.
+void Dashboard_Suspend(bool suspend);
+void Dashboard_NoteFlush(uint32_t us, uint32_t convertUs = 0);
+const DashboardFrameStats &Dashboard_Stats(void);
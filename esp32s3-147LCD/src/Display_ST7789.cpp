@@ -1,4 +1,5 @@
 #include "Display_ST7789.h"
+#include "PixelPipeline.h"
    
 SPIClass LCDspi(FSPI);
 #define SPI_WRITE(_dat)         LCDspi.transfer(_dat)
@@ -44,6 +45,16 @@ void LCD_WriteData_nbyte(uint8_t* SetData,uint8_t* ReadData,uint32_t Size)
   digitalWrite(EXAMPLE_PIN_NUM_LCD_CS, HIGH);  
   LCDspi.endTransaction();
 } 
+// Write-only variant: no receive buffer, bytes go out as they are
+void LCD_WriteData_Bytes(const uint8_t* Data, uint32_t Size)
+{
+  LCDspi.beginTransaction(SPISettings(SPIFreq, MSBFIRST, SPI_MODE0));
+  digitalWrite(EXAMPLE_PIN_NUM_LCD_CS, LOW);
+  digitalWrite(EXAMPLE_PIN_NUM_LCD_DC, HIGH);
+  LCDspi.writeBytes(Data, Size);
+  digitalWrite(EXAMPLE_PIN_NUM_LCD_CS, HIGH);
+  LCDspi.endTransaction();
+}
 
 void LCD_Reset(void)
 {
@@ -200,16 +211,33 @@ parameter :
     Ystart:   Start uint16_t y coordinate
     Xend  :   End uint16_t coordinates
     Yend  :   End uint16_t coordinates
-    color :   Set the color
+    color :   Big-endian RGB565 pixels (see Pixel_Swap16)
 ******************************************************************************/
 void LCD_addWindow(uint16_t Xstart, uint16_t Ystart, uint16_t Xend, uint16_t Yend,uint16_t* color)
 {             
   uint16_t Show_Width = Xend - Xstart + 1;
   uint16_t Show_Height = Yend - Ystart + 1;
   uint32_t numBytes = Show_Width * Show_Height * sizeof(uint16_t);
-  uint8_t Read_D[numBytes];
   LCD_SetCursor(Xstart, Ystart, Xend, Yend);
-  LCD_WriteData_nbyte((uint8_t*)color, Read_D, numBytes);        
+  LCD_WriteData_Bytes((const uint8_t*)color, numBytes);
+}
+/******************************************************************************
+function: Fill an area with one color
+parameter :
+    color :   Native RGB565 color
+******************************************************************************/
+void LCD_FillWindow(uint16_t Xstart, uint16_t Ystart, uint16_t Xend, uint16_t Yend, uint16_t color)
+{
+  static uint16_t Line[LCD_HEIGHT];
+  uint32_t Pixels = (uint32_t)(Xend - Xstart + 1) * (Yend - Ystart + 1);
+  uint32_t Chunk = min(Pixels, (uint32_t)LCD_HEIGHT);
+  Pixel_Fill16(Line, color, Chunk, true);
+  LCD_SetCursor(Xstart, Ystart, Xend, Yend);
+  while (Pixels) {
+    uint32_t Count = min(Pixels, Chunk);
+    LCD_WriteData_Bytes((const uint8_t*)Line, Count * sizeof(uint16_t));
+    Pixels -= Count;
+  }
 }
 // backlight
 void Backlight_Init(void)
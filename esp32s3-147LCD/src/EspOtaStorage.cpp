@@ -0,0 +1,126 @@
+#include "MeshOta.h"
+#include "MeshTrace.h"
+
+#include <Preferences.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#define OTA_SECTOR_SIZE 4096
+#define OTA_NVS_NAMESPACE "meshota"
+
+static const esp_partition_t* stagingPartition() {
+    return esp_ota_get_next_update_partition(NULL);
+}
+
+uint32_t EspOtaStorage::capacity() {
+    const esp_partition_t* p = stagingPartition();
+    return p ? p->size : 0;
+}
+
+bool EspOtaStorage::write(uint32_t offset, const uint8_t* data, size_t len) {
+    const esp_partition_t* p = stagingPartition();
+    if (!p || offset + len > p->size) return false;
+    // Nur Sektoren löschen, die in diesem Block beginnen (erlaubt Fortsetzen mitten im Sektor)
+    uint32_t end = offset + len;
+    for (uint32_t s = (offset + OTA_SECTOR_SIZE - 1) & ~(OTA_SECTOR_SIZE - 1); s < end; s += OTA_SECTOR_SIZE) {
+        if (esp_partition_erase_range(p, s, OTA_SECTOR_SIZE) != ESP_OK) return false;
+    }
+    MeshTrace::noteFlashWrite();
+    return esp_partition_write(p, offset, data, len) == ESP_OK;
+}
+
+bool EspOtaStorage::readStaged(uint32_t offset, uint8_t* data, size_t len) {
+    const esp_partition_t* p = stagingPartition();
+    return p && esp_partition_read(p, offset, data, len) == ESP_OK;
+}
+
+bool EspOtaStorage::readRunning(uint32_t offset, uint8_t* data, size_t len) {
+    const esp_partition_t* p = esp_ota_get_running_partition();
+    return p && esp_partition_read(p, offset, data, len) == ESP_OK;
+}
+
+bool EspOtaStorage::activate() {
+    const esp_partition_t* p = stagingPartition();
+    return p && esp_ota_set_boot_partition(p) == ESP_OK;
+}
+
+bool EspOtaStorage::loadProgress(String& hash, uint32_t& size, uint32_t& next) {
+    Preferences prefs;
+    prefs.begin(OTA_NVS_NAMESPACE, true);
+    hash = prefs.getString("h", "");
+    size = prefs.getUInt("sz", 0);
+    next = prefs.getUInt("nx", 0);
+    prefs.end();
+    return hash.length() > 0;
+}
+
+void EspOtaStorage::saveProgress(const String& hash, uint32_t size, uint32_t next) {
+    MeshTrace::noteFlashWrite();
+    Preferences prefs;
+    prefs.begin(OTA_NVS_NAMESPACE, false);
+    prefs.putString("h", hash);
+    prefs.putUInt("sz", size);
+    prefs.putUInt("nx", next);
+    prefs.end();
+}
+
+bool EspOtaStorage::installed(String& hash, uint32_t& size) {
+    Preferences prefs;
+    prefs.begin(OTA_NVS_NAMESPACE, true);
+    hash = prefs.getString("ih", "");
+    size = prefs.getUInt("isz", 0);
+    uint32_t addr = prefs.getUInt("ipa", 0);
+    prefs.end();
+    // Nach einem Rollback läuft wieder die alte Partition: dann nicht als Quelle melden
+    const esp_partition_t* running = esp_ota_get_running_partition();
+    return hash.length() > 0 && running && running->address == addr;
+}
+
+void EspOtaStorage::setInstalled(const String& hash, uint32_t size) {
+    MeshTrace::noteFlashWrite();
+    const esp_partition_t* p = stagingPartition();
+    Preferences prefs;
+    prefs.begin(OTA_NVS_NAMESPACE, false);
+    prefs.putString("ih", hash);
+    prefs.putUInt("isz", size);
+    prefs.putUInt("ipa", p ? p->address : 0);
+    prefs.end();
+}
+
+uint32_t EspOtaStorage::generation() {
+    Preferences prefs;
+    prefs.begin(OTA_NVS_NAMESPACE, true);
+    uint32_t gen = prefs.getUInt("g", 0);
+    prefs.end();
+    return gen;
+}
+
+void EspOtaStorage::setGeneration(uint32_t gen) {
+    MeshTrace::noteFlashWrite();
+    Preferences prefs;
+    prefs.begin(OTA_NVS_NAMESPACE, false);
+    prefs.putUInt("g", gen);
+    prefs.end();
+}
+
+// --- Flash-Worker für MeshOta ---
+
+static void otaWorkerMain(void* arg) {
+    MeshOta* ota = static_cast<MeshOta*>(arg);
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        ota->runFlashJob();
+    }
+}
+
+void MeshOta::startWorker() {
+    if (_kick || !_scratch) return;
+    TaskHandle_t task = nullptr;
+    if (xTaskCreate(otaWorkerMain, "otaFlash", OTA_WORKER_STACK, this, OTA_WORKER_PRIO, &task) != pdPASS) {
+        Serial.println("[OTA] Flash-Worker nicht gestartet, schreibe im Empfangspfad.");
+        return;
+    }
+    setWorker([task]() { xTaskNotifyGive(task); });
+}
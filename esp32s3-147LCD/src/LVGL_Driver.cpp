@@ -5,13 +5,15 @@
     The provided LVGL library file must be installed first
 ******************************************************************************/
 #include "LVGL_Driver.h"
+#include "MemoryPlacement.h"
+#include "PixelPipeline.h"
+#include <esp_timer.h>
 
 static lv_disp_draw_buf_t draw_buf;
-static lv_color_t buf1[ LVGL_BUF_LEN ];
-static lv_color_t buf2[ LVGL_BUF_LEN ];
-// static lv_color_t* buf1 = (lv_color_t*) heap_caps_malloc(LVGL_BUF_LEN, MALLOC_CAP_SPIRAM);
-// static lv_color_t* buf2 = (lv_color_t*) heap_caps_malloc(LVGL_BUF_LEN, MALLOC_CAP_SPIRAM);
-    
+// Pixel buffers are placed in DMA-capable internal RAM at init (see MemoryPlacement.h)
+static lv_color_t* buf1 = NULL;
+static lv_color_t* buf2 = NULL;
+
 
 
 /* Serial debugging */
@@ -27,7 +29,12 @@ void Lvgl_print(const char * buf)
 */
 void Lvgl_Display_LCD( lv_disp_drv_t *disp_drv, const lv_area_t *area, lv_color_t *color_p )
 {
-  LCD_addWindow(area->x1, area->y1, area->x2, area->y2, ( uint16_t *)&color_p->full);
+  uint16_t *px = (uint16_t *)&color_p->full;
+#if !LV_COLOR_16_SWAP
+  // Panel wants big-endian RGB565: swap the rendered area in place before it goes out
+  Pixel_Swap16(px, px, (uint32_t)(area->x2 - area->x1 + 1) * (area->y2 - area->y1 + 1));
+#endif
+  LCD_addWindow(area->x1, area->y1, area->x2, area->y2, px);
   lv_disp_flush_ready( disp_drv );
 }
 /*Read the touchpad*/
@@ -35,15 +42,33 @@ void Lvgl_Touchpad_Read( lv_indev_drv_t * indev_drv, lv_indev_data_t * data )
 {
   // NULL
 }
-void example_increase_lvgl_tick(void *arg)
+/* Advance LVGL time from esp_timer (monotonic) instead of a periodic tick timer */
+static void Lvgl_Tick(void)
 {
-    /* Tell LVGL how many milliseconds has elapsed */
-    lv_tick_inc(EXAMPLE_LVGL_TICK_PERIOD_MS);
+  static int64_t last_us = 0;
+  int64_t now_us = esp_timer_get_time();
+  if (last_us == 0)
+    last_us = now_us;
+  uint32_t ms = (now_us - last_us) / 1000;
+  if (ms) {
+    lv_tick_inc(ms);
+    last_us += (int64_t)ms * 1000;
+  }
 }
-void Lvgl_Init(void)
+/* Returns false (nothing registered with LVGL) if not even the minimum draw buffer fits */
+bool Lvgl_Init(void)
 {
+  size_t lines1 = 0, lines2 = 0;
+  buf1 = (lv_color_t*) memPlaceRows("lvgl-buf1", LVGL_WIDTH * sizeof(lv_color_t), LVGL_BUF_LINES, LVGL_BUF_LINES_MIN, MEM_DMA, &lines1);
+  if (!buf1) {
+    Serial.println("[MEM] Kein Zeichenpuffer für LVGL, Anzeige bleibt aus!");
+    Set_Backlight(0);
+    return false;
+  }
+  // Second buffer only helps double buffering; without it LVGL renders into buf1 alone
+  buf2 = (lv_color_t*) memPlaceRows("lvgl-buf2", LVGL_WIDTH * sizeof(lv_color_t), lines1, lines1, MEM_DMA, &lines2);
   lv_init();
-  lv_disp_draw_buf_init( &draw_buf, buf1, buf2, LVGL_BUF_LEN);
+  lv_disp_draw_buf_init( &draw_buf, buf1, buf2, LVGL_WIDTH * lines1);
 
   /*Initialize the display*/
   static lv_disp_drv_t disp_drv;
@@ -67,18 +92,11 @@ void Lvgl_Init(void)
   lv_obj_t *label = lv_label_create( lv_scr_act() );
   lv_label_set_text( label, "Hello Ardino and LVGL!");
   lv_obj_align( label, LV_ALIGN_CENTER, 0, 0 );
-
-  const esp_timer_create_args_t lvgl_tick_timer_args = {
-    .callback = &example_increase_lvgl_tick,
-    .name = "lvgl_tick"
-  };
-  esp_timer_handle_t lvgl_tick_timer = NULL;
-  esp_timer_create(&lvgl_tick_timer_args, &lvgl_tick_timer);
-  esp_timer_start_periodic(lvgl_tick_timer, EXAMPLE_LVGL_TICK_PERIOD_MS * 1000);
-
+  return true;
 }
-void Timer_Loop(void)
+/* Returns the ms until LVGL needs to run again, so the caller can sleep until then */
+uint32_t Timer_Loop(void)
 {
-  lv_timer_handler(); /* let the GUI do its work */
-  // delay( 5 );
+  Lvgl_Tick();
+  return lv_timer_handler(); /* let the GUI do its work */
 }
\ No newline at end of file
@@ -8,15 +8,14 @@
 
 #define LVGL_WIDTH    LCD_WIDTH 
 #define LVGL_HEIGHT   LCD_HEIGHT
-#define LVGL_BUF_LEN  (LVGL_WIDTH * LVGL_HEIGHT / 20)
-
-#define EXAMPLE_LVGL_TICK_PERIOD_MS  5
+#define LVGL_BUF_LINES      (LVGL_HEIGHT / 4)     // preferred lines per draw buffer
+#define LVGL_BUF_LINES_MIN  (LVGL_HEIGHT / 20)    // fallback when internal RAM is tight
+#define LVGL_BUF_LEN  (LVGL_WIDTH * LVGL_BUF_LINES)
 
 
 void Lvgl_print(const char * buf);
 void Lvgl_Display_LCD( lv_disp_drv_t *disp_drv, const lv_area_t *area, lv_color_t *color_p ); // Displays LVGL content on the LCD.    This function implements associating LVGL data to the LCD screen
 void Lvgl_Touchpad_Read( lv_indev_drv_t * indev_drv, lv_indev_data_t * data );                // Read the touchpad
-void example_increase_lvgl_tick(void *arg);
 
-void Lvgl_Init(void);
-void Timer_Loop(void);
+bool Lvgl_Init(void);
+uint32_t Timer_Loop(void);
@@ -0,0 +1,128 @@
+#include "MemoryPlacement.h"
+
+#if __has_include(<esp_memory_utils.h>)
+#include <esp_memory_utils.h>
+#else
+#include <soc/soc_memory_layout.h>
+#endif
+
+struct MemConsumer {
+  const char *name;
+  size_t bytes;
+  MemRegion wanted;
+  void *ptr;
+};
+
+static MemConsumer consumers[MEM_MAX_CONSUMERS];
+static uint8_t consumerCount = 0;
+static bool networkUp = false;
+
+static const char *regionName(MemRegion region)
+{
+  switch (region)
+  {
+  case MEM_DMA:
+    return "DMA";
+  case MEM_PSRAM:
+    return "PSRAM";
+  default:
+    return "INTERN";
+  }
+}
+
+static uint32_t regionCaps(MemRegion region)
+{
+  switch (region)
+  {
+  case MEM_DMA:
+    return MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+  case MEM_PSRAM:
+    return MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT;
+  default:
+    return MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+  }
+}
+
+// Interne Allokationen dürfen die Reserve für die Netzwerk-Stacks nicht unterschreiten.
+// Vor deren Start ist ihr eigener Bedarf noch frei und wird mit eingerechnet.
+static bool fitsInternal(size_t bytes)
+{
+  size_t freeInternal = heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  size_t reserve = MEM_INTERNAL_RESERVE + (networkUp ? 0 : MEM_NET_STARTUP_FOOTPRINT);
+  return freeInternal > bytes && freeInternal - bytes >= reserve;
+}
+
+static void *allocIn(size_t bytes, MemRegion region)
+{
+  if (region == MEM_PSRAM)
+  {
+    void *p = psramFound() ? heap_caps_malloc(bytes, regionCaps(MEM_PSRAM)) : NULL;
+    if (p)
+      return p;
+    // Kein PSRAM bestückt/aktiv: intern, aber nur oberhalb der Reserve
+    region = MEM_INTERNAL;
+  }
+  if (!fitsInternal(bytes))
+    return NULL;
+  return heap_caps_malloc(bytes, regionCaps(region));
+}
+
+static void track(const char *consumer, size_t bytes, MemRegion region, void *ptr)
+{
+  if (!ptr || consumerCount >= MEM_MAX_CONSUMERS)
+    return;
+  consumers[consumerCount++] = {consumer, bytes, region, ptr};
+}
+
+void *memPlace(const char *consumer, size_t bytes, MemRegion region)
+{
+  void *p = allocIn(bytes, region);
+  if (!p)
+    Serial.printf("[MEM] %s: %u B in %s nicht verfügbar!\n", consumer, bytes, regionName(region));
+  track(consumer, bytes, region, p);
+  return p;
+}
+
+void *memPlaceRows(const char *consumer, size_t rowBytes, size_t maxRows, size_t minRows, MemRegion region, size_t *rows)
+{
+  // Zeilenzahl halbieren, bis der Puffer neben der Reserve Platz hat
+  size_t n = maxRows;
+  while (n > 0)
+  {
+    void *p = allocIn(rowBytes * n, region);
+    if (p)
+    {
+      *rows = n;
+      track(consumer, rowBytes * n, region, p);
+      return p;
+    }
+    if (n <= minRows)
+      break;
+    n = max(n / 2, minRows);
+  }
+  *rows = 0;
+  Serial.printf("[MEM] %s: nicht einmal %u Zeilen in %s verfügbar!\n", consumer, minRows, regionName(region));
+  return NULL;
+}
+
+void memNoteNetworkUp(void)
+{
+  networkUp = true;
+}
+
+void memPrintMap(void)
+{
+  Serial.println("[MEM] Speicherkarte:");
+  for (uint8_t i = 0; i < consumerCount; i++)
+  {
+    const MemConsumer &c = consumers[i];
+    const char *actual = esp_ptr_external_ram(c.ptr) ? "PSRAM" : (esp_ptr_dma_capable(c.ptr) ? "DMA" : "INTERN");
+    Serial.printf("[MEM]   %-18s %7u B  Soll: %-6s Ist: %-6s @%p\n", c.name, c.bytes, regionName(c.wanted), actual, c.ptr);
+  }
+  Serial.printf("[MEM] Frei intern: %u B (größter Block %u B, Reserve %u B), DMA: %u B, PSRAM: %u B\n",
+                heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT),
+                heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT),
+                MEM_INTERNAL_RESERVE,
+                heap_caps_get_free_size(MALLOC_CAP_DMA),
+                heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
+}
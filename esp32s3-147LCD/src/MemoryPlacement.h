@@ -0,0 +1,34 @@
+#pragma once
+
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+
+// =====================
+// Speicherregionen
+// =====================
+// MEM_DMA      : interner, DMA-fähiger RAM (Pixelpuffer für SPI)
+// MEM_PSRAM    : externer PSRAM (große JSON-Arenen, Transferpuffer), Fallback intern
+// MEM_INTERNAL : interner RAM ohne DMA-Anforderung
+enum MemRegion { MEM_DMA, MEM_PSRAM, MEM_INTERNAL };
+
+// Interner RAM, der für WiFi, lwIP, painlessMesh und AsyncTCP frei bleiben muss
+#define MEM_INTERNAL_RESERVE (64 * 1024)
+// Bedarf der Stacks beim Start (WiFi-Treiber mit Standardpuffern, lwIP, Mesh-/TCP-Tasks).
+// Bis memNoteNetworkUp() kommt er zur Reserve hinzu, danach ist er im freien Heap schon abgezogen.
+#define MEM_NET_STARTUP_FOOTPRINT (80 * 1024)
+
+// Maximale Anzahl protokollierter Verbraucher
+#define MEM_MAX_CONSUMERS 16
+
+// Allokiert 'bytes' für 'consumer' in der gewünschten Region und trägt ihn in die Speicherkarte ein.
+void *memPlace(const char *consumer, size_t bytes, MemRegion region);
+
+// Allokiert zeilenweise: so viele Zeilen wie möglich (maxRows..minRows), ohne die interne Reserve
+// anzugreifen. Die erhaltene Zeilenzahl steht danach in *rows.
+void *memPlaceRows(const char *consumer, size_t rowBytes, size_t maxRows, size_t minRows, MemRegion region, size_t *rows);
+
+// Meldet, dass WiFi/lwIP/painlessMesh laufen: ab jetzt gilt nur noch MEM_INTERNAL_RESERVE.
+void memNoteNetworkUp(void);
+
+// Gibt die Speicherkarte (Verbraucher, Größe, tatsächliche Region) und die freien Bereiche aus.
+void memPrintMap(void);
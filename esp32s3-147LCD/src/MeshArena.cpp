@@ -0,0 +1,58 @@
+#include "MeshArena.h"
+
+void MeshArena::attach(uint8_t* buffer, size_t size) {
+    // Startadresse ausrichten, damit jeder Block 8-Byte-aligned ist
+    uintptr_t start = (reinterpret_cast<uintptr_t>(buffer) + 7) & ~(uintptr_t)7;
+    size_t skew = start - reinterpret_cast<uintptr_t>(buffer);
+    _buffer = buffer ? reinterpret_cast<uint8_t*>(start) : nullptr;
+    _size = (buffer && size > skew) ? (size - skew) & ~(size_t)7 : 0;
+    reset();
+}
+
+void* MeshArena::allocate(size_t size) {
+    size_t need = sizeof(Header) + align(size);
+    if (_used + need > _size) {
+        _failures++;
+        return nullptr;
+    }
+    Header* h = reinterpret_cast<Header*>(_buffer + _used);
+    h->size = size;
+    _last = reinterpret_cast<uint8_t*>(h + 1);
+    _used += need;
+    if (_used > _highWater) _highWater = _used;
+    return _last;
+}
+
+void MeshArena::deallocate(void* ptr) {
+    // Nur der letzte Block kann zurückgegeben werden, alles andere erst beim reset()
+    if (ptr && ptr == _last) {
+        _used = reinterpret_cast<uint8_t*>(headerOf(ptr)) - _buffer;
+        _last = nullptr;
+    }
+}
+
+void* MeshArena::reallocate(void* ptr, size_t newSize) {
+    if (!ptr) return allocate(newSize);
+
+    Header* h = headerOf(ptr);
+    if (ptr == _last) {
+        size_t start = reinterpret_cast<uint8_t*>(h) - _buffer;
+        size_t need = sizeof(Header) + align(newSize);
+        if (start + need > _size) {
+            _failures++;
+            return nullptr;
+        }
+        h->size = newSize;
+        _used = start + need;
+        if (_used > _highWater) _highWater = _used;
+        return ptr;
+    }
+
+    if (newSize <= h->size) {
+        h->size = newSize;
+        return ptr;
+    }
+    void* moved = allocate(newSize);
+    if (moved) memcpy(moved, ptr, h->size);
+    return moved;
+}
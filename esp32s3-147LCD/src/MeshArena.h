@@ -0,0 +1,55 @@
+#ifndef MESH_ARENA_H
+#define MESH_ARENA_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <assert.h>
+
+/**
+ * Bump-Allocator für ArduinoJson auf einem fest reservierten Puffer.
+ *
+ * Pro Mesh-Nachricht wird der Pool einmal zurückgesetzt; Einzelfreigaben sind
+ * bis auf den zuletzt vergebenen Block wirkungslos. So laufen Parsen und
+ * Antworten ohne einen einzigen Aufruf von malloc/free.
+ *
+ * Solange das empfangene Dokument lebt, ist die Arena belegt (hold): Handler
+ * dürfen sie dann weder zurücksetzen noch ein zweites Dokument darauf anlegen.
+ */
+class MeshArena : public ArduinoJson::Allocator {
+public:
+    MeshArena() {}
+    MeshArena(uint8_t* buffer, size_t size) { attach(buffer, size); }
+
+    void attach(uint8_t* buffer, size_t size);
+    void reset() { assert(!_held); _used = 0; _last = nullptr; }
+    void hold(bool held) { _held = held; }
+    bool held() const { return _held; }
+
+    void* allocate(size_t size) override;
+    void deallocate(void* ptr) override;
+    void* reallocate(void* ptr, size_t newSize) override;
+
+    size_t capacity() const { return _size; }
+    size_t used() const { return _used; }
+    size_t highWater() const { return _highWater; }
+    uint32_t failures() const { return _failures; }
+
+private:
+    struct Header {
+        uint32_t size;
+        uint32_t pad;   // hält die Nutzdaten 8-Byte-ausgerichtet
+    };
+
+    uint8_t* _buffer = nullptr;
+    size_t _size = 0;
+    size_t _used = 0;
+    size_t _highWater = 0;
+    uint32_t _failures = 0;
+    uint8_t* _last = nullptr;   // zuletzt vergebener Block (kann in place wachsen/freigegeben werden)
+    bool _held = false;
+
+    static size_t align(size_t n) { return (n + 7) & ~(size_t)7; }
+    static Header* headerOf(void* ptr) { return reinterpret_cast<Header*>(static_cast<uint8_t*>(ptr) - sizeof(Header)); }
+};
+
+#endif
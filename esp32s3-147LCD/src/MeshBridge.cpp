@@ -0,0 +1,248 @@
+#include "MeshBridge.h"
+#include <HTTPClient.h>
+
+void MeshBridge::begin(uint32_t nodeId, SendSingleFn sendSingle, BroadcastFn broadcast, uint8_t* store) {
+    _nodeId = nodeId;
+    _sendSingle = sendSingle;
+    _broadcast = broadcast;
+    _slots = store;
+    _body = store ? store + BRIDGE_QUEUE_SLOTS * BRIDGE_SLOT_SIZE : nullptr;
+    _lastStatus = millis();
+    if (store && !_task) xTaskCreate(taskMain, "bridgePost", BRIDGE_TASK_STACK, this, BRIDGE_TASK_PRIO, &_task);
+}
+
+// --- Knoten-Seite ---
+
+void MeshBridge::noteCandidate(uint32_t id, uint32_t now) {
+    Candidate* slot = nullptr;
+    for (Candidate& c : _candidates) {
+        if (c.id == id) { slot = &c; break; }
+        if (!slot && (c.id == 0 || now - c.lastSeen >= BRIDGE_HB_TIMEOUT_MS)) slot = &c;
+    }
+    if (!slot) return;
+    slot->id = id;
+    slot->lastSeen = now;
+}
+
+uint32_t MeshBridge::current(uint32_t now) const {
+    if (_isBridge) return _nodeId;
+    uint32_t best = 0;
+    for (const Candidate& c : _candidates) {
+        if (c.id == 0 || now - c.lastSeen >= BRIDGE_HB_TIMEOUT_MS) continue;
+        if (best == 0 || c.id < best) best = c.id;
+    }
+    return best;
+}
+
+void MeshBridge::publish(JsonDocument& doc, String& tx, uint32_t now) {
+    if (_isBridge) {
+        enqueue(_nodeId, doc, now);
+        return;
+    }
+    uint32_t target = current(now);
+    if (!target || !_credit) {
+        _stats.throttled++;
+        return;
+    }
+    _credit--;
+    serializeJson(doc, tx);
+    _sendSingle(target, tx, false);
+}
+
+bool MeshBridge::handleMessage(uint32_t from, JsonDocument& doc, String& tx, uint32_t now) {
+    if (doc["type"] == "BRIDGE_HB") {
+        uint32_t was = current(now);
+        noteCandidate(from, now);
+        // Credits gelten nur von der Bridge, an die wir tatsächlich senden
+        if (current(now) == from) _credit = doc["cr"] | 0;
+        if (!_isBridge && was != current(now)) Serial.printf("[BRIDGE] Sende jetzt an Bridge %u\n", current(now));
+        return true;
+    }
+    if (doc["type"] == "STATUS") {
+        if (_isBridge) {
+            enqueue(from, doc, now);
+        } else {
+            // Bridge hat den Uplink verloren, der Absender weiß es noch nicht: weiterreichen.
+            // Der Ursprung bleibt erhalten, die Hop-Grenze verhindert Kreisläufe zwischen Knoten.
+            uint32_t target = current(now);
+            uint8_t hops = doc["fh"] | 0;
+            if (target && target != from && hops < BRIDGE_FORWARD_HOPS) {
+                if (doc["f"].isNull()) doc["f"] = from;
+                doc["fh"] = hops + 1;
+                serializeJson(doc, tx);
+                _sendSingle(target, tx, true);
+            } else {
+                _stats.dropped++;
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+// --- Bridge-Seite ---
+
+bool MeshBridge::enqueue(uint32_t from, JsonDocument& doc, uint32_t now) {
+    if (!_slots) return false;
+    if (doc["f"].isNull()) doc["f"] = from;
+    doc.remove("fh");
+    size_t len = measureMsgPack(doc);
+    if (_count >= BRIDGE_QUEUE_SLOTS || len > BRIDGE_SLOT_SIZE || len > 255) {
+        _stats.dropped++;
+        return false;
+    }
+    uint8_t idx = (_head + _count) % BRIDGE_QUEUE_SLOTS;
+    _lens[idx] = serializeMsgPack(doc, _slots + idx * BRIDGE_SLOT_SIZE, BRIDGE_SLOT_SIZE);
+    if (_count++ == 0) _firstQueuedAt = now;
+    _stats.queued++;
+    return true;
+}
+
+// Credits pro Knoten aus dem freien Queue-Platz; bei Backoff keine, bei langsamem Uplink halb so viele
+uint8_t MeshBridge::credit() const {
+    if (_backoff) return 0;
+    uint32_t perNode = (BRIDGE_QUEUE_SLOTS - _count) / max((uint16_t)1, _nodeCount);
+    if (_stats.lastLatencyMs > BRIDGE_SLOW_MS) perNode /= 2;
+    return min((uint32_t)BRIDGE_MAX_CREDIT, perNode);
+}
+
+static uint8_t* putU32(uint8_t* p, uint32_t v) {
+    *p++ = 0xce;
+    *p++ = v >> 24; *p++ = v >> 16; *p++ = v >> 8; *p++ = v;
+    return p;
+}
+
+static uint8_t* putKey(uint8_t* p, char key) {
+    *p++ = 0xa1;    // fixstr, Länge 1
+    *p++ = key;
+    return p;
+}
+
+void MeshBridge::startPost(uint32_t now) {
+    uint8_t n = min((uint8_t)BRIDGE_BATCH_MAX, _count);
+
+    // {"b": Bridge-ID, "t": Unix-Zeit, "r": [Datensätze...]} als MessagePack
+    uint8_t* p = _body;
+    *p++ = 0x83;
+    p = putKey(p, 'b'); p = putU32(p, _nodeId);
+    p = putKey(p, 't'); p = putU32(p, time(nullptr));
+    p = putKey(p, 'r');
+    *p++ = 0xdc; *p++ = n >> 8; *p++ = n;
+    for (uint8_t i = 0; i < n; i++) {
+        uint8_t idx = (_head + i) % BRIDGE_QUEUE_SLOTS;
+        memcpy(p, _slots + idx * BRIDGE_SLOT_SIZE, _lens[idx]);
+        p += _lens[idx];
+    }
+
+    // Die Slots bleiben bis zum Ergebnis in der Queue; neue Datensätze landen dahinter
+    _postLen = p - _body;
+    _postCount = n;
+    _postUrl = _url;
+    _postStart = now;
+    _postDone = false;
+    _posting = true;
+    if (_task) {
+        xTaskNotifyGive(_task);
+        return;
+    }
+    // Kein Task (Erstellung fehlgeschlagen): wie bisher direkt senden
+    _postCode = post();
+    _postDone = true;
+    finishPost(millis());
+}
+
+int MeshBridge::post() {
+    HTTPClient http;
+    http.setConnectTimeout(BRIDGE_HTTP_TIMEOUT_MS);
+    http.setTimeout(BRIDGE_HTTP_TIMEOUT_MS);
+    int code = -1;
+    if (http.begin(_postUrl)) {
+        http.addHeader("Content-Type", "application/msgpack");
+        code = http.POST(_body, _postLen);
+        http.end();
+    }
+    return code;
+}
+
+void MeshBridge::taskMain(void* arg) {
+    MeshBridge* self = static_cast<MeshBridge*>(arg);
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (!self->_posting || self->_postDone) continue;
+        self->_postCode = self->post();
+        self->_postDone = true;
+    }
+}
+
+void MeshBridge::finishPost(uint32_t now) {
+    int code = _postCode;
+    uint8_t n = _postCount;
+    _posting = false;
+    _postDone = false;
+    _stats.lastLatencyMs = now - _postStart;
+
+    if (code >= 200 && code < 300) {
+        _head = (_head + n) % BRIDGE_QUEUE_SLOTS;
+        _count -= n;
+        _firstQueuedAt = now;
+        _backoff = 0;
+        _nextAttempt = now;
+        _stats.posted += n;
+        _stats.batches++;
+        _stats.bytes += _postLen;
+        return;
+    }
+
+    // Exponentielles Backoff; die Daten bleiben in der Queue
+    _backoff = _backoff ? min((uint32_t)BRIDGE_BACKOFF_MAX_MS, _backoff * 2) : BRIDGE_BACKOFF_MIN_MS;
+    _nextAttempt = now + _backoff;
+    _stats.failures++;
+    Serial.printf("[BRIDGE] POST fehlgeschlagen (%d), nächster Versuch in %u s\n", code, _backoff / 1000);
+}
+
+bool MeshBridge::loop(uint32_t now, bool uplink) {
+    bool bridge = uplink && _url.length() > 0 && _slots;
+    if (bridge != _isBridge) {
+        _isBridge = bridge;
+        _lastHb = now - BRIDGE_HB_MS;   // sofort melden
+        Serial.println(bridge ? "[BRIDGE] Bridge-Rolle übernommen." : "[BRIDGE] Bridge-Rolle abgegeben.");
+    }
+
+    if (_isBridge) {
+        if (now - _lastHb >= BRIDGE_HB_MS) {
+            JsonDocument hb;
+            hb["type"] = "BRIDGE_HB";
+            hb["cr"] = credit();
+            String msg;
+            serializeJson(hb, msg);
+            _broadcast(msg);
+            _lastHb = now;
+        }
+    }
+    // Ergebnis auch nach Abgabe der Rolle übernehmen, die Queue bleibt bestehen
+    if (_posting && _postDone) finishPost(now);
+    if (_isBridge && !_posting) {
+        bool due = _count >= BRIDGE_BATCH_MAX || (_count && now - _firstQueuedAt >= BRIDGE_BATCH_MS);
+        if (due && (int32_t)(now - _nextAttempt) >= 0) startPost(now);
+    }
+
+    if (now - _lastStatus < BRIDGE_STATUS_MS) return false;
+    _lastStatus = now;
+    return true;
+}
+
+String MeshBridge::statusText(uint32_t now) const {
+    String out;
+    if (_isBridge) {
+        out = "Bridge aktiv, Queue " + String(_count) + "/" + String(BRIDGE_QUEUE_SLOTS);
+        out += ", hochgeladen: " + String(_stats.posted) + " in " + String(_stats.batches) + " POSTs (" + String(_stats.bytes) + " B)";
+        out += ", Fehler: " + String(_stats.failures) + ", verworfen: " + String(_stats.dropped);
+        out += ", Latenz " + String(_stats.lastLatencyMs) + " ms, Credit " + String(credit());
+        if (_posting) out += ", POST läuft";
+    } else {
+        uint32_t target = current(now);
+        out = target ? "Sende an Bridge " + String(target) + ", Credit " + String(_credit) : String("Keine Bridge erreichbar");
+        out += ", gedrosselt: " + String(_stats.throttled);
+    }
+    return out;
+}
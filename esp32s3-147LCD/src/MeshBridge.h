@@ -0,0 +1,134 @@
+#ifndef MESH_BRIDGE_H
+#define MESH_BRIDGE_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <functional>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// =====================
+// MESH BRIDGE (Uplink ins LAN)
+// =====================
+
+#define BRIDGE_QUEUE_SLOTS 64           // Zwischengespeicherte Datensätze auf der Bridge
+#define BRIDGE_SLOT_SIZE 160            // MessagePack-Bytes pro Datensatz
+#define BRIDGE_BATCH_MAX 32             // Datensätze pro HTTP-POST
+#define BRIDGE_BATCH_MS 10000           // Spätestens so oft senden, wenn etwas ansteht
+#define BRIDGE_HB_MS 10000              // BRIDGE_HB Intervall (trägt die Credits)
+#define BRIDGE_HB_TIMEOUT_MS 35000      // Bridge ohne HB gilt als ausgefallen
+#define BRIDGE_MAX_CANDIDATES 4
+#define BRIDGE_MAX_CREDIT 4             // Nachrichten pro Knoten und HB-Intervall
+#define BRIDGE_STATUS_MS 60000          // STATUS jedes Knotens
+#define BRIDGE_HTTP_TIMEOUT_MS 3000
+#define BRIDGE_SLOW_MS 1000             // Langsamer Uplink: Credits halbieren
+#define BRIDGE_BACKOFF_MIN_MS 2000
+#define BRIDGE_BACKOFF_MAX_MS 60000
+#define BRIDGE_FORWARD_HOPS 2          // STATUS höchstens so oft weiterreichen (Schutz vor Schleifen)
+#define BRIDGE_TASK_STACK 8192          // HTTPClient + TLS-freies TCP
+#define BRIDGE_TASK_PRIO 1              // wie der Config-Writer: unter Loop und WLAN
+#define BRIDGE_BODY_SIZE (BRIDGE_BATCH_MAX * BRIDGE_SLOT_SIZE + 32)
+#define BRIDGE_STORE_SIZE (BRIDGE_QUEUE_SLOTS * BRIDGE_SLOT_SIZE + BRIDGE_BODY_SIZE)
+
+/**
+ * Sammelt STATUS/Ereignisse aller Mesh-Knoten auf einer Bridge und schickt sie
+ * gebündelt per HTTP-POST an einen konfigurierbaren Endpunkt.
+ *
+ * Bridge ist jeder Knoten mit WLAN-Uplink und gesetzter bridge_url. Bridges
+ * melden sich per BRIDGE_HB und vergeben darin Credits; Knoten senden an die
+ * Bridge mit der niedrigsten ID, deren HB noch frisch ist. Datensätze werden
+ * beim Empfang einmalig nach MessagePack umgesetzt, der POST-Body ist nur noch
+ * das Aneinanderhängen der Slots.
+ *
+ * Der POST läuft in einem eigenen FreeRTOS-Task: die Hauptschleife baut den Body,
+ * übergibt ihn und wertet das Ergebnis beim nächsten loop() aus. Ein langsamer
+ * oder hängender Endpunkt blockiert damit nie mesh.update().
+ */
+class MeshBridge {
+public:
+    // forwarded: weitergereichter STATUS eines anderen Knotens (darf den eigenen nicht ersetzen)
+    typedef std::function<void(uint32_t, const String&, bool forwarded)> SendSingleFn;
+    typedef std::function<void(const String&)> BroadcastFn;
+
+    struct Stats {
+        uint32_t queued = 0;        // angenommene Datensätze
+        uint32_t posted = 0;        // erfolgreich hochgeladene Datensätze
+        uint32_t batches = 0;
+        uint32_t failures = 0;      // fehlgeschlagene POSTs
+        uint32_t dropped = 0;       // Queue voll oder Datensatz zu groß
+        uint32_t throttled = 0;     // eigene Nachrichten ohne Credit verworfen
+        uint32_t bytes = 0;         // hochgeladene Body-Bytes
+        uint32_t lastLatencyMs = 0;
+    };
+
+    // store: BRIDGE_STORE_SIZE Bytes (Queue + POST-Body, vom Aufrufer platziert)
+    void begin(uint32_t nodeId, SendSingleFn sendSingle, BroadcastFn broadcast, uint8_t* store);
+    void setUrl(const String& url) { _url = url; }
+    const String& url() const { return _url; }
+
+    // true = eigener STATUS ist fällig (Aufrufer füllt ihn und ruft publish)
+    bool loop(uint32_t now, bool uplink);
+    // Knotenzahl für die Credit-Verteilung (wird mit jedem STATUS aktualisiert)
+    void setNodeCount(uint16_t nodes) { _nodeCount = nodes; }
+    // Datensatz an die aktuelle Bridge (oder lokal in die Queue, wenn wir selbst Bridge sind)
+    void publish(JsonDocument& doc, String& tx, uint32_t now);
+    // true = BRIDGE_HB/STATUS verarbeitet
+    bool handleMessage(uint32_t from, JsonDocument& doc, String& tx, uint32_t now);
+
+    bool isBridge() const { return _isBridge; }
+    bool posting() const { return _posting; }
+    uint32_t current(uint32_t now) const;
+    const Stats& stats() const { return _stats; }
+    String statusText(uint32_t now) const;
+
+private:
+    struct Candidate {
+        uint32_t id = 0;
+        uint32_t lastSeen = 0;
+    };
+
+    uint32_t _nodeId = 0;
+    SendSingleFn _sendSingle;
+    BroadcastFn _broadcast;
+    String _url;
+    bool _isBridge = false;
+
+    // Bridge-Seite: Ring aus festen Slots
+    uint8_t* _slots = nullptr;
+    uint8_t* _body = nullptr;
+    uint8_t _lens[BRIDGE_QUEUE_SLOTS];
+    uint8_t _head = 0;
+    uint8_t _count = 0;
+    uint32_t _firstQueuedAt = 0;
+    uint32_t _nextAttempt = 0;
+    uint32_t _backoff = 0;
+    uint32_t _lastHb = 0;
+    uint16_t _nodeCount = 1;
+
+    // Upload-Task: _body, _postUrl und _postLen gehören ihm, solange _posting gesetzt ist
+    TaskHandle_t _task = nullptr;
+    String _postUrl;
+    size_t _postLen = 0;
+    uint8_t _postCount = 0;         // Datensätze im laufenden POST
+    uint32_t _postStart = 0;
+    volatile bool _posting = false;
+    volatile bool _postDone = false;
+    volatile int _postCode = 0;
+
+    // Knoten-Seite
+    Candidate _candidates[BRIDGE_MAX_CANDIDATES];
+    uint8_t _credit = 1;
+    uint32_t _lastStatus = 0;
+
+    Stats _stats;
+
+    bool enqueue(uint32_t from, JsonDocument& doc, uint32_t now);
+    uint8_t credit() const;
+    void noteCandidate(uint32_t id, uint32_t now);
+    void startPost(uint32_t now);
+    void finishPost(uint32_t now);
+    int post();
+    static void taskMain(void* arg);
+};
+
+#endif
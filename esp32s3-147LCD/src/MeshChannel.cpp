@@ -0,0 +1,213 @@
+#include "MeshChannel.h"
+#include <WiFi.h>
+#include <Preferences.h>
+
+uint8_t MeshChannel::bootChannel(uint8_t uplinkChannel, uint8_t meshChannel) {
+    Preferences prefs;
+    prefs.begin("swarm", true);
+    _channel = prefs.getUChar("chan", 0);
+    _epoch = prefs.getULong("chanEp", 0);
+    prefs.end();
+
+    const char* source;
+    uint8_t ch;
+    if (meshChannel) {
+        ch = meshChannel;
+        source = "Mesh gefunden";
+    } else if (uplinkChannel) {
+        ch = uplinkChannel;
+        source = "Uplink";
+    } else if (_channel) {
+        ch = _channel;
+        source = "gespeichert";
+    } else {
+        ch = CHAN_DEFAULT;
+        source = "Standard";
+    }
+    Serial.printf("[MESH] Startkanal %u (%s)\n", ch, source);
+    return ch;
+}
+
+bool MeshChannel::ownerAlive(uint32_t now) const {
+    if (!_ownerId) return false;
+    return _ownerId == _nodeId || now - _ownerSeen < CHAN_OWNER_TIMEOUT_MS;
+}
+
+void MeshChannel::persist() {
+    Preferences prefs;
+    prefs.begin("swarm", false);
+    if (prefs.getUChar("chan", 0) != _channel) prefs.putUChar("chan", _channel);
+    if (prefs.getULong("chanEp", 0) != _epoch) prefs.putULong("chanEp", _epoch);
+    prefs.end();
+}
+
+void MeshChannel::applied(uint8_t ch, uint32_t now) {
+    if (ch != _channel) {
+        if (_channel) _stats.movesApplied++;
+        _channel = ch;
+        _channelSince = now;
+        Serial.printf("[MESH] Mesh läuft auf Kanal %u (Epoche %u)\n", ch, _epoch);
+    }
+    if (_pendingCh == ch) _pendingCh = 0;
+    persist();
+}
+
+MeshChannel::Action MeshChannel::poll(uint32_t now, bool uplink, uint8_t uplinkChannel, size_t meshLinks, uint8_t& ch) {
+    // Angekündigter Wechsel ist fällig
+    if (_pendingCh && (int32_t)(now - _pendingAt) >= 0) {
+        ch = _pendingCh;
+        return SWITCH;
+    }
+
+    // Geplanter Wechsel: Station noch nicht umgezogen, das Mesh hört die Ankündigung noch
+    if (_proposedCh && !uplink && !_pendingCh) {
+        uint8_t target = _proposedCh;
+        _proposedCh = 0;
+        if (target != _channel) {
+            if (ownerAlive(now) && !isOwner()) {
+                // Ein anderer Knoten führt den Kanal: Mesh hat Vorrang vor unserem Uplink
+                _yieldUntil = (now + CHAN_YIELD_MS) | 1;
+                _stats.uplinkYields++;
+                Serial.printf("[WLAN] Uplink nur auf Kanal %u, Mesh wird von %u geführt. Uplink pausiert.\n", target, _ownerId);
+                return NONE;
+            }
+            if (_channelSince && now - _channelSince < CHAN_MIN_DWELL_MS) {
+                _stats.movesDeferred++;
+                return NONE;
+            }
+            _epoch++;
+            _ownerId = _nodeId;
+            _lastHb = now;
+            _pendingCh = target;
+            _pendingAt = now + CHAN_MOVE_DELAY_MS;
+            _stats.movesSent++;
+            ch = target;
+            Serial.printf("[MESH] Uplink nur auf Kanal %u, kündige Wechsel an (Epoche %u)\n", ch, _epoch);
+            return ANNOUNCE;
+        }
+    }
+
+    if (isOwner() && !uplink && !_pendingCh) {
+        Serial.println("[MESH] Uplink weg, gebe Kanal-Führung ab.");
+        _ownerId = 0;
+    }
+
+    if (uplink && uplinkChannel == _channel) {
+        _driftSince = 0;
+        _deferred = false;
+        if (!ownerAlive(now)) {
+            // Niemand führt den Kanal: wir übernehmen, der Kanal bleibt
+            _epoch++;
+            _ownerId = _nodeId;
+            _lastHb = now - CHAN_HB_MS;
+            persist();
+            Serial.printf("[MESH] Übernehme Kanal-Führung (Kanal %u, Epoche %u)\n", _channel, _epoch);
+        }
+        if (isOwner() && now - _lastHb >= CHAN_HB_MS) {
+            _lastHb = now;
+            ch = _channel;
+            return HEARTBEAT;
+        }
+    } else if (uplink && !_pendingCh) {
+        // Uplink liegt auf einem anderen Kanal (AP hat gewechselt oder isolierter Knoten): der Soft-AP ist
+        // schon mitgezogen, CHAN_MOVE erreicht nur Knoten, die ebenfalls dort sind
+        if (!_driftSince) _driftSince = now | 1;
+        if (now - _driftSince < CHAN_SETTLE_MS) return NONE;
+        if (ownerAlive(now) && !isOwner()) {
+            // Ein anderer Knoten führt den Kanal: Mesh hat Vorrang vor unserem Uplink
+            _driftSince = 0;
+            _yieldUntil = (now + CHAN_YIELD_MS) | 1;
+            _stats.uplinkYields++;
+            ch = _channel;
+            return YIELD;
+        }
+        if (_channelSince && now - _channelSince < CHAN_MIN_DWELL_MS) {
+            if (!_deferred) _stats.movesDeferred++;
+            _deferred = true;
+            return NONE;
+        }
+        _driftSince = 0;
+        _deferred = false;
+        _epoch++;
+        _ownerId = _nodeId;
+        _lastHb = now;
+        _pendingCh = uplinkChannel;
+        _pendingAt = now + CHAN_MOVE_DELAY_MS;
+        _stats.movesSent++;
+        ch = uplinkChannel;
+        Serial.printf("[MESH] Uplink auf Kanal %u, kündige Wechsel an (Epoche %u)\n", ch, _epoch);
+        return ANNOUNCE;
+    } else if (!uplink) {
+        _driftSince = 0;
+    }
+
+    // Ohne Uplink und ohne Nachbarn: Wechsel verpasst? Alle Kanäle absuchen, mit Backoff
+    if (!uplink && meshLinks == 0) {
+        if (!_isolatedSince) {
+            _isolatedSince = now | 1;
+        } else if (now - _isolatedSince >= _rescanDelay) {
+            _isolatedSince = now | 1;
+            _rescanDelay = min((uint32_t)CHAN_ISOLATED_MAX_MS, _rescanDelay * 2);
+            _stats.rescans++;
+            ch = _channel;
+            return RESCAN;
+        }
+    } else {
+        _isolatedSince = 0;
+        _rescanDelay = CHAN_ISOLATED_MS;
+    }
+    return NONE;
+}
+
+void MeshChannel::handleAnnounce(uint32_t from, uint8_t ch, uint32_t epoch, uint32_t inMs, uint32_t now) {
+    if (!ch || ch > 14) return;
+    bool sameOwner = epoch == _epoch && from == _ownerId;
+    bool newer = epoch > _epoch || (epoch == _epoch && !sameOwner && (from < _ownerId || !ownerAlive(now)));
+    if (!sameOwner && !newer) {
+        _stats.movesIgnored++;
+        return;
+    }
+    if (newer && isOwner()) Serial.printf("[MESH] Kanal-Führung geht an %u\n", from);
+    _epoch = epoch;
+    _ownerId = from;
+    _ownerSeen = now;
+    _driftSince = 0;
+    if (ch == _channel) {
+        _pendingCh = 0;
+    } else if (_pendingCh != ch) {
+        // Auch ein CHAN_HB auf fremdem Kanal bedeutet: Wechsel verpasst, sofort nachziehen
+        _pendingCh = ch;
+        _pendingAt = now + min(inMs, (uint32_t)CHAN_MOVE_DELAY_MS);
+        Serial.printf("[MESH] Kanalwechsel auf %u in %u ms (von %u, Epoche %u)\n", ch, _pendingAt - now, from, epoch);
+    }
+}
+
+String MeshChannel::statusText(uint32_t now) const {
+    String out = "Kanal " + String(_channel) + " seit " + String((now - _channelSince) / 1000) + " s, Epoche " + String(_epoch);
+    if (isOwner()) out += ", Führer: selbst";
+    else if (ownerAlive(now)) out += ", Führer: " + String(_ownerId);
+    else out += ", kein Führer";
+    if (_pendingCh) out += ", Wechsel auf " + String(_pendingCh) + " angekündigt";
+    if (uplinkBlocked(now)) out += ", Uplink pausiert";
+    out += "<br>Wechsel: " + String(_stats.movesSent) + " angekündigt, " + String(_stats.movesApplied) + " übernommen, "
+         + String(_stats.movesIgnored) + " veraltet, " + String(_stats.movesDeferred) + " verschoben";
+    out += "<br>Station: " + String(_stats.staConnects) + " Verbindungen, " + String(_stats.staDrops) + " Abbrüche";
+    if (_stats.staDrops) out += " (zuletzt Grund " + String(_stats.lastDropReason) + ")";
+    out += "<br>Mesh-Änderungen: " + String(_stats.meshChanges) + ", Uplink abgegeben: " + String(_stats.uplinkYields)
+         + ", Suchläufe: " + String(_stats.rescans);
+    return out;
+}
+
+uint8_t MeshChannel::scanForMesh(const char* meshSsid) {
+    int n = WiFi.scanNetworks(false, false, false, 120);
+    uint8_t best = 0;
+    int32_t bestRssi = INT32_MIN;
+    for (int i = 0; i < n; i++) {
+        if (WiFi.SSID(i) != meshSsid || WiFi.RSSI(i) <= bestRssi) continue;
+        bestRssi = WiFi.RSSI(i);
+        best = WiFi.channel(i);
+    }
+    WiFi.scanDelete();
+    if (best) Serial.printf("[MESH] Mesh gefunden auf Kanal %u (%d dBm)\n", best, bestRssi);
+    return best;
+}
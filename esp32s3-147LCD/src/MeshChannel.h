@@ -0,0 +1,105 @@
+#ifndef MESH_CHANNEL_H
+#define MESH_CHANNEL_H
+
+#include <Arduino.h>
+
+// =====================
+// MESH KANAL / KOEXISTENZ
+// =====================
+
+#define CHAN_DEFAULT 1                  // Ohne Uplink, Mesh und gespeicherten Kanal
+#define CHAN_SETTLE_MS 5000             // Uplink muss so lange auf einem anderen Kanal bleiben (Roaming)
+#define CHAN_MOVE_DELAY_MS 3000         // Vorlauf, damit CHAN_MOVE alle Knoten erreicht
+#define CHAN_MIN_DWELL_MS 60000         // Frühestens so oft den Mesh-Kanal wechseln
+#define CHAN_HB_MS 30000                // CHAN_HB des Kanal-Führers
+#define CHAN_OWNER_TIMEOUT_MS 100000    // Führer gilt nach ~3 verpassten CHAN_HB als weg
+#define CHAN_YIELD_MS 600000            // Unterlegener Uplink pausiert so lange
+#define CHAN_ISOLATED_MS 60000          // Ohne Mesh-Verbindung danach alle Kanäle absuchen
+#define CHAN_ISOLATED_MAX_MS 600000     // Obergrenze für den Abstand der Suchläufe
+
+/**
+ * Gemeinsamer Funkkanal für Station (Uplink) und Mesh-Soft-AP.
+ *
+ * Beide teilen sich ein Radio: verbindet sich die Station mit einem AP, zieht
+ * der Soft-AP auf dessen Kanal um, und painlessMesh sucht Nachbarn nur auf dem
+ * Kanal aus init(). Deshalb führt genau ein Knoten mit Uplink (der Kanal-Führer)
+ * den Kanal des Meshs und meldet ihn per CHAN_HB. Solange das Mesh Nachbarn hat,
+ * verbindet sich die Station nur mit APs auf dem Mesh-Kanal. Ist der Uplink nur
+ * auf einem anderen Kanal erreichbar (proposeMove), kündigt der Knoten mit
+ * CHAN_MOVE einen gemeinsamen Wechsel an, solange er noch auf dem alten Kanal
+ * ist (höhere Epoche gewinnt, bei gleicher Epoche die niedrigere Knoten-ID).
+ * Andere Knoten, deren Uplink auf einem fremden Kanal liegt, geben den Uplink
+ * vorübergehend auf und bleiben im Mesh.
+ *
+ * Wechselt der AP selbst den Kanal (oder verbindet sich ein isolierter Knoten),
+ * liegt der Soft-AP schon auf dem neuen Kanal, bevor CHAN_MOVE gesendet ist; die
+ * Ankündigung erreicht das alte Mesh dann nicht. Diesen Fall fängt nur die Suche
+ * der isolierten Knoten auf allen Kanälen (CHAN_ISOLATED_MS, mit Backoff) auf.
+ * Der vereinbarte Kanal steht im NVS.
+ */
+class MeshChannel {
+public:
+    enum Action { NONE, ANNOUNCE, HEARTBEAT, SWITCH, YIELD, RESCAN };
+
+    struct Stats {
+        uint32_t staConnects = 0;
+        uint32_t staDrops = 0;      // Station-Abbrüche (Uplink oder Mesh-Elternknoten)
+        uint8_t lastDropReason = 0;
+        uint32_t meshChanges = 0;   // geänderte Mesh-Verbindungen
+        uint32_t movesSent = 0;
+        uint32_t movesApplied = 0;
+        uint32_t movesIgnored = 0;  // veraltete Ankündigungen
+        uint32_t movesDeferred = 0; // wegen CHAN_MIN_DWELL_MS verschoben
+        uint32_t uplinkYields = 0;
+        uint32_t rescans = 0;
+    };
+
+    void begin(uint32_t nodeId) { _nodeId = nodeId; }
+    // Startkanal: vorhandenes Mesh > Uplink > gespeicherter Kanal (NVS) > CHAN_DEFAULT
+    uint8_t bootChannel(uint8_t uplinkChannel, uint8_t meshChannel);
+    // Einmal pro Sekunde; ch liefert den Kanal zu ANNOUNCE/HEARTBEAT/SWITCH/RESCAN-Ergebnis
+    Action poll(uint32_t now, bool uplink, uint8_t uplinkChannel, size_t meshLinks, uint8_t& ch);
+    // Uplink nur auf Kanal ch gefunden, Station nicht verbunden: Wechsel beim nächsten poll() ankündigen
+    void proposeMove(uint8_t ch) { _proposedCh = ch; }
+    // CHAN_MOVE (inMs > 0) und CHAN_HB (inMs = 0)
+    void handleAnnounce(uint32_t from, uint8_t ch, uint32_t epoch, uint32_t inMs, uint32_t now);
+    // Mesh läuft jetzt auf ch
+    void applied(uint8_t ch, uint32_t now);
+
+    bool uplinkBlocked(uint32_t now) const { return _yieldUntil && (int32_t)(_yieldUntil - now) > 0; }
+    uint8_t channel() const { return _channel; }
+    uint32_t epoch() const { return _epoch; }
+    bool isOwner() const { return _ownerId && _ownerId == _nodeId; }
+
+    void noteStaConnected() { _stats.staConnects++; }
+    void noteStaDropped(uint8_t reason) { _stats.staDrops++; _stats.lastDropReason = reason; }
+    void noteMeshChange() { _stats.meshChanges++; }
+    const Stats& stats() const { return _stats; }
+    String statusText(uint32_t now) const;
+
+    // Kanal des stärksten Mesh-APs (SSID = Präfix), 0 = keiner gefunden. Blockiert ~2 s.
+    static uint8_t scanForMesh(const char* meshSsid);
+
+private:
+    uint32_t _nodeId = 0;
+    uint8_t _channel = 0;
+    uint32_t _epoch = 0;
+    uint32_t _channelSince = 0;
+    uint32_t _ownerId = 0;          // Kanal-Führer der aktuellen Epoche
+    uint32_t _ownerSeen = 0;
+    uint32_t _lastHb = 0;
+    uint8_t _pendingCh = 0;         // angekündigter Wechsel
+    uint32_t _pendingAt = 0;
+    uint32_t _driftSince = 0;       // Uplink liegt seitdem auf fremdem Kanal
+    uint8_t _proposedCh = 0;        // Uplink-Kanal aus proposeMove()
+    bool _deferred = false;
+    uint32_t _yieldUntil = 0;
+    uint32_t _isolatedSince = 0;
+    uint32_t _rescanDelay = CHAN_ISOLATED_MS;
+    Stats _stats;
+
+    bool ownerAlive(uint32_t now) const;
+    void persist();
+};
+
+#endif
@@ -0,0 +1,40 @@
+#include "MeshInbox.h"
+
+bool MeshInbox::push(uint32_t from, String& msg, uint32_t nowUs) {
+    if (_count == INBOX_SLOTS) return false;
+    Slot& s = _slots[(_head + _count) % INBOX_SLOTS];
+    s.msg = std::move(msg);
+    s.from = from;
+    s.enqueuedUs = nowUs;
+    _count++;
+    _stats.received++;
+    _stats.maxDepth = max(_stats.maxDepth, _count);
+    return true;
+}
+
+bool MeshInbox::pop(uint32_t& from, String& msg, uint32_t& waitUs, uint32_t nowUs) {
+    if (!_count) return false;
+    Slot& s = _slots[_head];
+    msg = std::move(s.msg);
+    from = s.from;
+    waitUs = nowUs - s.enqueuedUs;
+    _head = (_head + 1) % INBOX_SLOTS;
+    _count--;
+    return true;
+}
+
+void MeshInbox::noteHandled(uint32_t waitUs, uint32_t handleUs) {
+    Stats& s = _stats;
+    s.handled++;
+    s.maxWaitUs = max(s.maxWaitUs, waitUs);
+    s.maxHandleUs = max(s.maxHandleUs, handleUs);
+    s.avgWaitUs = s.handled == 1 ? waitUs : (s.avgWaitUs * 7 + waitUs) / 8;
+    s.avgHandleUs = s.handled == 1 ? handleUs : (s.avgHandleUs * 7 + handleUs) / 8;
+}
+
+String MeshInbox::statusText() const {
+    const Stats& s = _stats;
+    return String(_count) + " wartend (max " + String(s.maxDepth) + "), " + String(s.handled) + " verarbeitet, "
+         + String(s.dropped) + " verworfen (Schlange voll)<br>Wartezeit Ø " + String(s.avgWaitUs) + " µs / max "
+         + String(s.maxWaitUs) + " µs, Behandlung Ø " + String(s.avgHandleUs) + " µs / max " + String(s.maxHandleUs) + " µs";
+}
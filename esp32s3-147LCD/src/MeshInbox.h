@@ -0,0 +1,62 @@
+#ifndef MESH_INBOX_H
+#define MESH_INBOX_H
+
+#include <Arduino.h>
+
+// =====================
+// EMPFANGS-WARTESCHLANGE
+// =====================
+
+#define INBOX_SLOTS 16                  // Gleichzeitig wartende Nachrichten
+#define INBOX_MAX_PER_RUN 4             // Höchstens so viele Nachrichten pro Worker-Lauf
+#define INBOX_BUDGET_US 20000           // Worker gibt danach an mesh.update() zurück
+
+/**
+ * Empfangene Mesh-Nachrichten zwischen Empfangs-Callback und Verarbeitung.
+ *
+ * Der Callback von painlessMesh legt die Nachricht nur ab (der String wird
+ * verschoben, nicht kopiert), geparst und behandelt wird sie später im
+ * Worker-Task. Pro Nachricht werden Wartezeit in der Schlange und Dauer der
+ * Behandlung gemessen. Ist die Schlange voll, wird die neue Nachricht verworfen
+ * und gezählt; der Callback bleibt damit immer kurz. Reliable Broadcasts holt
+ * der Empfänger per NACK nach, periodische Nachrichten kommen ohnehin wieder.
+ */
+class MeshInbox {
+public:
+    struct Stats {
+        uint32_t received = 0;
+        uint32_t handled = 0;
+        uint32_t dropped = 0;       // bei voller Schlange verworfen
+        uint8_t maxDepth = 0;
+        uint32_t avgWaitUs = 0;     // gleitende Mittelwerte (1/8)
+        uint32_t maxWaitUs = 0;
+        uint32_t avgHandleUs = 0;
+        uint32_t maxHandleUs = 0;
+    };
+
+    // Übernimmt den Inhalt von msg; false = Schlange voll
+    bool push(uint32_t from, String& msg, uint32_t nowUs);
+    // Älteste Nachricht nach msg verschieben; waitUs = Zeit in der Schlange
+    bool pop(uint32_t& from, String& msg, uint32_t& waitUs, uint32_t nowUs);
+    void noteHandled(uint32_t waitUs, uint32_t handleUs);
+    void noteDropped() { _stats.dropped++; }
+
+    bool empty() const { return _count == 0; }
+    uint8_t depth() const { return _count; }
+    const Stats& stats() const { return _stats; }
+    String statusText() const;
+
+private:
+    struct Slot {
+        String msg;
+        uint32_t from = 0;
+        uint32_t enqueuedUs = 0;
+    };
+
+    Slot _slots[INBOX_SLOTS];
+    uint8_t _head = 0;
+    uint8_t _count = 0;
+    Stats _stats;
+};
+
+#endif
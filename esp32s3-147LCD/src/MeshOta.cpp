@@ -0,0 +1,369 @@
+#include "MeshOta.h"
+
+#include <mbedtls/base64.h>
+
+// --- MeshOta ---
+
+void MeshOta::begin(SendSingleFn sendSingle, BroadcastFn broadcast, HopsFn hops, uint8_t* scratch) {
+    _sendSingle = sendSingle;
+    _broadcast = broadcast;
+    _hops = hops;
+    _scratch = scratch;
+    if (!_scratch) {
+        Serial.println("[OTA] Kein Transferpuffer, Mesh-OTA deaktiviert.");
+        return;
+    }
+
+    _gen = _storage.generation();
+    String hash;
+    uint32_t size, next;
+    if (_storage.installed(hash, size)) {
+        _hash = hash;
+        _size = size;
+        _state = INSTALLED;
+        Serial.println("[OTA] Laufendes Image " + _hash.substring(0, 8) + " (Gen. " + String(_gen) + ") wird als Quelle angeboten.");
+    } else if (_storage.loadProgress(hash, size, next) && hash.length() == 64) {
+        // Unterbrochener Empfang: ab dem letzten gesicherten Chunk fortsetzen
+        _hash = hash;
+        _size = size;
+        _next = next;
+        _state = RECEIVING;
+        Serial.printf("[OTA] Setze Empfang fort bei Chunk %u/%u\n", _next, chunkCount());
+    }
+}
+
+bool MeshOta::loop(uint32_t now) {
+    if (_jobDone) finishFlashJob(now);
+
+    // Solange der Worker schreibt oder prüft, wird nichts neu angefordert
+    if (_state == RECEIVING && !flashBusy()) {
+        // Ohne Quelle nur im Timeout-Takt neu suchen, sonst sofort den nächsten Chunk holen
+        bool timedOut = now - _reqAt > OTA_REQ_TIMEOUT_MS;
+        if (_awaiting ? timedOut : (_current != 0xFF || timedOut)) requestChunk(now);
+    }
+
+    bool isSource = _state == STAGED || (_state == INSTALLED && now < OTA_INSTALLED_ANNOUNCE_MS);
+    if (isSource && (_lastAnnounce == 0 || now - _lastAnnounce > OTA_ANNOUNCE_MS)) {
+        announce(now);
+    }
+
+    // Erst umschalten, wenn die Nachbarn eine Weile nichts mehr angefragt haben
+    if (_state == STAGED && now - _stagedAt > OTA_SERVE_IDLE_MS && now - _lastServed > OTA_SERVE_IDLE_MS) {
+        if (_storage.activate()) {
+            _storage.setInstalled(_hash, _size);
+            _storage.saveProgress("", 0, 0);
+            return true;
+        }
+        Serial.println("[OTA] Aktivierung fehlgeschlagen, Image verworfen.");
+        _state = IDLE;
+        _hash = "";
+    }
+    return false;
+}
+
+bool MeshOta::handleMessage(uint32_t from, JsonDocument& doc, uint32_t now) {
+    const char* type = doc["type"] | "";
+    if (strncmp(type, "OTA_", 4) != 0) return false;
+    if (!_scratch) return true;
+    String h = doc["h"] | "";
+
+    if (strcmp(type, "OTA_HAVE") == 0) {
+        uint32_t gen = doc["g"] | 0;
+        if (h.length() != 64 || gen == 0) return true;
+        if (gen > _seenGen) _seenGen = gen;
+        if (_state == RECEIVING && h == _hash && gen == _gen) {
+            addSource(from);
+        } else if ((_state == IDLE || _state == INSTALLED) && gen > _gen && h != _hash && !_uploading && !flashBusy()) {
+            // Nur echt neuere Images; RECEIVING und STAGED bleiben bei ihrem Image
+            uint32_t size = doc["sz"] | 0;
+            if (size == 0 || size > _storage.capacity()) return true;
+            String savedHash;
+            uint32_t savedSize, savedNext;
+            bool resume = _storage.loadProgress(savedHash, savedSize, savedNext) && savedHash == h && savedSize == size;
+            _hash = h;
+            _gen = gen;
+            _size = size;
+            _next = resume ? savedNext : 0;
+            for (Source& s : _sources) s = Source();
+            _current = 0xFF;
+            _awaiting = false;
+            _state = RECEIVING;
+            _storage.setGeneration(_gen);
+            addSource(from);
+            Serial.printf("[OTA] Neues Image %s (Gen. %u, %u B) von %u angeboten, starte bei Chunk %u\n", _hash.substring(0, 8).c_str(), _gen, _size, from, _next);
+        }
+    } else if (strcmp(type, "OTA_REQ") == 0) {
+        if ((_state == STAGED || _state == INSTALLED) && h == _hash) {
+            serveChunk(from, doc["i"] | 0, now);
+        }
+    } else if (strcmp(type, "OTA_DATA") == 0) {
+        if (_state == RECEIVING && h == _hash) {
+            acceptChunk(doc["i"] | 0, doc["d"] | "", now);
+        }
+    }
+    return true;
+}
+
+bool MeshOta::uploadStart() {
+    if (!_scratch || flashBusy()) return false;
+    mbedtls_sha256_init(&_uploadSha);
+    mbedtls_sha256_starts(&_uploadSha, 0);
+    _uploadLen = 0;
+    _uploading = true;
+    _state = IDLE;
+    Serial.println("[OTA] Upload gestartet.");
+    return true;
+}
+
+bool MeshOta::uploadWrite(const uint8_t* data, size_t len) {
+    if (!_uploading) return false;
+    if (!_storage.write(_uploadLen, data, len)) {
+        Serial.println("[OTA] Schreibfehler beim Upload, abgebrochen.");
+        mbedtls_sha256_free(&_uploadSha);
+        _uploading = false;
+        return false;
+    }
+    mbedtls_sha256_update(&_uploadSha, data, len);
+    _uploadLen += len;
+    return true;
+}
+
+bool MeshOta::uploadFinish(uint32_t now) {
+    if (!_uploading) return false;
+    uint8_t digest[32];
+    mbedtls_sha256_finish(&_uploadSha, digest);
+    mbedtls_sha256_free(&_uploadSha);
+    _uploading = false;
+
+    _hash = toHex(digest);
+    _size = _uploadLen;
+    if (_size == 0) {
+        Serial.println("[OTA] Upload ist leer.");
+        _hash = "";
+        return false;
+    }
+    // Zurückgelesen geprüft wird im Worker, Quelle erst danach (finishFlashJob)
+    _jobUpload = true;
+    submitFlashJob(JOB_VERIFY, now);
+    return true;
+}
+
+bool MeshOta::runFlashJob() {
+    if (!_jobPending) return false;
+    uint32_t start = millis();
+    if (_job == JOB_WRITE) {
+        _jobOk = _storage.write(_jobOffset, _scratch, _jobLen);
+        if (_jobOk && _jobSave) _storage.saveProgress(_hash, _size, _jobOffset / OTA_CHUNK_SIZE + 1);
+    } else {
+        _jobOk = verifyStaged();
+        if (_jobOk && _jobUpload) {
+            // Neuer als alles, was dieser Knoten im Mesh gesehen hat
+            _gen = max(_gen, _seenGen) + 1;
+            _storage.setGeneration(_gen);
+        }
+        if (_jobOk) _storage.saveProgress("", 0, 0);
+        else if (!_jobUpload) _storage.saveProgress(_hash, _size, 0);
+    }
+    _flashJobs++;
+    _flashMaxMs = max(_flashMaxMs, millis() - start);
+    _jobDone = true;
+    _jobPending = false;
+    return true;
+}
+
+String MeshOta::statusText() const {
+    String id = _hash.substring(0, 8) + " (Gen. " + String(_gen) + ")";
+    switch (_state) {
+        case RECEIVING: {
+            String out = "Empfange " + id + ": " + String(_next) + "/" + String(chunkCount()) + " Chunks";
+            if (_next >= chunkCount() && flashBusy()) return out + ", prüfe SHA-256...";
+            if (_current != 0xFF) out += " (Quelle " + String(_sources[_current].id) + ", " + String(_sources[_current].hops) + " Hops)";
+            else out += " (keine Quelle)";
+            return out;
+        }
+        case STAGED:    return "Image " + id + " geprüft, verteile an Nachbarn (Flash-Worker: " + String(_flashJobs) + " Aufträge, max " + String(_flashMaxMs) + " ms)";
+        case INSTALLED: return "Läuft: " + id;
+        default:        return "Kein Update aktiv";
+    }
+}
+
+// --- Intern ---
+
+void MeshOta::addSource(uint32_t id) {
+    Source* free = nullptr;
+    for (Source& s : _sources) {
+        if (s.id == id) return;
+        if (s.id == 0 && !free) free = &s;
+    }
+    if (!free) return;
+    free->id = id;
+    int hops = _hops ? _hops(id) : -1;
+    free->hops = hops < 0 ? 0xFF : hops;
+    // Näher gelegene Quelle ab dem nächsten Chunk bevorzugen
+    if (_current == 0xFF || free->hops < _sources[_current].hops) _current = 0xFF;
+}
+
+bool MeshOta::pickSource() {
+    _current = 0xFF;
+    for (uint8_t i = 0; i < OTA_MAX_SOURCES; i++) {
+        Source& s = _sources[i];
+        if (s.id == 0) continue;
+        int hops = _hops ? _hops(s.id) : -1;
+        if (hops < 0) { s = Source(); continue; }   // nicht mehr im Mesh
+        s.hops = hops;
+        if (_current == 0xFF || s.hops < _sources[_current].hops) _current = i;
+    }
+    return _current != 0xFF;
+}
+
+void MeshOta::requestChunk(uint32_t now) {
+    if (_awaiting && ++_tries >= OTA_REQ_RETRIES) {
+        // Quelle antwortet nicht: verwerfen und nächste nehmen
+        if (_current != 0xFF) _sources[_current] = Source();
+        _current = 0xFF;
+        _tries = 0;
+    }
+    _awaiting = false;
+    if (_current == 0xFF && !pickSource()) { _reqAt = now; return; }
+
+    JsonDocument req;
+    req["type"] = "OTA_REQ";
+    req["h"] = _hash;
+    req["i"] = _next;
+    String out; serializeJson(req, out);
+    _sendSingle(_sources[_current].id, out);
+    _awaiting = true;
+    _reqAt = now;
+}
+
+void MeshOta::serveChunk(uint32_t from, uint32_t index, uint32_t now) {
+    // _scratch gehört gerade dem Worker: der Anfragende wiederholt nach dem Timeout
+    if (index >= chunkCount() || flashBusy()) return;
+    uint32_t offset = index * OTA_CHUNK_SIZE;
+    size_t len = min((uint32_t)OTA_CHUNK_SIZE, _size - offset);
+
+    uint8_t* raw = _scratch;
+    unsigned char* b64 = _scratch + OTA_CHUNK_SIZE;
+    bool ok = (_state == STAGED) ? _storage.readStaged(offset, raw, len) : _storage.readRunning(offset, raw, len);
+    if (!ok) return;
+
+    size_t olen = 0;
+    if (mbedtls_base64_encode(b64, OTA_B64_SIZE, &olen, raw, len) != 0) return;
+    b64[olen] = 0;
+
+    JsonDocument doc;
+    doc["type"] = "OTA_DATA";
+    doc["h"] = _hash;
+    doc["i"] = index;
+    doc["d"] = (const char*)b64;
+    String out; serializeJson(doc, out);
+    _sendSingle(from, out);
+    _lastServed = now;
+}
+
+void MeshOta::acceptChunk(uint32_t index, const char* b64, uint32_t now) {
+    if (index != _next || flashBusy()) return;     // Duplikat, veraltete Antwort oder Chunk wird noch geschrieben
+
+    uint32_t offset = index * OTA_CHUNK_SIZE;
+    size_t expected = min((uint32_t)OTA_CHUNK_SIZE, _size - offset);
+    uint8_t* raw = _scratch;
+    size_t olen = 0;
+    if (mbedtls_base64_decode(raw, OTA_CHUNK_SIZE, &olen, (const unsigned char*)b64, strlen(b64)) != 0 || olen != expected) return;
+
+    _awaiting = false;
+    _jobOffset = offset;
+    _jobLen = olen;
+    _jobSave = (index + 1) % OTA_PROGRESS_EVERY == 0;
+    submitFlashJob(JOB_WRITE, now);
+}
+
+void MeshOta::submitFlashJob(FlashJob job, uint32_t now) {
+    _job = job;
+    _jobDone = false;
+    _jobPending = true;
+    if (_kick) {
+        _kick();
+        return;
+    }
+    // Kein Worker: direkt hier erledigen
+    runFlashJob();
+    finishFlashJob(now);
+}
+
+void MeshOta::finishFlashJob(uint32_t now) {
+    _jobDone = false;
+    if (_job == JOB_WRITE) {
+        if (!_jobOk) {
+            // Wie eine ausbleibende Antwort: nach dem Timeout erneut, ggf. von anderer Quelle
+            Serial.println("[OTA] Flash-Schreibfehler bei Chunk " + String(_next));
+            _awaiting = true;
+            return;
+        }
+        _next++;
+        _tries = 0;
+        if (_next >= chunkCount()) {
+            _jobUpload = false;
+            submitFlashJob(JOB_VERIFY, now);
+        }
+        // Sonst fordert loop() gleich den nächsten Chunk an
+        return;
+    }
+
+    if (_jobOk) {
+        becomeStaged(now);
+    } else if (_jobUpload) {
+        Serial.println("[OTA] Upload konnte nicht verifiziert werden.");
+        _state = IDLE;
+        _hash = "";
+    } else {
+        Serial.println("[OTA] SHA-256 stimmt nicht, Empfang beginnt von vorn.");
+        _next = 0;
+    }
+}
+
+bool MeshOta::verifyStaged() {
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts(&ctx, 0);
+    uint8_t* buf = _scratch;
+    bool ok = true;
+    for (uint32_t offset = 0; offset < _size; offset += OTA_CHUNK_SIZE) {
+        size_t len = min((uint32_t)OTA_CHUNK_SIZE, _size - offset);
+        if (!_storage.readStaged(offset, buf, len)) { ok = false; break; }
+        mbedtls_sha256_update(&ctx, buf, len);
+    }
+    uint8_t digest[32];
+    mbedtls_sha256_finish(&ctx, digest);
+    mbedtls_sha256_free(&ctx);
+    return ok && toHex(digest) == _hash;
+}
+
+void MeshOta::announce(uint32_t now) {
+    JsonDocument doc;
+    doc["type"] = "OTA_HAVE";
+    doc["h"] = _hash;
+    doc["g"] = _gen;
+    doc["sz"] = _size;
+    String out; serializeJson(doc, out);
+    _broadcast(out);
+    _lastAnnounce = now | 1;
+}
+
+void MeshOta::becomeStaged(uint32_t now) {
+    _state = STAGED;
+    _stagedAt = now;
+    _lastServed = now;
+    Serial.printf("[OTA] Image %s (Gen. %u, %u B) verifiziert, bin jetzt Quelle.\n", _hash.substring(0, 8).c_str(), _gen, _size);
+    announce(now);
+}
+
+String MeshOta::toHex(const uint8_t* digest) {
+    static const char hex[] = "0123456789abcdef";
+    char out[65];
+    for (int i = 0; i < 32; i++) {
+        out[i * 2] = hex[digest[i] >> 4];
+        out[i * 2 + 1] = hex[digest[i] & 0x0F];
+    }
+    out[64] = 0;
+    return String(out);
+}
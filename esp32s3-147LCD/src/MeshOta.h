@@ -0,0 +1,196 @@
+#ifndef MESH_OTA_H
+#define MESH_OTA_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <functional>
+#include <mbedtls/sha256.h>
+
+// =====================
+// MESH OTA
+// =====================
+
+#define OTA_CHUNK_SIZE 1024                 // Rohdaten pro OTA_DATA (Base64 ~1.4 KB)
+#define OTA_MAX_SOURCES 8                   // Gemerkte Quellen pro Image
+#define OTA_REQ_TIMEOUT_MS 3000             // Warten auf OTA_DATA
+#define OTA_REQ_RETRIES 3                   // Danach wird die Quelle gewechselt
+#define OTA_ANNOUNCE_MS 15000               // OTA_HAVE Intervall solange wir Quelle sind
+#define OTA_INSTALLED_ANNOUNCE_MS 1800000UL // Nach Neustart noch 30 min als Quelle melden
+#define OTA_SERVE_IDLE_MS 60000             // Ohne Anfragen so lange warten, dann umschalten
+#define OTA_PROGRESS_EVERY 16               // Fortschritt alle n Chunks im NVS sichern
+#define OTA_WORKER_STACK 4096
+#define OTA_WORKER_PRIO 1                   // wie der Config-Writer: unter Loop und WLAN
+#define OTA_B64_SIZE (((OTA_CHUNK_SIZE + 2) / 3) * 4 + 1)
+#define OTA_SCRATCH_SIZE (OTA_CHUNK_SIZE + OTA_B64_SIZE)  // Transferpuffer: Rohdaten + Base64
+
+/**
+ * Zugriff auf die OTA-Partition und den persistenten Fortschritt.
+ * Als Interface getrennt, damit die Verteilung auch mit gemocktem Flash laufen kann.
+ */
+class OtaStorage {
+public:
+    virtual ~OtaStorage() {}
+    virtual uint32_t capacity() = 0;
+    // Schreibt sequentiell; Sektoren werden beim ersten Betreten gelöscht
+    virtual bool write(uint32_t offset, const uint8_t* data, size_t len) = 0;
+    virtual bool readStaged(uint32_t offset, uint8_t* data, size_t len) = 0;
+    virtual bool readRunning(uint32_t offset, uint8_t* data, size_t len) = 0;
+    // otadata auf die Staging-Partition umschalten
+    virtual bool activate() = 0;
+
+    virtual bool loadProgress(String& hash, uint32_t& size, uint32_t& next) = 0;
+    virtual void saveProgress(const String& hash, uint32_t size, uint32_t next) = 0;
+    virtual bool installed(String& hash, uint32_t& size) = 0;
+    virtual void setInstalled(const String& hash, uint32_t size) = 0;
+    // Höchste übernommene Image-Generation, bleibt auch nach einem Rollback stehen
+    virtual uint32_t generation() = 0;
+    virtual void setGeneration(uint32_t gen) = 0;
+};
+
+/** OtaStorage auf Basis von esp_partition/esp_ota und Preferences (NVS). */
+class EspOtaStorage : public OtaStorage {
+public:
+    uint32_t capacity() override;
+    bool write(uint32_t offset, const uint8_t* data, size_t len) override;
+    bool readStaged(uint32_t offset, uint8_t* data, size_t len) override;
+    bool readRunning(uint32_t offset, uint8_t* data, size_t len) override;
+    bool activate() override;
+    bool loadProgress(String& hash, uint32_t& size, uint32_t& next) override;
+    void saveProgress(const String& hash, uint32_t size, uint32_t next) override;
+    bool installed(String& hash, uint32_t& size) override;
+    void setInstalled(const String& hash, uint32_t size) override;
+    uint32_t generation() override;
+    void setGeneration(uint32_t gen) override;
+};
+
+/** Verwirft Schreibzugriffe und liest Nullen: für die Trace-Wiedergabe ohne Flash-Zugriff. */
+class DryRunOtaStorage : public OtaStorage {
+public:
+    uint32_t capacity() override { return 0x400000; }
+    bool write(uint32_t, const uint8_t*, size_t) override { return true; }
+    bool readStaged(uint32_t, uint8_t* data, size_t len) override { memset(data, 0, len); return true; }
+    bool readRunning(uint32_t, uint8_t* data, size_t len) override { memset(data, 0, len); return true; }
+    bool activate() override { return false; }
+    bool loadProgress(String&, uint32_t&, uint32_t&) override { return false; }
+    void saveProgress(const String&, uint32_t, uint32_t) override {}
+    bool installed(String&, uint32_t&) override { return false; }
+    void setInstalled(const String&, uint32_t) override {}
+    uint32_t generation() override { return 0; }
+    void setGeneration(uint32_t) override {}
+};
+
+/**
+ * Verteilt ein Firmware-Image chunkweise über das Mesh.
+ *
+ * Ein Knoten erhält das Image per Upload am Admin-Server. Jeder Knoten, der das
+ * Image vollständig und per SHA-256 geprüft hat, meldet sich mit OTA_HAVE als
+ * Quelle. Empfänger holen Chunks (OTA_REQ/OTA_DATA) bevorzugt von der Quelle mit
+ * den wenigsten Hops, so entsteht ein Verteilbaum statt eines Sterns um den Root.
+ *
+ * Jedes Image trägt eine Generation (Upload: höchste bekannte + 1). Übernommen wird
+ * nur eine echt neuere Generation und nur aus IDLE/INSTALLED; ein Knoten, der gerade
+ * empfängt oder selbst Quelle (STAGED) ist, bleibt bei seinem Image. Damit gibt es
+ * weder Downgrades noch ein Hin und Her zwischen zwei gleichzeitig angebotenen Images.
+ *
+ * Flash-Arbeit (Chunk schreiben samt Sektor-Löschen, Fortschritt im NVS, SHA-256 über
+ * die Partition) läuft als Auftrag im Flash-Worker. Der Empfangspfad dekodiert nur und
+ * übergibt; erst wenn der Auftrag fertig ist, fordert loop() den nächsten Chunk an.
+ * Ohne Worker (Host-Test, Trace-Wiedergabe) wird der Auftrag sofort im Aufrufer erledigt.
+ */
+class MeshOta {
+public:
+    enum State { IDLE, RECEIVING, STAGED, INSTALLED };
+
+    typedef std::function<void(uint32_t, const String&)> SendSingleFn;
+    typedef std::function<void(const String&)> BroadcastFn;
+    typedef std::function<int(uint32_t)> HopsFn;    // -1 = nicht erreichbar
+    typedef std::function<void()> KickFn;
+
+    explicit MeshOta(OtaStorage& storage) : _storage(storage) {}
+
+    // scratch: Transferpuffer mit OTA_SCRATCH_SIZE Bytes (vom Aufrufer platziert, z.B. im PSRAM)
+    void begin(SendSingleFn sendSingle, BroadcastFn broadcast, HopsFn hops, uint8_t* scratch);
+    // Eigener FreeRTOS-Task für die Flash-Arbeit (EspOtaStorage.cpp, nur auf dem Gerät)
+    void startWorker();
+    // Flash-Aufträge an einen Worker übergeben; kick weckt ihn, er ruft runFlashJob()
+    void setWorker(KickFn kick) { _kick = kick; }
+    // Im Worker: offenen Auftrag ausführen; true = es lag einer an
+    bool runFlashJob();
+    // Auftrag erledigt, loop() soll ihn abschließen (Hauptschleife nicht schlafen lassen)
+    bool flashDone() const { return _jobDone; }
+    bool flashBusy() const { return _jobPending || _jobDone; }
+
+    // true = Image aktiviert, Neustart erforderlich
+    bool loop(uint32_t now);
+    // true = Nachricht war OTA_* und wurde verarbeitet
+    bool handleMessage(uint32_t from, JsonDocument& doc, uint32_t now);
+
+    // Upload über den Admin-Server
+    bool uploadStart();
+    bool uploadWrite(const uint8_t* data, size_t len);
+    bool uploadFinish(uint32_t now);
+
+    State state() const { return _state; }
+    String statusText() const;
+
+private:
+    struct Source {
+        uint32_t id = 0;
+        uint8_t hops = 0xFF;
+    };
+
+    OtaStorage& _storage;
+    SendSingleFn _sendSingle;
+    BroadcastFn _broadcast;
+    HopsFn _hops;
+    uint8_t* _scratch = nullptr;
+    KickFn _kick;
+
+    State _state = IDLE;
+    String _hash;
+    uint32_t _gen = 0;              // Generation von _hash, zugleich Untergrenze für neue Images
+    uint32_t _seenGen = 0;          // Höchste per OTA_HAVE gesehene Generation
+    uint32_t _size = 0;
+    uint32_t _next = 0;             // nächster erwarteter Chunk
+    Source _sources[OTA_MAX_SOURCES];
+    uint8_t _current = 0xFF;        // Index in _sources
+    uint8_t _tries = 0;
+    uint32_t _reqAt = 0;
+    bool _awaiting = false;
+    uint32_t _lastAnnounce = 0;
+    uint32_t _stagedAt = 0;
+    uint32_t _lastServed = 0;
+
+    // Flash-Auftrag: Felder und der Rohdatenteil von _scratch gehören dem Worker,
+    // solange _jobPending gesetzt ist. Nie beide Flags gleichzeitig false, solange er läuft.
+    enum FlashJob : uint8_t { JOB_WRITE, JOB_VERIFY };
+    FlashJob _job = JOB_WRITE;
+    uint32_t _jobOffset = 0;
+    size_t _jobLen = 0;
+    bool _jobSave = false;          // JOB_WRITE: danach Fortschritt sichern
+    bool _jobUpload = false;        // JOB_VERIFY: eigener Upload statt Empfang
+    bool _jobOk = false;
+    volatile bool _jobPending = false;
+    volatile bool _jobDone = false;
+    uint32_t _flashJobs = 0;
+    uint32_t _flashMaxMs = 0;
+
+    mbedtls_sha256_context _uploadSha;
+    uint32_t _uploadLen = 0;
+    bool _uploading = false;
+
+    uint32_t chunkCount() const { return (_size + OTA_CHUNK_SIZE - 1) / OTA_CHUNK_SIZE; }
+    void addSource(uint32_t id);
+    bool pickSource();
+    void requestChunk(uint32_t now);
+    void serveChunk(uint32_t from, uint32_t index, uint32_t now);
+    void acceptChunk(uint32_t index, const char* b64, uint32_t now);
+    void submitFlashJob(FlashJob job, uint32_t now);
+    void finishFlashJob(uint32_t now);
+    bool verifyStaged();
+    void announce(uint32_t now);
+    void becomeStaged(uint32_t now);
+    static String toHex(const uint8_t* digest);
+};
+
+#endif
@@ -0,0 +1,205 @@
+#include "MeshOutbox.h"
+#include "MeshTrace.h"
+
+#define OUTBOX_KEEP_BYTES 2048  // Kleinere Puffer bleiben im Slot reserviert (weniger Heap-Churn)
+
+struct OutboxPolicy {
+    const char* type;
+    MeshOutbox::Class cls;
+    bool coalesce;              // neuere Nachricht an dasselbe Ziel ersetzt die wartende
+};
+
+// Unbekannte Typen laufen als CONFIG ohne Coalescing
+static const OutboxPolicy POLICIES[] = {
+    {"NACK", MeshOutbox::CONTROL, false},
+    {"BLINK_CMD", MeshOutbox::CONTROL, true},
+    {"TIME_SYNC", MeshOutbox::CONTROL, true},
+    {"TIME_REQ", MeshOutbox::CONTROL, true},
+    {"CHAN_MOVE", MeshOutbox::CONTROL, true},
+    {"CHAN_HB", MeshOutbox::CONTROL, true},
+    {"SEQ_HB", MeshOutbox::CONTROL, true},
+    {"BRIDGE_HB", MeshOutbox::CONTROL, true},
+    {"SYNC_REQ", MeshOutbox::CONFIG, true},
+    {"SYNC_RES", MeshOutbox::CONFIG, true},
+    {"NET_DELTA", MeshOutbox::CONFIG, true},
+    {"OTA_HAVE", MeshOutbox::BULK, true},
+    {"OTA_REQ", MeshOutbox::BULK, false},
+    {"OTA_DATA", MeshOutbox::BULK, false},
+    {"STATUS", MeshOutbox::BULK, true},
+    {"SURVEY", MeshOutbox::BULK, true},
+};
+
+static const int32_t RATE[MeshOutbox::CLASS_COUNT] = {OUTBOX_CONTROL_RATE, OUTBOX_CONFIG_RATE, OUTBOX_BULK_RATE};
+static const int32_t BURST[MeshOutbox::CLASS_COUNT] = {OUTBOX_CONTROL_BURST, OUTBOX_CONFIG_BURST, OUTBOX_BULK_BURST};
+static const char* const CLASS_NAMES[MeshOutbox::CLASS_COUNT] = {"Control", "Config", "Bulk"};
+
+// type zeigt in die Nachricht (nicht nullterminiert)
+static const OutboxPolicy* policyFor(const char* type, size_t len) {
+    if (!type) return nullptr;
+    for (const OutboxPolicy& p : POLICIES) {
+        if (strncmp(type, p.type, len) == 0 && p.type[len] == '\0') return &p;
+    }
+    return nullptr;
+}
+
+MeshOutbox::Class MeshOutbox::classify(const char* type) {
+    const OutboxPolicy* p = policyFor(type, strlen(type));
+    return p ? p->cls : CONFIG;
+}
+
+uint32_t MeshOutbox::keyFor(const char* type, size_t len, uint32_t dest) {
+    uint32_t h = 2166136261UL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (uint8_t)type[i];
+        h *= 16777619UL;
+    }
+    h ^= dest;
+    return h ? h : 1;
+}
+
+void MeshOutbox::begin(SendFn send, StampFn stamp) {
+    _send = send;
+    _stamp = stamp;
+    for (int c = 0; c < CLASS_COUNT; c++) {
+        _queues[c].tokens = BURST[c];
+        _queues[c].refilled = millis();
+    }
+}
+
+int MeshOutbox::allocSlot() {
+    for (int i = 0; i < OUTBOX_SLOTS; i++) {
+        if (!_entries[i].used) return i;
+    }
+    return -1;
+}
+
+int MeshOutbox::findKey(Class cls, uint32_t key) const {
+    const Queue& q = _queues[cls];
+    for (uint8_t i = 0; i < q.count; i++) {
+        uint8_t slot = q.slots[(q.head + i) % OUTBOX_SLOTS];
+        if (_entries[slot].key == key) return slot;
+    }
+    return -1;
+}
+
+bool MeshOutbox::pending(const char* type, uint32_t dest) const {
+    return findKey(classify(type), keyFor(type, strlen(type), dest)) >= 0;
+}
+
+bool MeshOutbox::dropOldest(Class atLeast) {
+    // Platz auf Kosten der unwichtigsten Klasse, nie auf Kosten einer wichtigeren
+    for (int c = BULK; c >= atLeast; c--) {
+        Queue& q = _queues[c];
+        if (!q.count) continue;
+        Entry& e = _entries[q.slots[q.head]];
+        Serial.printf("[MESH] Outbox voll, verwerfe %s-Nachricht (%u B)\n", CLASS_NAMES[c], e.msg.length());
+        e.msg = String();
+        e.used = false;
+        _used--;
+        q.head = (q.head + 1) % OUTBOX_SLOTS;
+        q.count--;
+        _stats[c].dropped++;
+        return true;
+    }
+    return false;
+}
+
+bool MeshOutbox::push(uint32_t dest, const String& msg, uint8_t flags) {
+    // Typ direkt in der Nachricht nachschlagen, ohne String-Kopie (Empfangs-/Antwortpfad ohne Heap)
+    size_t typeLen;
+    const char* type = MeshTrace::findType((const uint8_t*)msg.c_str(), msg.length(), typeLen);
+    const OutboxPolicy* p = policyFor(type, typeLen);
+    Class cls = p ? p->cls : CONFIG;
+    uint32_t key = p && p->coalesce && !(flags & NO_COALESCE) ? keyFor(type, typeLen, dest) : 0;
+
+    if (key) {
+        int slot = findKey(cls, key);
+        if (slot >= 0) {
+            // Platz in der Schlange bleibt, damit ersetzte Nachrichten nicht verhungern
+            _entries[slot].msg = msg;
+            _entries[slot].flags = flags;
+            _stats[cls].coalesced++;
+            return true;
+        }
+    }
+
+    int slot = allocSlot();
+    if (slot < 0 && dropOldest(cls)) slot = allocSlot();
+    if (slot < 0) {
+        _stats[cls].dropped++;
+        return false;
+    }
+    Entry& e = _entries[slot];
+    e.msg = msg;
+    e.dest = dest;
+    e.key = key;
+    e.flags = flags;
+    e.enqueued = millis();
+    e.used = true;
+    _used++;
+    Queue& q = _queues[cls];
+    q.slots[(q.head + q.count) % OUTBOX_SLOTS] = slot;
+    q.count++;
+    return true;
+}
+
+void MeshOutbox::refill(Queue& q, Class cls, uint32_t now) {
+    uint32_t elapsed = min(now - q.refilled, (uint32_t)10000);
+    int32_t add = (int32_t)(elapsed * RATE[cls] / 1000);
+    if (add <= 0) return;
+    q.tokens = min(BURST[cls], q.tokens + add);
+    q.refilled = now;
+}
+
+uint32_t MeshOutbox::service(uint32_t now) {
+    for (int c = 0; c < CLASS_COUNT; c++) refill(_queues[c], (Class)c, now);
+
+    for (uint8_t sent = 0; sent < OUTBOX_MAX_PER_RUN; sent++) {
+        // Strikte Priorität: höchste Klasse mit Nachricht und Guthaben
+        int c = 0;
+        while (c < CLASS_COUNT && !(_queues[c].count && _queues[c].tokens > 0)) c++;
+        if (c == CLASS_COUNT) break;
+
+        Queue& q = _queues[c];
+        Entry& e = _entries[q.slots[q.head]];
+        q.head = (q.head + 1) % OUTBOX_SLOTS;
+        q.count--;
+
+        if (e.flags & RELIABLE) _stamp(e.msg);
+        _send(e.dest, e.msg);
+
+        ClassStats& s = _stats[c];
+        uint32_t wait = now - e.enqueued;
+        s.sent++;
+        s.bytes += e.msg.length();
+        s.maxWaitMs = max(s.maxWaitMs, wait);
+        s.avgWaitMs = s.sent == 1 ? wait : (s.avgWaitMs * 7 + wait) / 8;
+        q.tokens -= e.msg.length();
+
+        if (e.msg.length() > OUTBOX_KEEP_BYTES) e.msg = String();
+        else e.msg = "";
+        e.used = false;
+        _used--;
+    }
+
+    // Nächster Versand: sofort, wenn noch Guthaben da ist, sonst wenn der Bucket wieder positiv wird
+    uint32_t next = UINT32_MAX;
+    for (int c = 0; c < CLASS_COUNT; c++) {
+        const Queue& q = _queues[c];
+        if (!q.count) continue;
+        uint32_t ms = q.tokens > 0 ? 0 : (uint32_t)((1 - q.tokens) * 1000LL / RATE[c]) + 1;
+        next = min(next, ms);
+    }
+    return next;
+}
+
+String MeshOutbox::statusText() const {
+    String out;
+    for (int c = 0; c < CLASS_COUNT; c++) {
+        const ClassStats& s = _stats[c];
+        out += "• " + String(CLASS_NAMES[c]) + ": " + String(_queues[c].count) + " wartend, " + String(s.sent) + " gesendet ("
+             + String(s.bytes / 1024) + " KB), " + String(s.coalesced) + " ersetzt, " + String(s.dropped) + " verworfen, Wartezeit Ø "
+             + String(s.avgWaitMs) + " ms / max " + String(s.maxWaitMs) + " ms<br>";
+    }
+    return out;
+}
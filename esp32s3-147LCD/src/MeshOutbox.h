@@ -0,0 +1,103 @@
+#ifndef MESH_OUTBOX_H
+#define MESH_OUTBOX_H
+
+#include <Arduino.h>
+#include <functional>
+
+// =====================
+// SENDE-WARTESCHLANGE
+// =====================
+
+#define OUTBOX_SLOTS 32                 // Gleichzeitig wartende Nachrichten (alle Klassen)
+#define OUTBOX_MAX_PER_RUN 8            // Höchstens so viele Nachrichten pro Durchlauf senden
+
+// Token-Buckets pro Klasse in Byte/s und Byte. Eine Nachricht geht raus, sobald
+// der Bucket positiv ist, und darf ihn ins Minus ziehen (große SYNC_RES).
+#define OUTBOX_CONTROL_RATE 8192
+#define OUTBOX_CONTROL_BURST 4096
+#define OUTBOX_CONFIG_RATE 4096
+#define OUTBOX_CONFIG_BURST 16384
+#define OUTBOX_BULK_RATE 8192
+#define OUTBOX_BULK_BURST 4096
+
+/**
+ * Alle ausgehenden Mesh-Nachrichten laufen durch diese Warteschlange.
+ *
+ * Drei Klassen mit fester Priorität: CONTROL (NACK, Blink, Zeit, Kanal,
+ * Heartbeats), CONFIG (Sync und Deltas) und BULK (OTA, Status an die Bridge,
+ * Site Survey).
+ * Die Klasse ergibt sich aus dem Nachrichtentyp (Tabelle in MeshOutbox.cpp).
+ * Jede Klasse hat einen eigenen Token-Bucket, gesendet wird immer aus der
+ * höchsten Klasse mit Guthaben. Eine neue Nachricht gleichen Typs an dasselbe
+ * Ziel ersetzt eine noch wartende (Coalescing), so bleibt z.B. nur der neueste
+ * SYNC_RES in der Schlange. Reliable Broadcasts bekommen ihre Sequenznummer erst
+ * beim Senden, ersetzte Nachrichten hinterlassen daher keine Lücke.
+ */
+class MeshOutbox {
+public:
+    enum Class : uint8_t { CONTROL, CONFIG, BULK, CLASS_COUNT };
+    enum Flags : uint8_t {
+        RELIABLE = 1,           // Vor dem Senden per StampFn nummerieren
+        NO_COALESCE = 2,        // Nie ersetzen (z.B. Retransmits einzelner Sequenzen)
+    };
+
+    using SendFn = std::function<void(uint32_t dest, const String& msg)>;   // dest 0 = Broadcast
+    using StampFn = std::function<void(String& msg)>;
+
+    struct ClassStats {
+        uint32_t sent = 0;
+        uint32_t bytes = 0;
+        uint32_t coalesced = 0;
+        uint32_t dropped = 0;
+        uint32_t maxWaitMs = 0;
+        uint32_t avgWaitMs = 0;     // gleitender Mittelwert (1/8)
+    };
+
+    void begin(SendFn send, StampFn stamp);
+    // Reiht ein; false = verworfen (Schlange voll mit wichtigeren Nachrichten)
+    bool push(uint32_t dest, const String& msg, uint8_t flags = 0);
+    // Sendet, soweit die Buckets es erlauben; liefert ms bis zum nächsten möglichen Versand
+    uint32_t service(uint32_t now);
+
+    bool empty() const { return _used == 0; }
+    // Wartet noch eine ersetzbare Nachricht dieses Typs an dest?
+    bool pending(const char* type, uint32_t dest) const;
+    size_t queued(Class cls) const { return _queues[cls].count; }
+    const ClassStats& stats(Class cls) const { return _stats[cls]; }
+    String statusText() const;
+
+    static Class classify(const char* type);
+
+private:
+    struct Entry {
+        String msg;
+        uint32_t dest = 0;
+        uint32_t key = 0;           // Typ-Hash ^ Ziel, 0 = nicht ersetzbar
+        uint32_t enqueued = 0;
+        uint8_t flags = 0;
+        bool used = false;
+    };
+
+    struct Queue {
+        uint8_t slots[OUTBOX_SLOTS];    // Ring von Slot-Indizes, älteste zuerst
+        uint8_t head = 0;
+        uint8_t count = 0;
+        int32_t tokens = 0;
+        uint32_t refilled = 0;
+    };
+
+    Entry _entries[OUTBOX_SLOTS];
+    Queue _queues[CLASS_COUNT];
+    ClassStats _stats[CLASS_COUNT];
+    uint8_t _used = 0;
+    SendFn _send;
+    StampFn _stamp;
+
+    int allocSlot();
+    bool dropOldest(Class below);
+    int findKey(Class cls, uint32_t key) const;
+    void refill(Queue& q, Class cls, uint32_t now);
+    static uint32_t keyFor(const char* type, size_t len, uint32_t dest);
+};
+
+#endif
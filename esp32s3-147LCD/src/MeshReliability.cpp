@@ -0,0 +1,140 @@
+#include "MeshReliability.h"
+
+MeshReliability::MeshReliability() {
+    // Neue Epoche pro Boot: Empfänger verwerfen so den alten Sequenzstand
+    _epoch = esp_random() | 1;
+}
+
+// --- Sender ---
+
+void MeshReliability::remember(uint32_t seq, const String& msg) {
+    Sent& slot = _history[seq % REL_HISTORY];
+    slot.seq = seq;
+    slot.msg = msg;
+    _stats.sent++;
+}
+
+const String* MeshReliability::lookup(uint32_t seq) const {
+    const Sent& slot = _history[seq % REL_HISTORY];
+    if (slot.seq != seq || slot.msg.length() == 0) return nullptr;
+    return &slot.msg;
+}
+
+// --- Empfänger ---
+
+MeshReliability::Origin& MeshReliability::findOrigin(uint32_t id, uint32_t epoch, uint32_t seq, uint32_t now, bool& isNew) {
+    Origin* victim = &_origins[0];
+    for (Origin& o : _origins) {
+        if (o.id == id) {
+            if (o.epoch == epoch) { isNew = false; o.lastSeen = now; return o; }
+            victim = &o;
+            break;
+        }
+        if (o.id == 0) { victim = &o; break; }
+        if ((int32_t)(o.lastSeen - victim->lastSeen) < 0) victim = &o;
+    }
+    // Erstkontakt oder Neustart des Absenders: alles vor 'seq' gilt als gesehen
+    isNew = true;
+    victim->id = id;
+    victim->epoch = epoch;
+    victim->highest = seq - 1;
+    victim->window = ~0ULL;
+    victim->lastSeen = now;
+    victim->nackDue = 0;
+    victim->nackTries = 0;
+    return *victim;
+}
+
+void MeshReliability::advance(Origin& o, uint32_t seq) {
+    uint32_t shift = seq - o.highest;
+    if (shift >= REL_WINDOW) {
+        _stats.lost += (REL_WINDOW - __builtin_popcountll(o.window)) + (shift - REL_WINDOW);
+        o.window = 0;
+    } else {
+        uint64_t dropped = o.window >> (REL_WINDOW - shift);
+        _stats.lost += shift - __builtin_popcountll(dropped);
+        o.window <<= shift;
+    }
+    o.highest = seq;
+}
+
+uint64_t MeshReliability::missingMask(const Origin& o) const {
+    return ~o.window;
+}
+
+void MeshReliability::scheduleNack(Origin& o, uint32_t now) {
+    if (o.nackDue != 0) return;
+    o.nackDue = (now + REL_NACK_DELAY_MS) | 1;
+    o.nackTries = 0;
+}
+
+MeshReliability::Verdict MeshReliability::accept(uint32_t origin, uint32_t epoch, uint32_t seq, uint32_t now) {
+    bool isNew = false;
+    Origin& o = findOrigin(origin, epoch, seq, now, isNew);
+
+    if (seq > o.highest) {
+        advance(o, seq);
+        o.window |= 1;
+    } else {
+        uint32_t offset = o.highest - seq;
+        if (offset >= REL_WINDOW || (o.window & (1ULL << offset))) {
+            _stats.duplicates++;
+            return DUPLICATE;
+        }
+        o.window |= (1ULL << offset);
+        _stats.recovered++;
+    }
+    _stats.delivered++;
+
+    if (missingMask(o)) scheduleNack(o, now);
+    else o.nackDue = 0;
+    return FRESH;
+}
+
+void MeshReliability::noteHighest(uint32_t origin, uint32_t epoch, uint32_t seq, uint32_t now) {
+    if (seq == 0) return;
+    bool isNew = false;
+    // Bei Erstkontakt per Heartbeat gibt es nichts nachzufordern
+    Origin& o = findOrigin(origin, epoch, seq + 1, now, isNew);
+    if (isNew || seq <= o.highest) return;
+    advance(o, seq);
+    scheduleNack(o, now);
+}
+
+bool MeshReliability::pollNack(uint32_t now, uint32_t& origin, uint32_t& epoch, uint32_t* seqs, uint8_t& count) {
+    for (Origin& o : _origins) {
+        if (o.id == 0 || o.nackDue == 0 || (int32_t)(now - o.nackDue) < 0) continue;
+
+        uint64_t mask = missingMask(o);
+        if (!mask) { o.nackDue = 0; continue; }
+
+        if (o.nackTries >= REL_NACK_RETRIES) {
+            _stats.lost += __builtin_popcountll(mask);
+            o.window = ~0ULL;
+            o.nackDue = 0;
+            continue;
+        }
+
+        count = 0;
+        for (uint32_t i = 0; i < REL_WINDOW && count < REL_MAX_NACK_SEQS; i++) {
+            if (mask & (1ULL << i)) seqs[count++] = o.highest - i;
+        }
+        origin = o.id;
+        epoch = o.epoch;
+        o.nackTries++;
+        o.nackDue = (now + REL_NACK_RETRY_MS) | 1;
+        return true;
+    }
+    return false;
+}
+
+bool MeshReliability::simulateLoss() {
+#if MESH_SIM_LOSS_PCT > 0
+    if ((esp_random() % 100) >= (uint32_t)MESH_SIM_LOSS_PCT) return false;
+    _stats.simDropped++;
+    return true;
+#else
+    // Ohne Simulation bleibt der Vergleich ganz weg (sonst -Wtype-limits)
+    return false;
+#endif
+}
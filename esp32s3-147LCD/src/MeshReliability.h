@@ -0,0 +1,94 @@
+#ifndef MESH_RELIABILITY_H
+#define MESH_RELIABILITY_H
+
+#include <Arduino.h>
+
+// =====================
+// RELIABLE BROADCAST
+// =====================
+
+#define REL_WINDOW 64               // Breite des Duplikat-Bitmaps pro Absender (Sequenzen)
+#define REL_MAX_ORIGINS 32          // Anzahl gleichzeitig verfolgter Absender
+#define REL_HISTORY 16              // Eigene Nachrichten, die für Retransmits vorgehalten werden
+#define REL_MAX_NACK_SEQS 8         // Maximale Anzahl Sequenzen pro NACK
+#define REL_NACK_DELAY_MS 300       // Wartezeit nach erkannter Lücke (Umsortierung abwarten)
+#define REL_NACK_RETRY_MS 2000      // Abstand zwischen wiederholten NACKs
+#define REL_NACK_RETRIES 3          // Danach gilt eine Sequenz als verloren
+#define REL_HB_INTERVAL_MS 20000    // Heartbeat mit höchster Sequenz (erkennt Verluste am Ende)
+
+// Simulierter Paketverlust beim Empfang in Prozent (nur für Messungen, 0 = aus)
+#ifndef MESH_SIM_LOSS_PCT
+#define MESH_SIM_LOSS_PCT 0
+#endif
+
+/**
+ * Sequenznummern, Duplikaterkennung und NACK-basierte Retransmits für Broadcasts.
+ *
+ * Jeder Absender nummeriert seine Broadcasts fortlaufend innerhalb einer Epoche
+ * (zufällig pro Boot). Empfänger führen pro Absender die höchste gesehene Sequenz
+ * und ein 64-Bit-Fenster der empfangenen Vorgänger. Lücken werden nach kurzer
+ * Wartezeit per NACK direkt beim Absender nachgefordert.
+ */
+class MeshReliability {
+public:
+    enum Verdict { FRESH, DUPLICATE };
+
+    struct Stats {
+        uint32_t sent = 0;          // eigene Reliable-Broadcasts
+        uint32_t delivered = 0;     // neu angenommene fremde Nachrichten
+        uint32_t duplicates = 0;    // verworfene Duplikate
+        uint32_t recovered = 0;     // Lücken, die nachträglich gefüllt wurden
+        uint32_t lost = 0;          // Sequenzen, die nach allen NACKs aufgegeben wurden
+        uint32_t nacksSent = 0;
+        uint32_t retransmits = 0;
+        uint32_t simDropped = 0;    // durch MESH_SIM_LOSS_PCT verworfen
+    };
+
+    MeshReliability();
+
+    // --- Sender ---
+    uint32_t epoch() const { return _epoch; }
+    uint32_t lastSeq() const { return _seq; }
+    uint32_t nextSeq() { return ++_seq; }
+    void remember(uint32_t seq, const String& msg);
+    const String* lookup(uint32_t seq) const;
+    void countRetransmit() { _stats.retransmits++; }
+
+    // --- Empfänger ---
+    Verdict accept(uint32_t origin, uint32_t epoch, uint32_t seq, uint32_t now);
+    void noteHighest(uint32_t origin, uint32_t epoch, uint32_t seq, uint32_t now);
+    bool pollNack(uint32_t now, uint32_t& origin, uint32_t& epoch, uint32_t* seqs, uint8_t& count);
+    bool simulateLoss();
+
+    const Stats& stats() const { return _stats; }
+    void countNack() { _stats.nacksSent++; }
+
+private:
+    struct Origin {
+        uint32_t id = 0;
+        uint32_t epoch = 0;
+        uint32_t highest = 0;
+        uint64_t window = 0;        // Bit i = Sequenz (highest - i) empfangen
+        uint32_t lastSeen = 0;
+        uint32_t nackDue = 0;       // 0 = kein NACK geplant
+        uint8_t nackTries = 0;
+    };
+
+    struct Sent {
+        uint32_t seq = 0;
+        String msg;
+    };
+
+    uint32_t _epoch;
+    uint32_t _seq = 0;
+    Origin _origins[REL_MAX_ORIGINS];
+    Sent _history[REL_HISTORY];
+    Stats _stats;
+
+    Origin& findOrigin(uint32_t id, uint32_t epoch, uint32_t seq, uint32_t now, bool& isNew);
+    void advance(Origin& o, uint32_t seq);
+    uint64_t missingMask(const Origin& o) const;
+    void scheduleNack(Origin& o, uint32_t now);
+};
+
+#endif
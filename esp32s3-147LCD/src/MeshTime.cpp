@@ -0,0 +1,172 @@
+#include "MeshTime.h"
+#include <sys/time.h>
+#include <esp_sntp.h>
+
+#define TIME_RTC_MAGIC 0x4D54494DUL
+
+// Überlebt Deep Sleep: die Systemuhr selbst läuft im RTC weiter, hier steht,
+// ob und wann sie zuletzt aus dem Mesh/NTP gestellt wurde.
+struct RtcTimeState {
+    uint32_t magic;
+    uint32_t lastSyncEpoch;
+    uint32_t source;
+};
+RTC_DATA_ATTR static RtcTimeState rtcTime;
+
+// Wird aus dem lwIP-Task gerufen
+static volatile uint32_t ntpSyncCount = 0;
+
+void MeshTime::onNtpSync(struct timeval* tv) {
+    ntpSyncCount++;
+}
+
+void MeshTime::begin(uint32_t nodeId) {
+    _nodeId = nodeId;
+    setenv("TZ", TIME_TZ, 1);
+    tzset();
+    if (rtcTime.magic == TIME_RTC_MAGIC && valid()) {
+        Serial.printf("[TIME] Uhr aus RTC übernommen (letzter Sync vor %lu s, Quelle %u)\n",
+                      (unsigned long)(time(nullptr) - rtcTime.lastSyncEpoch), rtcTime.source);
+    }
+}
+
+bool MeshTime::valid() const {
+    return time(nullptr) > (time_t)TIME_VALID_EPOCH;
+}
+
+int64_t MeshTime::localEpochUs() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return (int64_t)tv.tv_sec * 1000000LL + tv.tv_usec;
+}
+
+bool MeshTime::lowerGatewayAlive(uint32_t now) const {
+    return _gatewayId && _gatewayId < _nodeId && now - _gatewaySeenAt < TIME_GW_TIMEOUT_MS;
+}
+
+// --- Gateway ---
+
+void MeshTime::startNtp() {
+    sntp_set_time_sync_notification_cb(onNtpSync);
+    configTzTime(TIME_TZ, TIME_NTP_SERVER);
+    Serial.println("[TIME] Gateway: NTP gestartet.");
+}
+
+void MeshTime::stopNtp() {
+    if (sntp_enabled()) sntp_stop();
+}
+
+MeshTime::Action MeshTime::poll(uint32_t now, bool uplink, uint32_t nodeTime, uint32_t& sec, uint32_t& usec) {
+    if (!uplink) {
+        if (_role == GATEWAY) Serial.println("[TIME] Uplink weg, gebe Gateway-Rolle ab.");
+        if (_role != NODE) stopNtp();
+        _role = NODE;
+    } else if (_role == NODE) {
+        _role = CANDIDATE;
+        _candidateSince = now;
+    }
+
+    if (_role == CANDIDATE && !lowerGatewayAlive(now) && now - _candidateSince > TIME_GW_HOLDOFF_MS) {
+        _role = GATEWAY;
+        _ntpSeen = ntpSyncCount;
+        startNtp();
+    } else if (_role == GATEWAY && lowerGatewayAlive(now)) {
+        Serial.printf("[TIME] Gateway %u hat Vorrang, stoppe NTP.\n", _gatewayId);
+        stopNtp();
+        _role = CANDIDATE;
+        _candidateSince = now;
+    }
+
+    if (_role == GATEWAY) {
+        // Erst nach einem erfolgreichen NTP-Abgleich Zeit verteilen, dann sofort einmal
+        bool fresh = ntpSyncCount != _ntpSeen;
+        if (fresh) {
+            _stats.ntpSyncs += ntpSyncCount - _ntpSeen;
+            _ntpSeen = ntpSyncCount;
+        }
+        if (!_stats.ntpSyncs) return NONE;
+        bool due = fresh || now - _lastSent >= TIME_SYNC_INTERVAL_MS || (_syncDue && now - _lastSent >= TIME_SYNC_MIN_GAP_MS);
+        if (!due) return NONE;
+
+        int64_t epochUs = localEpochUs();
+        sec = epochUs / 1000000LL;
+        usec = epochUs % 1000000LL;
+        _anchorEpochUs = epochUs;
+        _anchorNt = nodeTime;
+        _haveAnchor = true;
+        _lastSent = now;
+        _syncDue = false;
+        _stats.syncsSent++;
+        rtcTime = {TIME_RTC_MAGIC, sec, _nodeId};
+        return SEND_SYNC;
+    }
+
+    // Ohne gültige Uhr aktiv nachfragen, statt auf den nächsten periodischen Sync zu warten
+    if (!valid() && now - _lastReq >= TIME_REQ_INTERVAL_MS) {
+        _lastReq = now;
+        return SEND_REQ;
+    }
+    return NONE;
+}
+
+void MeshTime::handleRequest(uint32_t now) {
+    if (_role == GATEWAY) _syncDue = true;
+}
+
+// --- Empfänger ---
+
+void MeshTime::handleSync(uint32_t from, uint32_t sec, uint32_t usec, uint32_t nt, uint32_t nodeTimeNow, uint32_t now) {
+    // Als Quelle zählt nur das niedrigste lebende Gateway, sonst springt die Uhr zwischen zweien
+    bool stale = !_gatewayId || now - _gatewaySeenAt >= TIME_GW_TIMEOUT_MS;
+    if (!stale && from > _gatewayId) return;
+    _gatewayId = from;
+    _gatewaySeenAt = now;
+    // Als Gateway mit kleinerer ID bleibt NTP maßgeblich; poll() gibt die Rolle sonst ab
+    if (_role == GATEWAY) return;
+
+    _anchorEpochUs = (int64_t)sec * 1000000LL + usec;
+    _anchorNt = nt;
+    _haveAnchor = true;
+
+    // Seit dem Abtasten beim Gateway vergangene Mesh-Zeit (modulo 2^32)
+    apply(_anchorEpochUs + (int32_t)(nodeTimeNow - nt), now);
+}
+
+void MeshTime::apply(int64_t epochUs, uint32_t now) {
+    int64_t err = epochUs - localEpochUs();
+    if (!valid() || llabs(err) > TIME_STEP_US) {
+        struct timeval tv = {(time_t)(epochUs / 1000000LL), (suseconds_t)(epochUs % 1000000LL)};
+        if (!_dryRun) settimeofday(&tv, nullptr);
+        _stats.steps++;
+    } else {
+        struct timeval delta = {(time_t)(err / 1000000LL), (suseconds_t)(err % 1000000LL)};
+        if (!_dryRun) adjtime(&delta, nullptr);
+    }
+    _stats.lastCorrUs = (int32_t)constrain(err, (int64_t)INT32_MIN, (int64_t)INT32_MAX);
+    _stats.syncsApplied++;
+    _lastApplied = now;
+    if (!_dryRun) rtcTime = {TIME_RTC_MAGIC, (uint32_t)(epochUs / 1000000LL), _gatewayId};
+}
+
+bool MeshTime::toEpochUs(uint32_t nodeTime, int64_t& epochUs) const {
+    if (!_haveAnchor) return false;
+    int32_t delta = (int32_t)(nodeTime - _anchorNt);
+    if ((uint32_t)abs(delta) > TIME_ANCHOR_MAX_AGE_US) return false;
+    epochUs = _anchorEpochUs + delta;
+    return true;
+}
+
+String MeshTime::statusText(uint32_t now) const {
+    static const char* roles[] = {"Knoten", "Gateway-Kandidat", "Gateway (NTP)"};
+    String out = String(roles[_role]);
+    if (!valid()) return out + ", Uhr ungültig";
+    if (_role == GATEWAY) {
+        out += ", NTP-Abgleiche: " + String(_stats.ntpSyncs) + ", TIME_SYNC gesendet: " + String(_stats.syncsSent);
+    } else if (_stats.syncsApplied) {
+        out += ", Quelle " + String(_gatewayId) + " vor " + String((now - _lastApplied) / 1000) + " s";
+        out += ", Korrektur " + String(_stats.lastCorrUs) + " µs, Sprünge: " + String(_stats.steps);
+    } else {
+        out += ", Uhr aus RTC";
+    }
+    return out;
+}
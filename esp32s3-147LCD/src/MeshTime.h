@@ -0,0 +1,87 @@
+#ifndef MESH_TIME_H
+#define MESH_TIME_H
+
+#include <Arduino.h>
+
+// =====================
+// MESH ZEITBASIS
+// =====================
+
+#define TIME_TZ "CET-1CEST,M3.5.0,M10.5.0/3"   // MEZ/MESZ
+#define TIME_NTP_SERVER "at.pool.ntp.org"
+#define TIME_SYNC_INTERVAL_MS 30000             // TIME_SYNC Intervall des Gateways
+#define TIME_SYNC_MIN_GAP_MS 2000               // Frühestens so oft auf TIME_REQ antworten
+#define TIME_GW_TIMEOUT_MS 100000               // Gateway gilt nach ~3 verpassten Syncs als weg
+#define TIME_GW_HOLDOFF_MS 8000                 // Mit Uplink erst nach niedrigerem Gateway lauschen
+#define TIME_REQ_INTERVAL_MS 5000               // TIME_REQ solange die Uhr ungültig ist
+#define TIME_STEP_US 250000                     // Größere Abweichungen springen, kleinere werden geslewt
+#define TIME_ANCHOR_MAX_AGE_US 1800000000UL     // Anker bis 30 min nutzen (Mesh-Zeit läuft nach ~71 min über)
+#define TIME_VALID_EPOCH 1700000000UL           // Alles davor gilt als "nie gestellt"
+
+/**
+ * Wanduhrzeit für alle Knoten aus der gemeinsamen painlessMesh-Zeit.
+ *
+ * Nur ein Gateway (niedrigste Knoten-ID mit WLAN-Uplink) fragt NTP ab. Es sendet
+ * regelmäßig TIME_SYNC mit einem Paar (Epoche, Mesh-Zeit), beide im selben Moment
+ * abgetastet. Jeder Knoten rechnet daraus über seine eigene Mesh-Zeit die aktuelle
+ * Epoche aus; die Laufzeit der Nachricht fällt dabei heraus. Die Mesh-Zeit ist ein
+ * uint32 in µs und läuft nach ~71 min über, Differenzen werden daher modulo 2^32
+ * gerechnet.
+ */
+class MeshTime {
+public:
+    enum Role { NODE, CANDIDATE, GATEWAY };
+    enum Action { NONE, SEND_SYNC, SEND_REQ };
+
+    struct Stats {
+        uint32_t syncsSent = 0;
+        uint32_t syncsApplied = 0;
+        uint32_t steps = 0;         // harte Sprünge per settimeofday
+        uint32_t ntpSyncs = 0;      // erfolgreiche NTP-Abgleiche als Gateway
+        int32_t lastCorrUs = 0;     // letzte Korrektur (Soll - Ist)
+    };
+
+    void begin(uint32_t nodeId);
+    // Rolle aus dem Uplink-Zustand ableiten; SEND_SYNC liefert das Paar (sec, usec) zu nodeTime
+    Action poll(uint32_t now, bool uplink, uint32_t nodeTime, uint32_t& sec, uint32_t& usec);
+    void handleSync(uint32_t from, uint32_t sec, uint32_t usec, uint32_t nt, uint32_t nodeTimeNow, uint32_t now);
+    void handleRequest(uint32_t now);
+
+    bool valid() const;
+    // Mesh-Zeitstempel (z.B. aus einer Nachricht) in Epoche umrechnen
+    bool toEpochUs(uint32_t nodeTime, int64_t& epochUs) const;
+
+    Role role() const { return _role; }
+    const Stats& stats() const { return _stats; }
+    String statusText(uint32_t now) const;
+    // Nur rechnen, Systemuhr und RTC-Kopie nicht anfassen (Trace-Wiedergabe)
+    void setDryRun(bool on) { _dryRun = on; }
+
+private:
+    uint32_t _nodeId = 0;
+    Role _role = NODE;
+    uint32_t _candidateSince = 0;
+    uint32_t _gatewayId = 0;        // aktuell genutzte Zeitquelle
+    uint32_t _gatewaySeenAt = 0;
+    uint32_t _lastSent = 0;
+    uint32_t _lastReq = 0;
+    uint32_t _lastApplied = 0;
+    uint32_t _ntpSeen = 0;
+    bool _syncDue = false;
+    bool _dryRun = false;
+
+    bool _haveAnchor = false;
+    int64_t _anchorEpochUs = 0;
+    uint32_t _anchorNt = 0;
+
+    Stats _stats;
+
+    bool lowerGatewayAlive(uint32_t now) const;
+    void startNtp();
+    void stopNtp();
+    void apply(int64_t epochUs, uint32_t now);
+    static int64_t localEpochUs();
+    static void onNtpSync(struct timeval* tv);
+};
+
+#endif
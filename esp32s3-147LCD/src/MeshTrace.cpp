@@ -0,0 +1,153 @@
+#include "MeshTrace.h"
+#include "MemoryPlacement.h"
+
+uint32_t MeshTrace::_flashWrites = 0;
+
+bool MeshTrace::allocate() {
+    if (!_buf) _buf = (uint8_t*)memPlace("mesh-trace", TRACE_BUFFER_SIZE, MEM_PSRAM);
+    return _buf != nullptr;
+}
+
+bool MeshTrace::setCapture(bool on) {
+    if (on && !allocate()) return false;
+    if (on && !_capture) clear();
+    _capture = on;
+    Serial.printf("[TRACE] Mitschnitt %s.\n", on ? "gestartet" : "beendet");
+    return true;
+}
+
+void MeshTrace::clear() {
+    _head = _tail = 0;
+    _count = _dropped = 0;
+}
+
+// --- Ringpuffer ---
+
+void MeshTrace::dropOldest() {
+    uint32_t phys = _tail % TRACE_BUFFER_SIZE;
+    if (TRACE_BUFFER_SIZE - phys < sizeof(Record)) {
+        // Zu kurzer Rest am Pufferende: implizite Lücke
+        _tail += TRACE_BUFFER_SIZE - phys;
+        return;
+    }
+    const Record* r = (const Record*)(_buf + phys);
+    _tail += r->total();
+    if (r->dir != PAD) {
+        _count--;
+        _dropped++;
+    }
+}
+
+void MeshTrace::reserve(uint32_t bytes) {
+    while (_head + bytes - _tail > TRACE_BUFFER_SIZE) dropOldest();
+}
+
+void MeshTrace::record(Dir dir, uint32_t peer, const String& msg, uint32_t handlerUs) {
+    if (!_capture) return;
+    uint16_t len = min((size_t)TRACE_MAX_PAYLOAD, (size_t)msg.length());
+    uint32_t total = (sizeof(Record) + len + 3) & ~3UL;
+
+    // Datensätze laufen nie über das Pufferende: Rest als Füllsatz markieren
+    uint32_t phys = _head % TRACE_BUFFER_SIZE;
+    uint32_t room = TRACE_BUFFER_SIZE - phys;
+    if (room < total) {
+        reserve(room);
+        if (room >= sizeof(Record)) {
+            Record* pad = (Record*)(_buf + phys);
+            memset(pad, 0, sizeof(Record));
+            pad->dir = PAD;
+            pad->len = room - sizeof(Record);
+        }
+        _head += room;
+    }
+
+    reserve(total);
+    Record* r = (Record*)(_buf + _head % TRACE_BUFFER_SIZE);
+    r->ms = millis();
+    r->peer = peer;
+    r->handlerUs = handlerUs;
+    r->len = len;
+    r->size = min(msg.length(), (unsigned int)UINT16_MAX);
+    r->dir = dir;
+    memset(r->reserved, 0, sizeof(r->reserved));
+    memcpy(r + 1, msg.c_str(), len);
+    _head += total;
+    _count++;
+}
+
+const MeshTrace::Record* MeshTrace::at(uint32_t& pos) const {
+    while ((int32_t)(_head - pos) > 0) {
+        uint32_t phys = pos % TRACE_BUFFER_SIZE;
+        if (TRACE_BUFFER_SIZE - phys < sizeof(Record)) {
+            pos += TRACE_BUFFER_SIZE - phys;
+            continue;
+        }
+        const Record* r = (const Record*)(_buf + phys);
+        if (r->dir != PAD) return r;
+        pos += r->total();
+    }
+    return nullptr;
+}
+
+const MeshTrace::Record* MeshTrace::first(uint32_t& pos) const {
+    if (!_buf) return nullptr;
+    pos = _tail;
+    return at(pos);
+}
+
+const MeshTrace::Record* MeshTrace::next(uint32_t& pos) const {
+    pos += ((const Record*)(_buf + pos % TRACE_BUFFER_SIZE))->total();
+    return at(pos);
+}
+
+// --- Laden einer Trace-Datei ---
+
+bool MeshTrace::loadBegin() {
+    if (!allocate()) return false;
+    _capture = false;
+    clear();
+    _loadPos = 0;
+    return true;
+}
+
+void MeshTrace::loadWrite(const uint8_t* data, size_t len) {
+    if (!_buf) return;
+    // Dateikopf landet vorübergehend am Pufferanfang und wird in loadFinish geprüft
+    uint32_t n = min((uint32_t)len, (uint32_t)(TRACE_BUFFER_SIZE - _loadPos));
+    memcpy(_buf + _loadPos, data, n);
+    _loadPos += n;
+}
+
+uint32_t MeshTrace::loadFinish() {
+    if (!_buf || _loadPos < sizeof(FileHeader)) return 0;
+    FileHeader hdr;
+    memcpy(&hdr, _buf, sizeof(hdr));
+    if (hdr.magic != TRACE_MAGIC || hdr.recordHeader != sizeof(Record)) {
+        Serial.println("[TRACE] Ungültige Trace-Datei.");
+        clear();
+        return 0;
+    }
+    // Nur vollständige Datensätze übernehmen (Datei kann größer als der Puffer sein)
+    uint32_t pos = sizeof(FileHeader);
+    uint32_t count = 0;
+    while (pos + sizeof(Record) <= _loadPos) {
+        const Record* r = (const Record*)(_buf + pos);
+        if (pos + r->total() > _loadPos) break;
+        pos += r->total();
+        if (r->dir != PAD) count++;
+    }
+    _tail = sizeof(FileHeader);
+    _head = pos;
+    _count = count;
+    Serial.printf("[TRACE] %u Datensätze geladen (%u B).\n", count, pos);
+    return count;
+}
+
+String MeshTrace::typeOf(const uint8_t* msg, size_t len) {
+    size_t typeLen;
+    const char* type = findType(msg, len, typeLen);
+    if (!type) return "?";
+    String out;
+    out.concat(type, min(typeLen, (size_t)16));
+    return out;
+}
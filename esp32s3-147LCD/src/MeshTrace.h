@@ -0,0 +1,109 @@
+#ifndef MESH_TRACE_H
+#define MESH_TRACE_H
+
+#include <Arduino.h>
+
+// =====================
+// MESH TRACE
+// =====================
+
+#define TRACE_BUFFER_SIZE 65536     // Ringpuffer für Mitschnitte (PSRAM, erst beim Einschalten belegt)
+#define TRACE_MAX_PAYLOAD 4096      // Längere Nachrichten werden gekürzt gespeichert
+#define TRACE_MAGIC 0x4352544DUL    // "MTRC"
+#define TRACE_VERSION 1
+
+/**
+ * Mitschnitt aller empfangenen und gesendeten Mesh-Nachrichten in einem Ringpuffer.
+ *
+ * Jeder Datensatz enthält Zeitpunkt, Gegenstelle, Richtung, Originalgröße,
+ * Handler-Dauer und die Nachricht selbst. Datensätze liegen 4-Byte-ausgerichtet
+ * hintereinander und laufen nie über das Pufferende; passt einer nicht mehr
+ * hinein, wird der Rest als Füllsatz markiert. Die ältesten Datensätze werden
+ * verdrängt. Derselbe Puffer nimmt für die Wiedergabe eine hochgeladene
+ * Trace-Datei auf.
+ *
+ * Dateiformat (/trace): FileHeader, danach die Datensätze in zeitlicher Reihenfolge.
+ */
+class MeshTrace {
+public:
+    enum Dir : uint8_t { RX = 1, TX = 2, PAD = 0xFF };
+
+    struct __attribute__((packed)) FileHeader {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t recordHeader;      // sizeof(Record), für Vorwärtskompatibilität
+        uint32_t records;
+    };
+
+    struct __attribute__((packed)) Record {
+        uint32_t ms;                // millis() beim Mitschnitt
+        uint32_t peer;              // Absender (RX) bzw. Ziel (TX, 0 = Broadcast)
+        uint32_t handlerUs;         // Dauer von meshReceivedWrapper (nur RX)
+        uint16_t len;               // gespeicherte Payload-Bytes
+        uint16_t size;              // Originalgröße der Nachricht
+        uint8_t dir;
+        uint8_t reserved[3];
+        uint32_t total() const { return (sizeof(Record) + len + 3) & ~3UL; }
+    };
+
+    // Belegt den Puffer beim ersten Einschalten; false = kein Speicher
+    bool setCapture(bool on);
+    bool capturing() const { return _capture; }
+    void record(Dir dir, uint32_t peer, const String& msg, uint32_t handlerUs);
+    void clear();
+
+    uint32_t count() const { return _count; }
+    uint32_t dropped() const { return _dropped; }
+    uint32_t bytes() const { return _head - _tail; }
+
+    // Iteration über alle echten Datensätze (ohne Füllsätze), älteste zuerst
+    const Record* first(uint32_t& pos) const;
+    const Record* next(uint32_t& pos) const;
+    const uint8_t* payload(const Record* r) const { return (const uint8_t*)(r + 1); }
+
+    // Hochgeladene Trace-Datei stückweise in den Puffer laden (Mitschnitt wird dabei beendet)
+    bool loadBegin();
+    void loadWrite(const uint8_t* data, size_t len);
+    uint32_t loadFinish();
+
+    // Feld "type" aus einer JSON-Nachricht, ohne sie zu parsen
+    static String typeOf(const uint8_t* msg, size_t len);
+    // Dasselbe ohne Kopie: Zeiger in msg und Länge, nullptr = kein "type"
+    static const char* findType(const uint8_t* msg, size_t len, size_t& typeLen);
+
+    // Flash-/NVS-Schreibzugriffe, für die Auswertung der Wiedergabe
+    static void noteFlashWrite() { _flashWrites++; }
+    static uint32_t flashWrites() { return _flashWrites; }
+
+private:
+    uint8_t* _buf = nullptr;
+    bool _capture = false;
+    uint32_t _head = 0;             // fortlaufende Schreibposition (physisch: % TRACE_BUFFER_SIZE)
+    uint32_t _tail = 0;             // ältester Datensatz
+    uint32_t _count = 0;
+    uint32_t _dropped = 0;          // verdrängte Datensätze
+    uint32_t _loadPos = 0;
+    static uint32_t _flashWrites;
+
+    bool allocate();
+    const Record* at(uint32_t& pos) const;
+    void dropOldest();
+    void reserve(uint32_t bytes);
+};
+
+// Im Header, damit die Outbox (und ihr Host-Test) ohne den Trace-Puffer auskommt
+inline const char* MeshTrace::findType(const uint8_t* msg, size_t len, size_t& typeLen) {
+    static const char key[] = "\"type\":\"";
+    const size_t keyLen = sizeof(key) - 1;
+    for (size_t i = 0; i + keyLen < len; i++) {
+        if (memcmp(msg + i, key, keyLen) != 0) continue;
+        size_t j = i + keyLen;
+        while (j < len && msg[j] != '"') j++;
+        typeLen = j - (i + keyLen);
+        return (const char*)msg + i + keyLen;
+    }
+    typeLen = 0;
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,96 @@
+#include "NeighbourCache.h"
+#include <Preferences.h>
+#include "MeshTrace.h"
+
+static const uint8_t NO_BSSID[6] = {0, 0, 0, 0, 0, 0};
+
+uint32_t NeighbourCache::nodeIdFromMac(const uint8_t* mac) {
+    // Wie painlessMesh: Knoten-ID = letzte vier Bytes der Soft-AP-MAC (= BSSID)
+    return ((uint32_t)mac[2] << 24) | ((uint32_t)mac[3] << 16) | ((uint32_t)mac[4] << 8) | mac[5];
+}
+
+bool NeighbourCache::load() {
+    Preferences prefs;
+    prefs.begin("swarm", true);
+    size_t len = prefs.getBytes("nbr", &_cached, sizeof(_cached));
+    prefs.end();
+    if (len != sizeof(_cached) || _cached.magic != NBR_MAGIC || _cached.version != NBR_VERSION || _cached.count > NBR_MAX) {
+        memset(&_cached, 0, sizeof(_cached));
+        return false;
+    }
+    _saved = _cached;
+    const Neighbour* p = cachedParent();
+    Serial.printf("[MESH] Nachbar-Cache: Kanal %u, %u Nachbarn, Elternknoten %u, Config v%u\n",
+                  _cached.channel, _cached.count, p ? p->nodeId : 0, _cached.cfgVersion);
+    return true;
+}
+
+const NeighbourCache::Neighbour* NeighbourCache::cachedParent() const {
+    for (uint8_t i = 0; i < _cached.count; i++) {
+        const Neighbour& n = _cached.n[i];
+        if ((n.flags & PARENT) && memcmp(n.bssid, NO_BSSID, 6) != 0) return &n;
+    }
+    return nullptr;
+}
+
+void NeighbourCache::beginUpdate(uint8_t channel, uint32_t rootId, uint32_t cfgVersion, uint32_t cfgDigest) {
+    memset(&_current, 0, sizeof(_current));
+    _current.magic = NBR_MAGIC;
+    _current.version = NBR_VERSION;
+    _current.channel = channel;
+    _current.rootId = rootId;
+    _current.cfgVersion = cfgVersion;
+    _current.cfgDigest = cfgDigest;
+}
+
+void NeighbourCache::add(uint32_t nodeId, const uint8_t* bssid, uint8_t flags) {
+    if (_current.count >= NBR_MAX) return;
+    Neighbour& n = _current.n[_current.count++];
+    n.nodeId = nodeId;
+    n.flags = flags;
+    if (bssid) {
+        memcpy(n.bssid, bssid, 6);
+        return;
+    }
+    // BSSID sieht nur die Station: bekannte Werte aus dem gespeicherten Stand übernehmen
+    for (uint8_t i = 0; i < _saved.count; i++) {
+        if (_saved.n[i].nodeId == nodeId) memcpy(n.bssid, _saved.n[i].bssid, 6);
+    }
+}
+
+bool NeighbourCache::sameState(const Snapshot& a, const Snapshot& b) const {
+    return memcmp(&a, &b, sizeof(Snapshot)) == 0;
+}
+
+void NeighbourCache::commit(uint32_t now, bool force) {
+    // Ohne Nachbarn nichts überschreiben: ein isolierter Knoten soll den guten Stand behalten
+    if (!_current.count) return;
+    if (!sameState(_current, _saved)) _dirty = true;
+    if (!_dirty || (!force && _lastSave && now - _lastSave < NBR_SAVE_MIN_MS)) return;
+    Preferences prefs;
+    prefs.begin("swarm", false);
+    prefs.putBytes("nbr", &_current, sizeof(_current));
+    prefs.end();
+    MeshTrace::noteFlashWrite();
+    _saved = _current;
+    _dirty = false;
+    _lastSave = now | 1;
+    _writes++;
+}
+
+void NeighbourCache::noteJoined(uint32_t now, uint32_t parentId) {
+    if (_joinedAt) return;
+    _joinedAt = now | 1;
+    const Neighbour* p = cachedParent();
+    if (p) _parentHit = p->nodeId == parentId ? 1 : 0;
+    Serial.printf("[MESH] Im Mesh nach %u ms%s\n", now,
+                  _parentHit == 1 ? " (gespeicherter Elternknoten)" : _parentHit == 0 ? " (anderer Elternknoten)" : "");
+}
+
+String NeighbourCache::statusText(uint32_t now) const {
+    String out = "Rejoin: " + (_joinedAt ? String(_joinedAt) + " ms nach Start" : String("noch nicht verbunden"));
+    if (_parentHit >= 0) out += _parentHit ? ", gespeicherter Elternknoten" : ", anderer Elternknoten";
+    out += "<br>Gespeichert: Kanal " + String(_saved.channel) + ", " + String(_saved.count) + " Nachbarn, Root " + String(_saved.rootId)
+         + ", Config v" + String(_saved.cfgVersion) + (_dirty ? " (Änderung offen)" : "") + ", Schreibzugriffe: " + String(_writes);
+    return out;
+}
@@ -0,0 +1,81 @@
+#ifndef NEIGHBOUR_CACHE_H
+#define NEIGHBOUR_CACHE_H
+
+#include <Arduino.h>
+
+// =====================
+// NACHBAR-CACHE
+// =====================
+
+#define NBR_MAX 6                       // Gemerkte direkte Nachbarn
+#define NBR_MAGIC 0x4E425243UL          // "NBRC"
+#define NBR_VERSION 1
+#define NBR_SAVE_MIN_MS 300000          // NVS höchstens alle 5 min schreiben (Flash schonen)
+#define NBR_REJOIN_TIMEOUT_MS 4000      // So lange auf den gezielten Rejoin warten, dann Vollscan
+
+/**
+ * Letzter bekannter Mesh-Zustand im NVS, für einen schnellen Wiedereintritt
+ * nach Neustart oder Deep Sleep.
+ *
+ * Gespeichert werden Kanal, Root-Knoten, die direkten Nachbarn (der
+ * Elternknoten mit BSSID) sowie Version und Digest der Config beim letzten
+ * Kontakt. Beim Start tritt der Knoten direkt auf dem gespeicherten Kanal bei
+ * und verbindet die Station gezielt mit dem letzten Elternknoten. Passt die
+ * eigene Config noch zum gespeicherten Digest, entfällt die Sync-Wartezeit.
+ * Geschrieben wird nur bei Änderungen und höchstens alle NBR_SAVE_MIN_MS.
+ */
+class NeighbourCache {
+public:
+    enum : uint8_t { PARENT = 1 };
+
+    struct __attribute__((packed)) Neighbour {
+        uint32_t nodeId;
+        uint8_t bssid[6];           // nur bekannt, wenn wir schon einmal mit ihm verbunden waren
+        uint8_t flags;
+        uint8_t reserved;
+    };
+
+    struct __attribute__((packed)) Snapshot {
+        uint32_t magic;
+        uint8_t version;
+        uint8_t channel;
+        uint8_t count;
+        uint8_t reserved;
+        uint32_t rootId;            // 0 = kein Root im Mesh
+        uint32_t cfgVersion;
+        uint32_t cfgDigest;
+        Neighbour n[NBR_MAX];
+    };
+
+    // Gespeicherten Stand laden; false = nichts (oder veraltetes Format) im NVS
+    bool load();
+    const Snapshot& cached() const { return _cached; }
+    // Elternknoten aus dem gespeicherten Stand (mit BSSID), sonst nullptr
+    const Neighbour* cachedParent() const;
+
+    // Aktuellen Zustand sammeln und (gedrosselt) speichern
+    void beginUpdate(uint8_t channel, uint32_t rootId, uint32_t cfgVersion, uint32_t cfgDigest);
+    void add(uint32_t nodeId, const uint8_t* bssid, uint8_t flags);
+    void commit(uint32_t now, bool force = false);
+
+    // Erste Mesh-Verbindung nach dem Start (für die Rejoin-Zeit)
+    void noteJoined(uint32_t now, uint32_t parentId);
+    uint32_t rejoinMs() const { return _joinedAt; }
+    String statusText(uint32_t now) const;
+
+    static uint32_t nodeIdFromMac(const uint8_t* mac);
+
+private:
+    Snapshot _cached = {};
+    Snapshot _current = {};
+    Snapshot _saved = {};
+    bool _dirty = false;
+    uint32_t _lastSave = 0;
+    uint32_t _writes = 0;
+    uint32_t _joinedAt = 0;         // millis() seit dem Start, 0 = noch nicht verbunden
+    int8_t _parentHit = -1;         // -1 unbekannt, 0 anderer Elternknoten, 1 gespeicherter
+
+    bool sameState(const Snapshot& a, const Snapshot& b) const;
+};
+
+#endif
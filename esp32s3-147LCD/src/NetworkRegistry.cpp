@@ -0,0 +1,176 @@
+#include "NetworkRegistry.h"
+#include <esp_heap_caps.h>
+#include <utility>
+
+NetworkRegistry::~NetworkRegistry() {
+    free(_entries);
+    free(_index);
+}
+
+uint32_t NetworkRegistry::hash(const char* s) {
+    uint32_t h = 2166136261UL;
+    while (*s) {
+        h ^= (uint8_t)*s++;
+        h *= 16777619UL;
+    }
+    return h;
+}
+
+bool NetworkRegistry::inScope(const char* entryGroup, const char* nodeGroup) {
+    return !nodeGroup[0] || !entryGroup[0] || strcmp(entryGroup, nodeGroup) == 0;
+}
+
+// Große Registries gehören in den PSRAM; ohne PSRAM normaler Heap
+static void* regRealloc(void* ptr, size_t bytes) {
+    void* p = heap_caps_realloc(ptr, bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    return p ? p : realloc(ptr, bytes);
+}
+
+bool NetworkRegistry::grow() {
+    if (_capacity >= REG_MAX_ENTRIES) return false;
+    size_t cap = _capacity ? min((size_t)REG_MAX_ENTRIES, _capacity * 2) : 16;
+    NetEntry* entries = (NetEntry*)regRealloc(_entries, cap * sizeof(NetEntry));
+    if (!entries) return false;
+    // Der Block ist schon größer, _capacity gilt aber erst mit passendem Index:
+    // sonst füllt sich der alte Index über die Hälfte und die Sondierung läuft endlos
+    _entries = entries;
+
+    size_t size = 32;
+    while (size < cap * 2) size <<= 1;
+    uint16_t* index = (uint16_t*)regRealloc(_index, size * sizeof(uint16_t));
+    if (!index) return false;
+    _index = index;
+    _indexSize = size;
+    _capacity = cap;
+    rebuildIndex();
+    return true;
+}
+
+void NetworkRegistry::indexInsert(uint16_t entry) {
+    size_t mask = _indexSize - 1;
+    size_t pos = _entries[entry].hash & mask;
+    while (_index[pos]) pos = (pos + 1) & mask;
+    _index[pos] = entry + 1;
+}
+
+void NetworkRegistry::rebuildIndex() {
+    memset(_index, 0, _indexSize * sizeof(uint16_t));
+    for (size_t i = 0; i < _count; i++) indexInsert(i);
+}
+
+void NetworkRegistry::clear() {
+    _count = 0;
+    if (_index) memset(_index, 0, _indexSize * sizeof(uint16_t));
+}
+
+int NetworkRegistry::find(const char* ssid) const {
+    if (!_count) return -1;
+    uint32_t h = hash(ssid);
+    size_t mask = _indexSize - 1;
+    for (size_t pos = h & mask; _index[pos]; pos = (pos + 1) & mask) {
+        const NetEntry& e = _entries[_index[pos] - 1];
+        if (e.hash == h && strcmp(e.ssid, ssid) == 0) return _index[pos] - 1;
+    }
+    return -1;
+}
+
+void NetworkRegistry::swap(NetworkRegistry& other) {
+    std::swap(_entries, other._entries);
+    std::swap(_count, other._count);
+    std::swap(_capacity, other._capacity);
+    std::swap(_index, other._index);
+    std::swap(_indexSize, other._indexSize);
+}
+
+bool NetworkRegistry::copyFrom(const NetworkRegistry& other) {
+    clear();
+    for (size_t i = 0; i < other._count; i++) {
+        const NetEntry& e = other._entries[i];
+        if (upsert(e.ssid, e.pass, e.prio, e.group) < 0) return false;
+    }
+    return true;
+}
+
+int NetworkRegistry::upsert(const char* ssid, const char* pass, int8_t prio, const char* group) {
+    if (!ssid || !ssid[0]) return -1;
+    int i = find(ssid);
+    if (i < 0) {
+        if (_count >= _capacity && !grow()) {
+            Serial.println("[FS] Registry voll, Eintrag verworfen: " + String(ssid));
+            return -1;
+        }
+        i = _count++;
+        NetEntry& e = _entries[i];
+        strlcpy(e.ssid, ssid, sizeof(e.ssid));
+        e.hash = hash(e.ssid);
+        indexInsert(i);
+    }
+    NetEntry& e = _entries[i];
+    strlcpy(e.pass, pass ? pass : "", sizeof(e.pass));
+    strlcpy(e.group, group ? group : "", sizeof(e.group));
+    e.prio = prio;
+    return i;
+}
+
+bool NetworkRegistry::remove(const char* ssid) {
+    int i = find(ssid);
+    if (i < 0) return false;
+    // Letzten Eintrag in die Lücke ziehen; Löschen ist selten, der Index wird neu aufgebaut
+    _entries[i] = _entries[--_count];
+    rebuildIndex();
+    return true;
+}
+
+void NetworkRegistry::load(JsonArrayConst arr, const char* nodeGroup) {
+    clear();
+    for (JsonObjectConst n : arr) {
+        const char* group = n["g"] | "";
+        if (!inScope(group, nodeGroup)) continue;
+        upsert(n["ssid"] | "", n["pass"] | "", n["prio"] | 0, group);
+    }
+}
+
+void NetworkRegistry::toJson(size_t i, JsonObject obj) const {
+    const NetEntry& e = _entries[i];
+    obj["ssid"] = e.ssid;
+    obj["pass"] = e.pass;
+    // Standardwerte weglassen: spart Platz in Datei und Sync
+    if (e.prio) obj["prio"] = e.prio;
+    if (e.group[0]) obj["g"] = e.group;
+}
+
+void NetworkRegistry::save(JsonArray arr, const char* forGroup) const {
+    for (size_t i = 0; i < _count; i++) {
+        if (inScope(_entries[i].group, forGroup)) toJson(i, arr.add<JsonObject>());
+    }
+}
+
+uint8_t NetworkRegistry::candidates(uint16_t* out, uint8_t max) const {
+    // Einfügesortierung in eine kleine Bestenliste: O(n * max), kein Sortieren der ganzen Registry
+    uint8_t n = 0;
+    if (!max) return 0;
+    for (size_t i = 0; i < _count; i++) {
+        int8_t prio = _entries[i].prio;
+        if (n == max && prio <= _entries[out[n - 1]].prio) continue;
+        uint8_t pos = n < max ? n++ : n - 1;
+        while (pos > 0 && _entries[out[pos - 1]].prio < prio) {
+            out[pos] = out[pos - 1];
+            pos--;
+        }
+        out[pos] = i;
+    }
+    return n;
+}
+
+uint32_t NetworkRegistry::digest(const char* forGroup) const {
+    // Summe der Eintrags-Hashes: gleiche Einträge ergeben auf jedem Knoten denselben Wert,
+    // egal in welcher Reihenfolge sie eingefügt oder verschoben wurden
+    uint32_t sum = 0;
+    for (size_t i = 0; i < _count; i++) {
+        const NetEntry& e = _entries[i];
+        if (!inScope(e.group, forGroup)) continue;
+        uint32_t h = e.hash ^ (hash(e.pass) * 31) ^ (hash(e.group) * 131) ^ ((uint8_t)e.prio * 2654435761UL);
+        sum += h;
+    }
+    return sum;
+}
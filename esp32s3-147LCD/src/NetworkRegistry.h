@@ -0,0 +1,75 @@
+#ifndef NETWORK_REGISTRY_H
+#define NETWORK_REGISTRY_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// =====================
+// NETZWERK-REGISTRY
+// =====================
+
+#define REG_SSID_LEN 33             // 32 Zeichen + '\0'
+#define REG_PASS_LEN 65             // 64 Zeichen + '\0'
+#define REG_GROUP_LEN 16
+#define REG_MAX_ENTRIES 4096
+#define REG_MAX_CANDIDATES 16       // So viele Netze höchstens als Verbindungskandidaten
+
+struct NetEntry {
+    uint32_t hash;                  // FNV-1a der SSID
+    int8_t prio;                    // höher = bevorzugt
+    char ssid[REG_SSID_LEN];
+    char pass[REG_PASS_LEN];
+    char group[REG_GROUP_LEN];      // "" = für alle Gruppen
+};
+
+/**
+ * WLAN-Einträge mit Priorität und Gruppe, über einen Hash-Index nach SSID.
+ *
+ * Ein Knoten ohne eigene Gruppe hält die komplette Registry (Registry-Halter),
+ * ein Knoten mit Gruppe nur die Einträge seiner Gruppe plus die globalen. Die
+ * Einträge liegen als feste Strukturen in einem wachsenden Block (bevorzugt
+ * PSRAM), der Index ist eine offene Hashtabelle mit linearer Sondierung.
+ */
+class NetworkRegistry {
+public:
+    ~NetworkRegistry();
+
+    void clear();
+    // Inhalt und Speicher tauschen bzw. Einträge übernehmen (Sicherung für die Trace-Wiedergabe)
+    void swap(NetworkRegistry& other);
+    bool copyFrom(const NetworkRegistry& other);
+    // Ersetzt den Inhalt; nodeGroup != "" lädt nur passende Einträge
+    void load(JsonArrayConst arr, const char* nodeGroup);
+    // Schreibt alle Einträge, die für 'forGroup' relevant sind ("" = alle)
+    void save(JsonArray arr, const char* forGroup) const;
+    void toJson(size_t i, JsonObject obj) const;
+
+    int find(const char* ssid) const;
+    // Index des Eintrags oder -1, wenn die Registry voll ist
+    int upsert(const char* ssid, const char* pass, int8_t prio, const char* group);
+    bool remove(const char* ssid);
+
+    size_t size() const { return _count; }
+    const NetEntry& at(size_t i) const { return _entries[i]; }
+    // Die besten Einträge nach Priorität (absteigend), liefert die Anzahl
+    uint8_t candidates(uint16_t* out, uint8_t max) const;
+
+    // Reihenfolgeunabhängige Prüfsumme über alle Einträge für 'forGroup'
+    uint32_t digest(const char* forGroup) const;
+
+    static bool inScope(const char* entryGroup, const char* nodeGroup);
+    static uint32_t hash(const char* s);
+
+private:
+    NetEntry* _entries = nullptr;
+    size_t _count = 0;
+    size_t _capacity = 0;
+    uint16_t* _index = nullptr;     // Eintragsnummer + 1, 0 = frei
+    size_t _indexSize = 0;          // Zweierpotenz, mindestens 2 * _capacity
+
+    bool grow();
+    void rebuildIndex();
+    void indexInsert(uint16_t entry);
+};
+
+#endif
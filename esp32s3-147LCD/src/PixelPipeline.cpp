@@ -0,0 +1,124 @@
+#include "PixelPipeline.h"
+
+// Two pixels per word: swap the bytes of both halves at once
+static inline uint32_t swap_pair(uint32_t v)
+{
+  return ((v & 0x00FF00FFu) << 8) | ((v >> 8) & 0x00FF00FFu);
+}
+
+static inline uint16_t swap_one(uint16_t v)
+{
+  return (uint16_t)((v << 8) | (v >> 8));
+}
+
+// Spread one pixel so green sits in the upper half and red/blue in the lower
+// half with 5 spare bits above each field; a single multiply then scales all
+// three channels (classic 565 alpha trick).
+static inline uint16_t scale_one(uint16_t p, uint32_t level)
+{
+  uint32_t x = (p | ((uint32_t)p << 16)) & 0x07E0F81Fu;
+  x = ((x * level) >> 5) & 0x07E0F81Fu;
+  return (uint16_t)(x | (x >> 16));
+}
+
+// Word loops need src and dst on the same 4-byte phase; otherwise stay per pixel
+static inline bool same_phase(const uint16_t *dst, const uint16_t *src)
+{
+  return (((uintptr_t)dst ^ (uintptr_t)src) & 3) == 0;
+}
+
+void Pixel_Swap16(uint16_t *dst, const uint16_t *src, size_t n)
+{
+  bool aligned = same_phase(dst, src);
+  if (aligned && ((uintptr_t)dst & 3) && n)
+  {
+    *dst++ = swap_one(*src++);
+    n--;
+  }
+  if (!aligned)
+  {
+    while (n--)
+      *dst++ = swap_one(*src++);
+    return;
+  }
+
+  uint32_t *d = (uint32_t *)dst;
+  const uint32_t *s = (const uint32_t *)src;
+  size_t words = n / 2;
+  // 8 pixels per iteration keeps the loads/stores back to back
+  for (; words >= 4; words -= 4, d += 4, s += 4)
+  {
+    uint32_t a = s[0], b = s[1], c = s[2], e = s[3];
+    d[0] = swap_pair(a);
+    d[1] = swap_pair(b);
+    d[2] = swap_pair(c);
+    d[3] = swap_pair(e);
+  }
+  while (words--)
+    *d++ = swap_pair(*s++);
+  if (n & 1)
+    *(uint16_t *)d = swap_one(*(const uint16_t *)s);
+}
+
+void Pixel_Swap16Scale(uint16_t *dst, const uint16_t *src, size_t n, uint8_t level)
+{
+  if (level >= PIXEL_LEVEL_FULL)
+  {
+    Pixel_Swap16(dst, src, n);
+    return;
+  }
+  if (level == 0)
+  {
+    Pixel_Fill16(dst, 0, n, false);
+    return;
+  }
+  bool aligned = same_phase(dst, src);
+  if (aligned && ((uintptr_t)dst & 3) && n)
+  {
+    *dst++ = swap_one(scale_one(*src++, level));
+    n--;
+  }
+  if (!aligned)
+  {
+    while (n--)
+      *dst++ = swap_one(scale_one(*src++, level));
+    return;
+  }
+
+  uint32_t *d = (uint32_t *)dst;
+  const uint32_t *s = (const uint32_t *)src;
+  for (size_t words = n / 2; words; words--)
+  {
+    uint32_t v = *s++;
+    uint32_t lo = scale_one((uint16_t)v, level);
+    uint32_t hi = scale_one((uint16_t)(v >> 16), level);
+    *d++ = swap_pair(lo | (hi << 16));
+  }
+  if (n & 1)
+    *(uint16_t *)d = swap_one(scale_one(*(const uint16_t *)s, level));
+}
+
+void Pixel_Fill16(uint16_t *dst, uint16_t color, size_t n, bool swap)
+{
+  if (swap)
+    color = swap_one(color);
+  if (((uintptr_t)dst & 3) && n)
+  {
+    *dst++ = color;
+    n--;
+  }
+  uint32_t pair = color | ((uint32_t)color << 16);
+  uint32_t *d = (uint32_t *)dst;
+  size_t words = n / 2;
+  for (; words >= 4; words -= 4, d += 4)
+  {
+    d[0] = pair;
+    d[1] = pair;
+    d[2] = pair;
+    d[3] = pair;
+  }
+  while (words--)
+    *d++ = pair;
+  if (n & 1)
+    *(uint16_t *)d = color;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <Arduino.h>
+
+// =====================
+// RGB565 pixel conversion
+// =====================
+// LVGL renders native (little-endian) RGB565, the ST7789 expects big-endian.
+// These routines convert whole buffers two pixels per 32-bit word so the flush
+// path hands finished bytes to SPI instead of swapping pixel by pixel there.
+// src and dst may be the same buffer (in-place).
+
+#define PIXEL_LEVEL_FULL 32     // brightness levels: 0 (black) .. 32 (unchanged)
+
+// Byte-swap n pixels
+void Pixel_Swap16(uint16_t *dst, const uint16_t *src, size_t n);
+// Scale brightness to level/32 and byte-swap; level >= PIXEL_LEVEL_FULL is a plain swap
+void Pixel_Swap16Scale(uint16_t *dst, const uint16_t *src, size_t n, uint8_t level);
+// Fill n pixels with one native color, stored big-endian when 'swap' is set
+void Pixel_Fill16(uint16_t *dst, uint16_t color, size_t n, bool swap);
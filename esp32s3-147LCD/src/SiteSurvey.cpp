@@ -0,0 +1,138 @@
+#include "SiteSurvey.h"
+#include <WiFi.h>
+#include "NetworkRegistry.h"
+
+static void bssidToHex(const uint8_t* bssid, char* out) {
+    snprintf(out, 13, "%02x%02x%02x%02x%02x%02x", bssid[0], bssid[1], bssid[2], bssid[3], bssid[4], bssid[5]);
+}
+
+static bool hexToBssid(const char* hex, uint8_t* out) {
+    if (!hex || strlen(hex) != 12) return false;
+    for (int i = 0; i < 6; i++) {
+        char byte[3] = {hex[2 * i], hex[2 * i + 1], 0};
+        char* end;
+        out[i] = (uint8_t)strtoul(byte, &end, 16);
+        if (*end) return false;
+    }
+    return true;
+}
+
+SiteSurvey::Observation* SiteSurvey::slotFor(const uint8_t* bssid) {
+    // Gleiche BSSID, sonst freier Platz, sonst die älteste Beobachtung verdrängen
+    Observation* freeSlot = nullptr;
+    Observation* oldest = nullptr;
+    for (Observation& o : _entries) {
+        if (!o.ssidHash) {
+            if (!freeSlot) freeSlot = &o;
+        } else if (memcmp(o.bssid, bssid, 6) == 0) {
+            return &o;
+        } else if (!oldest || (int32_t)(o.seenAt - oldest->seenAt) < 0) {
+            oldest = &o;
+        }
+    }
+    Observation* slot = freeSlot ? freeSlot : oldest;
+    *slot = Observation();
+    return slot;
+}
+
+void SiteSurvey::observe(uint32_t ssidHash, const uint8_t* bssid, uint8_t channel, int8_t rssi, uint8_t auth,
+                         uint32_t observer, uint32_t seenAt) {
+    if (!ssidHash || !bssid || !channel) return;
+    Observation* o = slotFor(bssid);
+    if (o->ssidHash) {
+        int32_t newer = (int32_t)(seenAt - o->seenAt);
+        if (newer < 0) return;
+        // Im selben Zeitfenster zählt die eigene Messung, danach die stärkere fremde
+        bool window = newer < SURVEY_MERGE_MS && observer != o->observer && observer != _nodeId;
+        if (window && (o->observer == _nodeId || rssi < o->rssi)) return;
+        if (auth == 0xFF) auth = o->auth;
+    }
+    o->ssidHash = ssidHash;
+    memcpy(o->bssid, bssid, 6);
+    o->channel = channel;
+    o->rssi = rssi;
+    o->auth = auth;
+    o->observer = observer;
+    o->seenAt = seenAt;
+    if (observer == _nodeId) _changed = true;
+}
+
+void SiteSurvey::recordScan(int count, KnownFn known, uint32_t now) {
+    if (count <= 0) return;
+    _scans++;
+    for (int i = 0; i < count; i++) {
+        String ssid = WiFi.SSID(i);
+        if (!known(ssid.c_str())) continue;
+        observe(NetworkRegistry::hash(ssid.c_str()), WiFi.BSSID(i), WiFi.channel(i), WiFi.RSSI(i),
+                WiFi.encryptionType(i), _nodeId, now);
+    }
+}
+
+void SiteSurvey::forget(const uint8_t* bssid) {
+    for (Observation& o : _entries) {
+        if (o.ssidHash && memcmp(o.bssid, bssid, 6) == 0) o = Observation();
+    }
+}
+
+const SiteSurvey::Observation* SiteSurvey::best(PrioFn prioOf, uint32_t now, uint8_t channel) const {
+    const Observation* best = nullptr;
+    int bestPrio = SURVEY_NO_PRIO;
+    for (const Observation& o : _entries) {
+        if (!fresh(o, now) || (channel && o.channel != channel)) continue;
+        int prio = prioOf(o.ssidHash);
+        if (prio == SURVEY_NO_PRIO) continue;
+        if (!best || prio > bestPrio || (prio == bestPrio && o.rssi > best->rssi)) {
+            best = &o;
+            bestPrio = prio;
+        }
+    }
+    return best;
+}
+
+bool SiteSurvey::buildMessage(JsonDocument& doc, uint32_t now) {
+    doc["type"] = "SURVEY";
+    JsonArray arr = doc["o"].to<JsonArray>();
+    char hex[13];
+    uint8_t n = 0;
+    for (const Observation& o : _entries) {
+        if (n == SURVEY_PUBLISH_MAX) break;
+        if (o.observer != _nodeId || !fresh(o, now)) continue;
+        bssidToHex(o.bssid, hex);
+        JsonArray e = arr.add<JsonArray>();
+        e.add(o.ssidHash);
+        e.add(hex);
+        e.add(o.channel);
+        e.add(o.rssi);
+        e.add(o.auth);
+        e.add((now - o.seenAt) / 1000);
+        n++;
+    }
+    _changed = false;
+    return n > 0;
+}
+
+void SiteSurvey::handleMessage(uint32_t from, JsonDocument& doc, uint32_t now) {
+    uint8_t bssid[6];
+    for (JsonArrayConst e : doc["o"].as<JsonArrayConst>()) {
+        if (e.size() < 6 || !hexToBssid(e[1].as<const char*>(), bssid)) continue;
+        uint32_t age = e[5].as<uint32_t>() * 1000;
+        if (age >= SURVEY_FRESH_MS) continue;
+        observe(e[0].as<uint32_t>(), bssid, e[2].as<uint8_t>(), e[3].as<int8_t>(), e[4].as<uint8_t>(), from, now - age);
+        _received++;
+    }
+}
+
+String SiteSurvey::statusText(uint32_t now) const {
+    String out;
+    uint8_t freshCount = 0;
+    char hex[13];
+    for (const Observation& o : _entries) {
+        if (!fresh(o, now)) continue;
+        freshCount++;
+        bssidToHex(o.bssid, hex);
+        out += "• " + String(hex) + " Kanal " + String(o.channel) + ", " + String(o.rssi) + " dBm, vor " + String((now - o.seenAt) / 1000)
+             + " s" + (o.observer == _nodeId ? String(" (selbst)") : " (von " + String(o.observer) + ")") + "<br>";
+    }
+    return String(freshCount) + " frische APs, " + String(_scans) + " eigene Scans, " + String(_received) + " Beobachtungen empfangen, "
+         + String(_surveyConnects) + " Verbindungen ohne Scan, " + String(_surveyFailures) + " fehlgeschlagen<br>" + out;
+}
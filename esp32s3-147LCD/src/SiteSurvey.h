@@ -0,0 +1,79 @@
+#ifndef SITE_SURVEY_H
+#define SITE_SURVEY_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <functional>
+
+// =====================
+// SITE SURVEY
+// =====================
+
+#define SURVEY_MAX 24                   // Gemerkte Access Points (BSSIDs)
+#define SURVEY_FRESH_MS 300000          // Beobachtungen gelten 5 min, danach wieder selbst scannen
+#define SURVEY_MERGE_MS 30000           // Innerhalb dieses Fensters gewinnt die stärkere Beobachtung
+#define SURVEY_PUBLISH_MAX 8            // Eigene Beobachtungen pro SURVEY-Nachricht
+#define SURVEY_PUBLISH_MS 60000         // Uplink-Knoten melden ihre Verbindung so oft
+#define SURVEY_NO_PRIO -128             // prioOf(): SSID ist kein Kandidat
+
+/**
+ * Gemeinsame Sicht aller Knoten auf die Access Points in der Umgebung.
+ *
+ * Jeder Knoten meldet, was er selbst gesehen hat (eigene Scans und den
+ * aktuellen Uplink), als kompakte SURVEY-Nachricht: SSID-Hash, BSSID, Kanal,
+ * RSSI, Verschlüsselung und Alter in Sekunden. Empfänger rechnen das Alter auf
+ * die eigene Uhr um und behalten pro BSSID die neueste Beobachtung. Für die
+ * Verbindung wählt der Knoten daraus den besten bekannten AP (Priorität, dann
+ * RSSI) und verbindet sich ohne eigenen Scan; ist nichts frisch genug oder
+ * schlägt die Verbindung fehl, scannt er wie bisher selbst.
+ */
+class SiteSurvey {
+public:
+    struct Observation {
+        uint32_t ssidHash = 0;      // NetworkRegistry::hash(ssid), 0 = frei
+        uint8_t bssid[6] = {};
+        uint8_t channel = 0;
+        int8_t rssi = 0;
+        uint8_t auth = 0xFF;        // wifi_auth_mode_t, 0xFF = unbekannt
+        uint32_t observer = 0;
+        uint32_t seenAt = 0;        // millis() dieses Knotens
+    };
+
+    using KnownFn = std::function<bool(const char* ssid)>;
+    using PrioFn = std::function<int(uint32_t ssidHash)>;
+
+    void begin(uint32_t nodeId) { _nodeId = nodeId; }
+
+    void observe(uint32_t ssidHash, const uint8_t* bssid, uint8_t channel, int8_t rssi, uint8_t auth,
+                 uint32_t observer, uint32_t seenAt);
+    // Ergebnisse des letzten WiFi.scanNetworks() übernehmen (nur SSIDs, für die known() gilt)
+    void recordScan(int count, KnownFn known, uint32_t now);
+    // Verbindung über diese BSSID fehlgeschlagen: Beobachtung verwerfen
+    void forget(const uint8_t* bssid);
+
+    // Bester frischer AP nach Priorität, dann RSSI; channel != 0 nur auf diesem Kanal; nullptr = selbst scannen
+    const Observation* best(PrioFn prioOf, uint32_t now, uint8_t channel = 0) const;
+    void noteConnect(bool ok) { ok ? _surveyConnects++ : _surveyFailures++; }
+
+    // Eigene Beobachtungen seit der letzten Meldung geändert?
+    bool changed() const { return _changed; }
+    // Füllt eine SURVEY-Nachricht mit den eigenen frischen Beobachtungen; false = nichts zu melden
+    bool buildMessage(JsonDocument& doc, uint32_t now);
+    void handleMessage(uint32_t from, JsonDocument& doc, uint32_t now);
+
+    String statusText(uint32_t now) const;
+
+private:
+    Observation _entries[SURVEY_MAX];
+    uint32_t _nodeId = 0;
+    bool _changed = false;
+    uint32_t _scans = 0;
+    uint32_t _received = 0;
+    uint32_t _surveyConnects = 0;   // ohne eigenen Scan verbunden
+    uint32_t _surveyFailures = 0;
+
+    Observation* slotFor(const uint8_t* bssid);
+    static bool fresh(const Observation& o, uint32_t now) { return o.ssidHash && now - o.seenAt < SURVEY_FRESH_MS; }
+};
+
+#endif
@@ -1,4 +1,7 @@
 #include <qrcode.h>
+#include <esp_heap_caps.h>
+#include <esp_wifi.h>
+#include <Preferences.h>
 
 
 #include "SwarmConfigManager.h"
@@ -10,7 +13,7 @@
 SwarmConfigManager* SwarmConfigManager::_instance = nullptr;
 
 SwarmConfigManager::SwarmConfigManager(bool batteryPowered, const char* meshPrefix, const char* meshPass) 
-    : _isBatteryPowered(batteryPowered), _meshPrefix(meshPrefix), _meshPass(meshPass), _server(80) {
+    : _isBatteryPowered(batteryPowered), _meshPrefix(meshPrefix), _meshPass(meshPass), _server(80), _ota(_otaStorage) {
     _instance = this;
 }
 
@@ -27,38 +30,71 @@ void SwarmConfigManager::setup() {
     } else {
         Serial.println("[FS] LittleFS erfolgreich geladen.");
     }
+    _configWriter.begin(CONFIG_FILE);
+    // LED nach dem Blinken per Timer aus, ohne delay() im Empfangspfad
+    esp_timer_create_args_t blinkArgs = {};
+    blinkArgs.callback = [](void*) { digitalWrite(LED_PIN, LOW); };
+    blinkArgs.name = "blink";
+    esp_timer_create(&blinkArgs, &_blinkTimer);
+
+    // Puffer einmalig reservieren, damit der Empfangspfad nicht mehr allokiert.
+    // Große Arenen/Transferpuffer gehören in den PSRAM, interner RAM bleibt den Netzwerk-Stacks.
+    _arena.attach((uint8_t*)memPlace("mesh-json-arena", MESH_ARENA_SIZE, MEM_PSRAM), MESH_ARENA_SIZE);
+    _otaScratch = (uint8_t*)memPlace("ota-transfer", OTA_SCRATCH_SIZE, MEM_PSRAM);
+    _bridgeStore = (uint8_t*)memPlace("bridge-queue", BRIDGE_STORE_SIZE, MEM_PSRAM);
+    _txBuffer.reserve(MESH_TX_RESERVE);
+    _outbox.begin(
+        [this](uint32_t dest, const String& msg) {
+            _trace.record(MeshTrace::TX, dest, msg, 0);
+            if (dest) _mesh.sendSingle(dest, msg);
+            else _mesh.sendBroadcast(msg);
+        },
+        [this](String& msg) {
+            // Sequenz erst beim Senden vergeben und an das fertige JSON-Objekt anhängen
+            uint32_t seq = _reliability.nextSeq();
+            msg.remove(msg.length() - 1);
+            msg += ",\"seq\":";
+            msg += seq;
+            msg += ",\"ep\":";
+            msg += _reliability.epoch();
+            msg += '}';
+            _reliability.remember(seq, msg);
+        });
+    Preferences prefs;
+    prefs.begin("swarm", true);
+    strlcpy(_group, prefs.getString("group", "").c_str(), sizeof(_group));
+    prefs.end();
+    loadConfigCache();
+    _neighbours.load();
+    // Knoten-ID wie painlessMesh (Soft-AP-MAC), schon vor dem Mesh-Start für eigene Scans
+    uint8_t apMac[6];
+    esp_read_mac(apMac, ESP_MAC_WIFI_SOFTAP);
+    _survey.begin(NeighbourCache::nodeIdFromMac(apMac));
+
+    // Stabilität der Station mitzählen (Uplink und Mesh-Elternknoten)
+    WiFi.onEvent([](WiFiEvent_t, WiFiEventInfo_t) { _instance->_channel.noteStaConnected(); }, ARDUINO_EVENT_WIFI_STA_CONNECTED);
+    WiFi.onEvent([](WiFiEvent_t, WiFiEventInfo_t info) {
+        _instance->_channel.noteStaDropped(info.wifi_sta_disconnected.reason);
+    }, ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
 
     // 1. WLAN-Liste laden
-    updateWiFiMulti();
+    updateApPool();
 
-    // 2. Erster Verbindungsversuch (WiFiMulti)
+    // 2. Erster Verbindungsversuch (Kandidaten-Pool)
     Serial.println("[WLAN] Suche bekannte Netzwerke...");
-    if (_wifiMulti.run() == WL_CONNECTED) {
+    if (_apPool.run(_survey) == WL_CONNECTED) {
         Serial.print("[WLAN] Verbunden mit: ");
         Serial.println(WiFi.SSID());
     } else {
         Serial.println("[WLAN] Keine bekannten Netze gefunden oder Zeitüberschreitung.");
 
-        // 3. Mesh-Sync Versuch (Daten von Nachbarn holen)
-        Serial.println("[MESH] Starte passiven Sync-Versuch...");
-        _mesh.init(_meshPrefix, _meshPass, &_userScheduler, 5555);
-        _mesh.onReceive(&meshReceivedWrapper);
-        _meshStarted = true;
-
-        unsigned long start = millis();
-        while(!_syncReceived && (millis() - start < 15000)) {
-            _mesh.update();
-            if (millis() % 3000 == 0) {
-                Serial.println("[MESH] Sende SYNC_REQ...");
-                JsonDocument req; req["type"] = "SYNC_REQ";
-                String r; serializeJson(req, r); 
-                _mesh.sendBroadcast(r);
-            }
-            delay(1);
-        }
+        // 3. Mesh beitreten (gezielt über den Nachbar-Cache) und Config abgleichen
+        // Die Wartezeit endet mit dem ersten SYNC_RES oder SYNC_OK eines Nachbarn mit gleicher Prüfsumme
+        rejoinMesh();
+        waitForSync();
 
-        // 4. WiFiManager als letzter Ausweg (Nur für Always-On Knoten)
-        if (WiFi.status() != WL_CONNECTED && !_isBatteryPowered) {
+        // 4. WiFiManager als letzter Ausweg (Nur für Always-On Knoten ohne Config aus dem Mesh)
+        if (WiFi.status() != WL_CONNECTED && !_isBatteryPowered && !_syncReceived) {
             Serial.println("[WM] Starte WiFiManager Portal...");
             if(_meshStarted) { 
                 _mesh.stop(); 
@@ -71,6 +107,7 @@ void SwarmConfigManager::setup() {
             if(_wm.autoConnect("ESP32_SWARM_AP")) {
                 Serial.println("[WM] Neue Daten erhalten! Speichere und starte neu...");
                 addNewNetwork(WiFi.SSID(), WiFi.psk());
+                flushConfig();
                 delay(1000);
                 ESP.restart(); // WICHTIG: Heap säubern!
             }
@@ -80,10 +117,24 @@ void SwarmConfigManager::setup() {
     // 5. Finaler Mesh-Start für den Dauerbetrieb
     if (!_meshStarted) {
         Serial.println("[MESH] Initialisiere Mesh für Dauerbetrieb...");
-        _mesh.init(_meshPrefix, _meshPass, &_userScheduler, 5555);
-        _mesh.onReceive(&meshReceivedWrapper);
-        _meshStarted = true;
+        // Soft-AP und Station teilen sich einen Kanal: Mesh dort starten, wo Nachbarn bzw. Uplink sind
+        uint8_t uplinkCh = WiFi.status() == WL_CONNECTED ? WiFi.channel() : 0;
+        // Liegt das Mesh laut Cache auf dem Uplink-Kanal, entfällt der Scan
+        uint8_t cachedCh = _neighbours.cached().channel;
+        uint8_t meshCh = cachedCh && cachedCh == uplinkCh ? cachedCh : MeshChannel::scanForMesh(_meshPrefix);
+        startMesh(_channel.bootChannel(uplinkCh, meshCh));
     }
+    _channel.begin(_mesh.getNodeId());
+    startMeshOta();
+    setupTasks();
+    _time.begin(_mesh.getNodeId());
+    _bridge.begin(_mesh.getNodeId(),
+        // Weitergereichte STATUS haben denselben Typ und dasselbe Ziel wie der eigene: nicht zusammenfassen
+        [this](uint32_t dest, const String& msg, bool forwarded) {
+            meshSend(dest, msg, forwarded ? MeshOutbox::NO_COALESCE : 0);
+        },
+        [this](const String& msg) { meshBroadcast(msg); },
+        _bridgeStore);
 
     // 6. Webserver Routen
     _server.on("/", [this](){ handleRoot(); });
@@ -91,6 +142,16 @@ void SwarmConfigManager::setup() {
     _server.on("/view", [this](){ handleView(); });
     _server.on("/delete", [this](){ handleDelete(); });
     _server.on("/add", HTTP_POST, [this](){ handleAdd(); });
+    _server.on("/ota", HTTP_POST, [this](){
+        // Die SHA-Prüfung läuft noch im Flash-Worker, das Ergebnis steht danach auf der Admin-Seite
+        bool ok = _ota.state() == MeshOta::STAGED || _ota.flashBusy();
+        _server.send(ok ? 200 : 500, "text/plain", ok ? "OK: Image wird geprueft und im Mesh verteilt." : "FEHLER: Upload ungueltig.");
+    }, [this](){ handleOtaUpload(); });
+    _server.on("/bridge", HTTP_POST, [this](){ handleBridge(); });
+    _server.on("/group", HTTP_POST, [this](){ handleGroup(); });
+    _server.on("/trace", HTTP_GET, [this](){ handleTrace(); });
+    _server.on("/trace/replay", HTTP_GET, [this](){ handleTraceReplay(); });
+    _server.on("/trace/replay", HTTP_POST, [this](){ handleTraceReplay(); }, [this](){ handleTraceUpload(); });
     _server.on("/blink", [this](){ 
         Serial.println("[WEB] Blink Command ausgelöst.");
         sendBlinkCommand(); 
@@ -98,6 +159,7 @@ void SwarmConfigManager::setup() {
     });
     _server.on("/reboot", [](){ 
         Serial.println("[WEB] Reboot angefordert.");
+        _instance->flushConfig();
         ESP.restart(); 
     });
 
@@ -105,141 +167,1002 @@ void SwarmConfigManager::setup() {
 }
 
 void SwarmConfigManager::loop() {
-    if (_meshStarted) {
-        _mesh.update();
-    }
-    
-    if (_serverActive) {
-        _server.handleClient();
-        // Automatisches Beenden nach 5 Minuten Inaktivität
-        if (millis() - _serverStartTime > 300000) {
-            _server.stop();
-            _serverActive = false;
-            Serial.println("[WEB] Admin-Server Timeout erreicht. Gestoppt.");
-        }
-    }
+    // Alle periodischen Aufgaben laufen als Tasks im Scheduler (führt painlessMesh mit aus)
+    if (_meshStarted) _mesh.update();
+    else _userScheduler.execute();
 
-    // Button-Logic für Admin-Interface
-    if (digitalRead(TRIGGER_PIN) == LOW) {
-        delay(50);
-        if (!_serverActive) {
-            _server.begin();
-            _serverActive = true;
-            _serverStartTime = millis();
-            Serial.println("[WEB] Admin-Server via Button gestartet.");
-            printSerialQRCode("http://" + WiFi.localIP().toString());
-        }
+    if (_buttonPending) {
+        _buttonPending = false;
+        _taskButton.restartDelayed(BUTTON_DEBOUNCE_MS);
     }
 
-    // Verbindungswiederherstellung im Hintergrund (Alle 60s)
-    static unsigned long lastCheck = 0;
-    if (millis() - lastCheck > 60000) {
-        if (WiFi.status() != WL_CONNECTED) {
+    if (_serverActive) _server.handleClient();
+
+    // Flash-Worker fertig: Chunk bestätigen bzw. den nächsten anfordern, ohne auf den Tick zu warten
+    if (_ota.flashDone()) _taskOta.forceNextIteration();
+}
+
+// --- SCHEDULER ---
+
+void SwarmConfigManager::setupTasks() {
+    // Zentrale Übersicht aller periodischen Aufgaben: Intervall hier anpassen
+    _taskReliability.set(100, TASK_FOREVER, [this](){ serviceReliability(); });
+    _taskOta.set(100, TASK_FOREVER, [this](){
+        if (_ota.loop(millis())) {
+            Serial.println("[OTA] Neues Image aktiviert. Neustart...");
+            flushConfig();
+            delay(500);
+            ESP.restart();
+        }
+    });
+    _taskTime.set(1000, TASK_FOREVER, [this](){ serviceTime(); });
+    _taskBridge.set(1000, TASK_FOREVER, [this](){ serviceBridge(); });
+    _taskHeap.set(1000, TASK_FOREVER, [this](){ serviceHeapMonitor(); });
+    _taskChannel.set(1000, TASK_FOREVER, [this](){ serviceChannel(); });
+    _taskNeighbours.set(NBR_UPDATE_MS, TASK_FOREVER, [this](){ serviceNeighbours(); });
+    _taskSurvey.set(SURVEY_UPDATE_MS, TASK_FOREVER, [this](){ serviceSurvey(); });
+    // Nur solange der Admin-Server läuft
+    _taskLive.set(LIVE_UPDATE_MS, TASK_FOREVER, [this](){ serviceLive(); });
+    // Worker für empfangene Nachrichten: läuft nur, solange etwas in der Inbox liegt
+    _taskInbox.set(TASK_IMMEDIATE, TASK_FOREVER, [this](){
+        serviceInbox();
+        if (_inbox.empty()) _taskInbox.disable();
+    });
+    // Läuft nur, solange etwas wartet; die Buckets bestimmen den nächsten Lauf
+    _taskOutbox.set(TASK_IMMEDIATE, TASK_FOREVER, [this](){
+        uint32_t wait = _outbox.service(millis());
+        if (_outbox.empty()) _taskOutbox.disable();
+        else _taskOutbox.delay(wait);
+    });
+    _taskReconnect.set(60000, TASK_FOREVER, [this](){
+        // Nach Abgabe des Uplinks an den Kanal-Führer nicht sofort wieder verbinden
+        if (WiFi.status() != WL_CONNECTED && !_channel.uplinkBlocked(millis())) {
             Serial.println("[WLAN] Verbindung verloren. Versuche Reconnect...");
-            _wifiMulti.run();
+            // Mit Nachbarn nur auf dem Mesh-Kanal: die Station zöge den Soft-AP sonst mit, bevor
+            // CHAN_MOVE das Mesh erreicht. Liegt der Uplink nur woanders, wird der Wechsel angekündigt.
+            bool meshUp = _meshStarted && !_mesh.getNodeList(false).empty();
+            if (_apPool.run(_survey, meshUp ? _channel.channel() : 0) != WL_CONNECTED && _apPool.offChannel())
+                _channel.proposeMove(_apPool.offChannel());
         }
-        lastCheck = millis();
-    }
-
-    if (_isBatteryPowered && WiFi.status() == WL_CONNECTED) {
+    });
+    _taskBattery.set(1000, TASK_FOREVER, [this](){
+        if (WiFi.status() != WL_CONNECTED) return;
         Serial.println("[POWER] Batterie-Modus: Aufgabe fertig, schlafen...");
+        serviceNeighbours();
+        _neighbours.commit(millis(), true);
+        flushConfig();
         delay(2000);
         ESP.deepSleep(600e6); // 10 Min
+    });
+    // Einmalig: Entprellen nach Tastendruck, Server-Timeout nach dem Start
+    _taskButton.set(TASK_IMMEDIATE, TASK_ONCE, [this](){ handleButton(); });
+    _taskServerTimeout.set(TASK_IMMEDIATE, TASK_ONCE, [this](){
+        _server.stop();
+        _live.stop();
+        _taskLive.disable();
+        _serverActive = false;
+        Serial.println("[WEB] Admin-Server Timeout erreicht. Gestoppt.");
+    });
+
+    for (const NamedTask& t : _tasks) _userScheduler.addTask(*t.task);
+    _taskReliability.enable();
+    _taskOta.enable();
+    _taskTime.enable();
+    _taskBridge.enable();
+    _taskHeap.enable();
+    _taskChannel.enable();
+    _taskNeighbours.enable();
+    _taskSurvey.enable();
+    if (!_outbox.empty()) _taskOutbox.enable();
+    if (!_inbox.empty()) _taskInbox.enable();
+    _taskReconnect.enableDelayed(60000);
+    if (_isBatteryPowered) _taskBattery.enable();
+
+    attachInterrupt(digitalPinToInterrupt(TRIGGER_PIN), buttonIsr, FALLING);
+}
+
+void IRAM_ATTR SwarmConfigManager::buttonIsr() {
+    SwarmConfigManager* self = _instance;
+    self->_buttonPending = true;
+    if (self->_buttonHook) self->_buttonHook();
+}
+
+void SwarmConfigManager::handleButton() {
+    // Nach der Entprellzeit noch gedrückt: echter Tastendruck
+    if (digitalRead(TRIGGER_PIN) != LOW || _serverActive) return;
+    _server.begin();
+    _live.begin();
+    _taskLive.enable();
+    _serverActive = true;
+    _taskServerTimeout.restartDelayed(ADMIN_SERVER_TIMEOUT_MS);
+    Serial.println("[WEB] Admin-Server via Button gestartet.");
+    printSerialQRCode("http://" + WiFi.localIP().toString());
+}
+
+uint32_t SwarmConfigManager::msUntilNextDeadline() {
+    if (_buttonPending || _ota.flashDone()) return 0;
+    // Offener Admin-Server wird gepollt
+    uint32_t next = _serverActive ? SERVER_POLL_MS : UINT32_MAX;
+    for (const NamedTask& t : _tasks) {
+        long ms = _userScheduler.timeUntilNextIteration(*t.task);
+        if (ms >= 0) next = min(next, (uint32_t)ms);
+    }
+    return next;
+}
+
+String SwarmConfigManager::getTasksHTML() {
+    String out = "<div class='mesh-list'><b>Tasks:</b><br>";
+    for (const NamedTask& t : _tasks) {
+        long ms = _userScheduler.timeUntilNextIteration(*t.task);
+        out += "• " + String(t.name) + ": ";
+        out += ms < 0 ? String("aus") : "alle " + String(t.task->getInterval()) + " ms, nächster in " + String(ms) + " ms";
+        out += ", Läufe: " + String(t.task->getRunCounter()) + "<br>";
     }
+    out += "</div>";
+    return out;
 }
 
 // --- PRIVATER LOGIK-BLOCK ---
 
 uint32_t SwarmConfigManager::getLocalVersion() {
-    if (!LittleFS.exists(CONFIG_FILE)) return 0;
-    File f = LittleFS.open(CONFIG_FILE, "r");
-    JsonDocument doc;
-    deserializeJson(doc, f);
-    f.close();
-    return doc["version"] | 0;
+    return _localVersion;
 }
 
-void SwarmConfigManager::updateWiFiMulti() {
+void SwarmConfigManager::loadConfigCache() {
+    _localVersion = 0;
+    _registry.clear();
+    _syncResCache = "";
+    _syncResOtherGroup[0] = '\0';
     if (!LittleFS.exists(CONFIG_FILE)) return;
     File f = LittleFS.open(CONFIG_FILE, "r");
     JsonDocument doc;
     deserializeJson(doc, f);
     f.close();
-    JsonArray arr = doc["networks"].as<JsonArray>();
-    for (JsonObject n : arr) {
-        _wifiMulti.addAP(n["ssid"].as<const char*>(), n["pass"].as<const char*>());
-    }
-    Serial.print("[FS] WiFiMulti Liste aktualisiert. Einträge: ");
-    Serial.println(arr.size());
+    _localVersion = doc["version"] | 0;
+    _bridge.setUrl(doc["bridge_url"] | "");
+    // Mit Gruppe nur die relevanten Einträge im RAM halten
+    _registry.load(doc["networks"].as<JsonArrayConst>(), _group);
+    Serial.printf("[FS] Registry: %u Netze (Gruppe '%s'), Version %u\n", _registry.size(), _group, _localVersion);
+    buildSyncRes(_group, _syncResCache);
+    _configDigest = configDigest(_group);
 }
 
-void SwarmConfigManager::saveFullConfig(JsonDocument& doc, bool propagate) {
-    File f = LittleFS.open(CONFIG_FILE, "w");
-    if (serializeJson(doc, f) == 0) {
-        Serial.println("[ERROR] Konnte Datei nicht schreiben!");
+void SwarmConfigManager::updateApPool() {
+    // Nur die besten Einträge nach Priorität werden Verbindungskandidaten; nur Unterschiede anwenden
+    uint8_t changes = _apPool.sync(_registry);
+    if (changes) Serial.printf("[FS] WLAN-Kandidaten: %u Änderungen, %u von %u Netzen\n", changes, _apPool.size(), _registry.size());
+}
+
+void SwarmConfigManager::flushConfig() {
+    if (!_configWriter.flush(CONFIG_FLUSH_MS)) Serial.println("[FS] Config noch nicht geschrieben (Timeout)");
+}
+
+void SwarmConfigManager::buildSyncRes(const char* forGroup, String& out) {
+    JsonDocument doc;
+    doc["type"] = "SYNC_RES";
+    doc["version"] = _localVersion;
+    if (_bridge.url().length()) doc["bridge_url"] = _bridge.url();
+    _registry.save(doc["networks"].to<JsonArray>(), forGroup);
+    out = "";
+    serializeJson(doc, out);
+}
+
+void SwarmConfigManager::saveConfig() {
+    JsonDocument doc;
+    doc["version"] = _localVersion;
+    if (_bridge.url().length()) doc["bridge_url"] = _bridge.url();
+    _registry.save(doc["networks"].to<JsonArray>(), "");
+    // Nur serialisieren; geschrieben wird im Flash-Worker, mesh.update() wartet nicht auf LittleFS
+    String content;
+    serializeJson(doc, content);
+    // Bei der Wiedergabe nur zählen: der Stand wird danach ohnehin zurückgespielt
+    if (!_sandbox) _configWriter.submit(content);
+    MeshTrace::noteFlashWrite();
+    // Antwort für SYNC_REQ der eigenen Gruppe gleich mit vorbereiten
+    doc["type"] = "SYNC_RES";
+    _syncResCache = "";
+    serializeJson(doc, _syncResCache);
+    _syncResOtherGroup[0] = '\0';
+    _configDigest = configDigest(_group);
+    if (!_sandbox) updateApPool();
+}
+
+void SwarmConfigManager::propagateDelta(JsonDocument& delta, uint32_t base) {
+    if (!_meshStarted) return;
+    // Wartet noch ein NET_DELTA in der Outbox, wird die Operation angehängt und die
+    // wartende Nachricht ersetzt: ein Schwall von Änderungen geht als eine Nachricht raus
+    if (!_outbox.pending("NET_DELTA", 0)) {
+        _deltaBatch.clear();
+        _deltaBatch["base"] = base;
     }
-    f.close();
-    updateWiFiMulti();
-    if (_meshStarted && propagate) {
-        doc["type"] = "SYNC_RES";
-        String msg;
-        serializeJson(doc, msg);
-        _mesh.sendBroadcast(msg);
-        Serial.println("[MESH] Neue Config an alle gesendet.");
+    JsonArray ops = _deltaBatch["ops"].is<JsonArray>() ? _deltaBatch["ops"].as<JsonArray>() : _deltaBatch["ops"].to<JsonArray>();
+    ops.add(delta.as<JsonObjectConst>());
+
+    JsonDocument msg;
+    msg["type"] = "NET_DELTA";
+    if (ops.size() == 1) {
+        // Einzelne Operation in der bisherigen Form
+        for (JsonPairConst kv : ops[0].as<JsonObjectConst>()) msg[kv.key()] = kv.value();
+    } else {
+        msg["ops"] = ops;
     }
+    msg["base"] = _deltaBatch["base"];
+    msg["v"] = _localVersion;
+    sendReliableBroadcast(msg);
+    Serial.printf("[MESH] NET_DELTA v%u eingereiht (%u Operationen).\n", _localVersion, ops.size());
 }
 
-void SwarmConfigManager::addNewNetwork(String ssid, String pass) {
-    JsonDocument doc;
-    if (LittleFS.exists(CONFIG_FILE)) {
-        File f = LittleFS.open(CONFIG_FILE, "r");
-        deserializeJson(doc, f);
-        f.close();
-    }
-    doc["version"] = (doc["version"] | 0) + 1;
-    JsonArray arr = doc["networks"].as<JsonArray>();
-    if (arr.isNull()) arr = doc["networks"].to<JsonArray>();
-    
-    bool found = false;
-    for(JsonObject n : arr) { 
-        if(n["ssid"] == ssid) { n["pass"] = pass; found = true; break; } 
+void SwarmConfigManager::handleDelta(uint32_t from, JsonDocument& doc) {
+    uint32_t base = doc["base"] | 0;
+    uint32_t v = doc["v"] | 0;
+    if (v <= _localVersion) return;
+    if (base != _localVersion) {
+        // Zwischenstand verpasst: Delta nicht anwendbar, vollständigen Stand beim Absender holen
+        Serial.printf("[MESH] NET_DELTA v%u passt nicht auf v%u, fordere Vollsync bei %u an.\n", v, _localVersion, from);
+        sendSyncRequest(from);
+        return;
     }
-    if(!found) { 
-        JsonObject n = arr.add<JsonObject>(); 
-        n["ssid"] = ssid; n["pass"] = pass; 
+    // Zusammengefasste Deltas tragen mehrere Operationen in "ops"
+    if (doc["ops"].is<JsonArrayConst>()) {
+        for (JsonObjectConst op : doc["ops"].as<JsonArrayConst>()) applyDeltaOp(op);
+    } else {
+        applyDeltaOp(doc.as<JsonObjectConst>());
     }
-    saveFullConfig(doc, true);
+    // Auch Deltas fremder Gruppen heben die Version, sonst passt das nächste nicht mehr
+    _localVersion = v;
+    saveConfig();
+}
+
+void SwarmConfigManager::applyDeltaOp(JsonObjectConst d) {
+    const char* op = d["op"] | "";
+    if (strcmp(op, "put") == 0) {
+        JsonObjectConst n = d["n"];
+        const char* group = n["g"] | "";
+        if (NetworkRegistry::inScope(group, _group)) _registry.upsert(n["ssid"] | "", n["pass"] | "", n["prio"] | 0, group);
+    } else if (strcmp(op, "del") == 0) {
+        _registry.remove(d["ssid"] | "");
+    } else if (strcmp(op, "url") == 0) {
+        _bridge.setUrl(d["u"] | "");
+    }
+}
+
+void SwarmConfigManager::sendSyncRequest(uint32_t dest) {
+    JsonDocument req;
+    req["type"] = "SYNC_REQ";
+    req["g"] = _group;
+    req["v"] = _localVersion;
+    if (_localVersion) req["d"] = _configDigest;
+    String r;
+    serializeJson(req, r);
+    if (dest) meshSend(dest, r);
+    else meshBroadcast(r);
+}
+
+void SwarmConfigManager::addNewNetwork(String ssid, String pass, int8_t prio, String group) {
+    uint32_t base = _localVersion;
+    int i = _registry.upsert(ssid.c_str(), pass.c_str(), prio, group.c_str());
+    if (i < 0) return;
+    _localVersion++;
+    saveConfig();
+    JsonDocument delta;
+    delta["op"] = "put";
+    _registry.toJson(i, delta["n"].to<JsonObject>());
+    propagateDelta(delta, base);
     Serial.println("[FS] Netzwerk hinzugefügt: " + ssid);
 }
 
 void SwarmConfigManager::meshReceivedWrapper(uint32_t from, String &msg) {
-    JsonDocument doc;
-    if (deserializeJson(doc, msg)) return;
-    
-    if (doc["type"] == "SYNC_REQ" && !_instance->_isBatteryPowered) {
-        Serial.println("[MESH] SYNC_REQ erhalten von " + String(from));
-        if (LittleFS.exists(CONFIG_FILE)) {
-            File f = LittleFS.open(CONFIG_FILE, "r");
-            JsonDocument res; deserializeJson(res, f); f.close();
-            res["type"] = "SYNC_RES";
-            String out; serializeJson(res, out);
-            _instance->_mesh.sendSingle(from, out);
+    // Nur ablegen: painlessMesh verwirft msg nach dem Callback, der Inhalt wird verschoben statt kopiert
+    SwarmConfigManager* self = _instance;
+    if (!self->_inbox.push(from, msg, micros())) {
+        // Schlange voll: verwerfen statt im Callback zu verarbeiten (Worker läuft ohnehin schon)
+        self->_inbox.noteDropped();
+    }
+    if (self->_taskInbox.isEnabled()) self->_taskInbox.forceNextIteration();
+    else self->_taskInbox.enable();
+}
+
+void SwarmConfigManager::serviceInbox() {
+    uint32_t start = micros();
+    uint32_t from, waitUs;
+    for (uint8_t n = 0; n < INBOX_MAX_PER_RUN && micros() - start < INBOX_BUDGET_US; n++) {
+        if (!_inbox.pop(from, _rxMsg, waitUs, micros())) break;
+        uint32_t t0 = micros();
+        processMessage(from, _rxMsg);
+        _inbox.noteHandled(waitUs, micros() - t0);
+    }
+}
+
+void SwarmConfigManager::processMessage(uint32_t from, String& msg) {
+    uint32_t start = micros();
+    _arena.reset();
+    {
+        JsonDocument doc(&_arena);
+        DeserializationError err = deserializeJson(doc, msg);
+        if (!err) {
+            // doc lebt in der Arena: Handler antworten über _txBuffer bzw. eigene Heap-Dokumente
+            _arena.hold(true);
+            handleMeshMessage(from, doc);
+            _arena.hold(false);
+        } else if (err == DeserializationError::NoMemory) {
+            // Nachricht größer als die Arena (z.B. sehr große Config): ausnahmsweise über den Heap
+            _arenaFallbacks++;
+            JsonDocument heapDoc;
+            if (!deserializeJson(heapDoc, msg)) handleMeshMessage(from, heapDoc);
         }
+    }
+    _arena.reset();
+    _trace.record(MeshTrace::RX, from, msg, micros() - start);
+}
+
+// Alle Sendewege laufen hier durch: Outbox (Priorität, Rate, Coalescing), unterdrückt während der Trace-Wiedergabe
+void SwarmConfigManager::meshSend(uint32_t dest, const String& msg, uint8_t flags) {
+    if (_sandbox) return;
+    _outbox.push(dest, msg, flags);
+    kickOutbox();
+}
+
+void SwarmConfigManager::meshBroadcast(const String& msg, uint8_t flags) {
+    meshSend(0, msg, flags);
+}
+
+void SwarmConfigManager::kickOutbox() {
+    // Vor setupTasks() ist der Task noch keinem Scheduler zugeordnet, enable() wirkt dann nicht
+    if (_taskOutbox.isEnabled()) _taskOutbox.forceNextIteration();
+    else _taskOutbox.enable();
+}
+
+void SwarmConfigManager::handleMeshMessage(uint32_t from, JsonDocument& doc) {
+    // Während der Trace-Wiedergabe gehen zustandsbehaftete Module an die Ersatzobjekte
+    MeshReliability& reliability = _sandbox ? _sandbox->reliability : _reliability;
+    MeshOta& ota = _sandbox ? _sandbox->ota : _ota;
+    MeshBridge& bridge = _sandbox ? _sandbox->bridge : _bridge;
+    MeshTime& meshTime = _sandbox ? _sandbox->time : _time;
+    SiteSurvey& survey = _sandbox ? _sandbox->survey : _survey;
+
+    // Reliable Broadcasts: Duplikate verwerfen, Lücken für NACK vormerken
+    if (!doc["seq"].isNull()) {
+        if (reliability.simulateLoss()) return;
+        MeshReliability::Verdict v = reliability.accept(from, doc["ep"].as<uint32_t>(), doc["seq"].as<uint32_t>(), millis());
+        if (v == MeshReliability::DUPLICATE) return;
+        doc.remove("seq");
+        doc.remove("ep");
+    }
+
+    if (ota.handleMessage(from, doc, millis())) {
+        // Nächsten Chunk sofort anfordern statt erst beim nächsten Task-Tick
+        if (!_sandbox) _taskOta.forceNextIteration();
+        return;
+    }
+    if (bridge.handleMessage(from, doc, _txBuffer, millis())) return;
+
+    if (doc["type"] == "TIME_SYNC") {
+        meshTime.handleSync(from, doc["s"].as<uint32_t>(), doc["us"].as<uint32_t>(), doc["nt"].as<uint32_t>(), _mesh.getNodeTime(), millis());
+    } else if (doc["type"] == "TIME_REQ") {
+        meshTime.handleRequest(millis());
+    } else if ((doc["type"] == "CHAN_MOVE" || doc["type"] == "CHAN_HB") && !_sandbox) {
+        _channel.handleAnnounce(from, doc["ch"].as<uint8_t>(), doc["e"].as<uint32_t>(), doc["in"] | 0, millis());
+    } else if (doc["type"] == "NACK") {
+        handleNack(from, doc);
+    } else if (doc["type"] == "SEQ_HB") {
+        reliability.noteHighest(from, doc["ep"].as<uint32_t>(), doc["hi"].as<uint32_t>(), millis());
+    } else if (doc["type"] == "NET_DELTA") {
+        handleDelta(from, doc);
+    } else if (doc["type"] == "SYNC_REQ" && !_isBatteryPowered) {
+        const char* group = doc["g"] | "";
+        // Nur vollständige Stände ausliefern: Registry-Halter bedienen jede Gruppe, sonst nur die eigene
+        if (_group[0] && strcmp(group, _group) != 0) return;
+        uint32_t v = doc["v"] | 0;
+        if (!_localVersion || v > _localVersion) return;
+        if (v == _localVersion) {
+            // Gleicher Stand: direkte Nachbarn bestätigen knapp, der Anfrager muss nicht weiter warten
+            uint32_t digest = strcmp(group, _group) == 0 ? _configDigest : configDigest(group);
+            if (doc["d"].isNull() || doc["d"].as<uint32_t>() != digest || meshHopsTo(from) != 1) return;
+            // Das empfangene Dokument belegt die Arena: zwei Felder direkt in den Sendepuffer
+            char ok[48];
+            snprintf(ok, sizeof(ok), "{\"type\":\"SYNC_OK\",\"v\":%u}", _localVersion);
+            _txBuffer = ok;
+            meshSend(from, _txBuffer);
+            return;
+        }
+        Serial.printf("[MESH] SYNC_REQ erhalten von %u (Gruppe '%s')\n", from, group);
+        if (strcmp(group, _group) == 0) {
+            // Antwort liegt fertig serialisiert vor: kein Flash-Zugriff, kein zweites Dokument
+            meshSend(from, _syncResCache);
+        } else {
+            // Registry-Halter: Antwort für die zuletzt angefragte fremde Gruppe bis zur nächsten Änderung behalten
+            if (!_syncResOtherGroup[0] || strcmp(group, _syncResOtherGroup) != 0) {
+                buildSyncRes(group, _syncResOther);
+                strlcpy(_syncResOtherGroup, group, sizeof(_syncResOtherGroup));
+            }
+            meshSend(from, _syncResOther);
+        }
+    } else if (doc["type"] == "SYNC_OK") {
+        if (doc["v"].as<uint32_t>() == _localVersion) _syncReceived = true;
     } else if (doc["type"] == "SYNC_RES") {
-        if (doc["version"].as<uint32_t>() > _instance->getLocalVersion()) {
+        if (doc["version"].as<uint32_t>() > _localVersion) {
             Serial.println("[MESH] Neue Config (SYNC_RES) erhalten!");
-            _instance->saveFullConfig(doc, false);
-            _instance->_syncReceived = true;
+            _registry.load(doc["networks"].as<JsonArrayConst>(), _group);
+            _bridge.setUrl(doc["bridge_url"] | "");
+            _localVersion = doc["version"];
+            saveConfig();
+            _syncReceived = true;
         }
-    } else if (doc["type"] == "BLINK_CMD") {
-        _instance->blinkLED();
+    } else if (doc["type"] == "SURVEY") {
+        survey.handleMessage(from, doc, millis());
+    } else if (doc["type"] == "BLINK_CMD" && !_sandbox) {
+        blinkLED();
+    }
+}
+
+// --- RELIABLE BROADCAST ---
+
+void SwarmConfigManager::sendReliableBroadcast(JsonDocument& doc) {
+    String msg;
+    serializeJson(doc, msg);
+    meshBroadcast(msg, MeshOutbox::RELIABLE);
+}
+
+void SwarmConfigManager::handleNack(uint32_t from, JsonDocument& doc) {
+    // NACKs einer früheren Epoche (vor unserem Neustart) sind nicht mehr bedienbar
+    if (doc["ep"].as<uint32_t>() != _reliability.epoch()) return;
+    for (uint32_t seq : doc["seqs"].as<JsonArray>()) {
+        const String* stored = _reliability.lookup(seq);
+        if (!stored) continue;
+        meshSend(from, *stored, MeshOutbox::NO_COALESCE);
+        if (!_sandbox) _reliability.countRetransmit();
+    }
+}
+
+void SwarmConfigManager::serviceReliability() {
+    uint32_t now = millis();
+
+    uint32_t origin, epoch, seqs[REL_MAX_NACK_SEQS];
+    uint8_t count;
+    while (_reliability.pollNack(now, origin, epoch, seqs, count)) {
+        _arena.reset();
+        {
+            JsonDocument nack(&_arena);
+            nack["type"] = "NACK";
+            nack["ep"] = epoch;
+            JsonArray arr = nack["seqs"].to<JsonArray>();
+            for (uint8_t i = 0; i < count; i++) arr.add(seqs[i]);
+            serializeJson(nack, _txBuffer);
+        }
+        _arena.reset();
+        meshSend(origin, _txBuffer);
+        _reliability.countNack();
+        Serial.printf("[MESH] NACK an %u (%u fehlende Nachrichten)\n", origin, count);
+    }
+
+    // Heartbeat mit unserer höchsten Sequenz, damit auch verlorene letzte Nachrichten auffallen
+    static unsigned long lastHb = 0;
+    if (_reliability.lastSeq() && now - lastHb > REL_HB_INTERVAL_MS) {
+        _arena.reset();
+        {
+            JsonDocument hb(&_arena);
+            hb["type"] = "SEQ_HB";
+            hb["ep"] = _reliability.epoch();
+            hb["hi"] = _reliability.lastSeq();
+            serializeJson(hb, _txBuffer);
+        }
+        _arena.reset();
+        meshBroadcast(_txBuffer);
+        lastHb = now;
+    }
+}
+
+String SwarmConfigManager::getReliabilityHTML() {
+    const MeshReliability::Stats& st = _reliability.stats();
+    uint32_t expected = st.delivered + st.lost;
+    uint32_t ratio = expected ? (st.delivered * 1000UL / expected) : 1000;
+    uint32_t overhead = st.nacksSent + st.retransmits;
+    String out = "<div class='mesh-list'><b>Reliable Broadcast:</b><br>";
+    out += "• Gesendet: " + String(st.sent) + ", Empfangen: " + String(st.delivered) + ", Duplikate: " + String(st.duplicates) + "<br>";
+    out += "• Nachgeholt: " + String(st.recovered) + ", Verloren: " + String(st.lost) + ", Sim-Verlust: " + String(st.simDropped) + "<br>";
+    out += "• Zustellrate: " + String(ratio / 10) + "." + String(ratio % 10) + " %, Overhead: " + String(overhead) + " Msgs (" + String(st.nacksSent) + " NACK / " + String(st.retransmits) + " RTX)<br>";
+    out += "</div>";
+    return out;
+}
+
+String SwarmConfigManager::getOutboxHTML() {
+    return "<div class='mesh-list'><b>Outbox:</b><br>" + _outbox.statusText() + "</div>";
+}
+
+// --- ZEITBASIS ---
+
+void SwarmConfigManager::serviceTime() {
+    uint32_t sec, usec;
+    uint32_t nodeTime = _mesh.getNodeTime();
+    MeshTime::Action action = _time.poll(millis(), hasUplink(), nodeTime, sec, usec);
+    if (action == MeshTime::NONE) return;
+
+    _arena.reset();
+    {
+        JsonDocument msg(&_arena);
+        if (action == MeshTime::SEND_SYNC) {
+            msg["type"] = "TIME_SYNC";
+            msg["s"] = sec;
+            msg["us"] = usec;
+            msg["nt"] = nodeTime;
+        } else {
+            msg["type"] = "TIME_REQ";
+        }
+        serializeJson(msg, _txBuffer);
+    }
+    _arena.reset();
+    meshBroadcast(_txBuffer);
+}
+
+// --- NACHBAR-CACHE / REJOIN ---
+
+// Knoten-ID des Elternknotens, wenn die Station mit einem Mesh-AP verbunden ist, sonst 0
+static uint32_t stationParent(const char* meshSsid, uint8_t* bssidOut) {
+    if (WiFi.status() != WL_CONNECTED || WiFi.SSID() != meshSsid) return 0;
+    const uint8_t* bssid = WiFi.BSSID();
+    if (!bssid) return 0;
+    if (bssidOut) memcpy(bssidOut, bssid, 6);
+    return NeighbourCache::nodeIdFromMac(bssid);
+}
+
+static uint32_t findRoot(const painlessmesh::protocol::NodeTree& tree) {
+    if (tree.root) return tree.nodeId;
+    for (auto&& sub : tree.subs) {
+        uint32_t id = findRoot(sub);
+        if (id) return id;
+    }
+    return 0;
+}
+
+bool SwarmConfigManager::hasUplink() {
+    // Eine Station am Mesh-Elternknoten ist kein Uplink
+    return WiFi.status() == WL_CONNECTED && WiFi.SSID() != _meshPrefix;
+}
+
+void SwarmConfigManager::rejoinMesh() {
+    const NeighbourCache::Snapshot& cache = _neighbours.cached();
+    if (!cache.channel) {
+        startMesh(_channel.bootChannel(0, MeshChannel::scanForMesh(_meshPrefix)));
+        return;
+    }
+    // Kein Vollscan: direkt auf dem gespeicherten Kanal starten und den letzten Elternknoten ansprechen
+    startMesh(_channel.bootChannel(0, cache.channel));
+    const NeighbourCache::Neighbour* parent = _neighbours.cachedParent();
+    if (parent) {
+        Serial.printf("[MESH] Gezielter Rejoin zu %u auf Kanal %u\n", parent->nodeId, cache.channel);
+        WiFi.begin(_meshPrefix, _meshPass, cache.channel, parent->bssid);
+    }
+
+    uint32_t start = millis();
+    while (millis() - start < NBR_REJOIN_TIMEOUT_MS) {
+        _mesh.update();
+        serviceInbox();
+        _outbox.service(millis());
+        if (_neighbours.rejoinMs()) return;
+        delay(1);
+    }
+    // Cache veraltet (Mesh umgezogen, Elternknoten weg): wie ohne Cache suchen
+    Serial.println("[MESH] Gezielter Rejoin erfolglos, suche auf allen Kanälen...");
+    uint8_t found = MeshChannel::scanForMesh(_meshPrefix);
+    if (found && found != _channel.channel()) startMesh(found);
+}
+
+void SwarmConfigManager::waitForSync() {
+    uint32_t start = millis();
+    uint32_t nextReq = start + random(SYNC_REQ_JITTER_MS);
+    while (!_syncReceived && millis() - start < SYNC_WAIT_MS) {
+        _mesh.update();
+        if ((int32_t)(millis() - nextReq) >= 0) {
+            Serial.println("[MESH] Sende SYNC_REQ...");
+            sendSyncRequest(0);
+            nextReq = millis() + SYNC_REQ_INTERVAL_MS + random(SYNC_REQ_JITTER_MS);
+        }
+        // Tasks laufen erst nach dem Setup: Inbox und Outbox hier direkt bedienen
+        serviceInbox();
+        _outbox.service(millis());
+        delay(1);
+    }
+}
+
+void SwarmConfigManager::serviceNeighbours() {
+    uint8_t bssid[6];
+    uint32_t parent = stationParent(_meshPrefix, bssid);
+    painlessmesh::protocol::NodeTree tree = _mesh.asNodeTree();
+    _neighbours.beginUpdate(_channel.channel(), findRoot(tree), _localVersion, _configDigest);
+    if (parent) _neighbours.add(parent, bssid, NeighbourCache::PARENT);
+    for (auto&& sub : tree.subs) {
+        if (sub.nodeId != parent) _neighbours.add(sub.nodeId, nullptr, 0);
+    }
+    _neighbours.commit(millis());
+}
+
+void SwarmConfigManager::serviceSurvey() {
+    uint32_t now = millis();
+    // Uplink-Knoten melden ihre Verbindung ohne Scan: nach einem AP-Ausfall wissen die anderen, wohin
+    if (hasUplink() && (!_lastUplinkReport || now - _lastUplinkReport >= SURVEY_PUBLISH_MS)) {
+        _survey.observe(NetworkRegistry::hash(WiFi.SSID().c_str()), WiFi.BSSID(), WiFi.channel(), WiFi.RSSI(), 0xFF,
+                        _mesh.getNodeId(), now);
+        _lastUplinkReport = now;
+    }
+    if (!_meshStarted || !_survey.changed()) return;
+    bool any;
+    _arena.reset();
+    {
+        JsonDocument doc(&_arena);
+        any = _survey.buildMessage(doc, now);
+        if (any) serializeJson(doc, _txBuffer);
+    }
+    _arena.reset();
+    if (any) meshBroadcast(_txBuffer);
+}
+
+void SwarmConfigManager::serviceLive() {
+    _live.setMetric("heap", ESP.getFreeHeap(), 1024);
+    _live.setMetric("blk", heap_caps_get_largest_free_block(MALLOC_CAP_8BIT), 1024);
+    _live.setMetric("cfg", _localVersion);
+    _live.setMetric("ch", _channel.channel());
+    _live.setMetric("nodes", getMeshNodeCount());
+    _live.setMetric("q", _outbox.queued(MeshOutbox::CONTROL) + _outbox.queued(MeshOutbox::CONFIG) + _outbox.queued(MeshOutbox::BULK));
+
+    // Knotenliste aus der Topologie; RSSI kennen wir nur für direkte Nachbarn
+    _live.beginNodes();
+    for (uint32_t id : _mesh.getNodeList(false)) _live.node(id, 0);
+    uint32_t parent = stationParent(_meshPrefix, nullptr);
+    if (parent) _live.node(parent, WiFi.RSSI());
+    wifi_sta_list_t stations;
+    if (esp_wifi_ap_get_sta_list(&stations) == ESP_OK) {
+        for (int i = 0; i < stations.num; i++) {
+            // Knoten-ID kommt von der Soft-AP-MAC, verbunden ist die Station-MAC (= Soft-AP-MAC - 1)
+            uint8_t mac[6];
+            memcpy(mac, stations.sta[i].mac, 6);
+            for (int b = 5; b >= 0 && ++mac[b] == 0; b--) {}
+            uint32_t id = NeighbourCache::nodeIdFromMac(mac);
+            if (_mesh.isConnected(id)) _live.node(id, stations.sta[i].rssi);
+        }
+    }
+    _live.loop(millis());
+}
+
+uint32_t SwarmConfigManager::configDigest(const char* forGroup) {
+    return _registry.digest(forGroup) ^ (NetworkRegistry::hash(_bridge.url().c_str()) * 2654435761UL);
+}
+
+// --- KANAL ---
+
+void SwarmConfigManager::startMesh(uint8_t channel) {
+    bool uplink = hasUplink() && !_channel.uplinkBlocked(millis());
+    String ssid = uplink ? WiFi.SSID() : String();
+    String psk = uplink ? WiFi.psk() : String();
+    if (_meshStarted) {
+        // painlessMesh kennt keinen Kanalwechsel zur Laufzeit: neu starten (trennt auch die Station)
+        _mesh.stop();
+        _meshStarted = false;
+    }
+    _mesh.init(_meshPrefix, _meshPass, &_userScheduler, MESH_PORT, WIFI_AP_STA, channel);
+    _mesh.onReceive(&meshReceivedWrapper);
+    _mesh.onChangedConnections([](){
+        _instance->_channel.noteMeshChange();
+        _instance->_neighbours.noteJoined(millis(), stationParent(_instance->_meshPrefix, nullptr));
+    });
+    // Uplink fest vorgeben, sonst sucht die Station nach Mesh-Knoten und verliert den Uplink
+    if (uplink) _mesh.stationManual(ssid, psk);
+    _meshStarted = true;
+    memNoteNetworkUp();
+    _channel.applied(channel, millis());
+}
+
+void SwarmConfigManager::serviceChannel() {
+    uint32_t now = millis();
+    bool uplink = hasUplink() && !_channel.uplinkBlocked(now);
+    uint8_t ch = 0;
+    MeshChannel::Action action = _channel.poll(now, uplink, uplink ? WiFi.channel() : 0, _mesh.getNodeList(false).size(), ch);
+
+    switch (action) {
+    case MeshChannel::ANNOUNCE: {
+        // Zuverlässig verteilen: wer die Ankündigung verpasst, holt sie per NACK nach
+        JsonDocument msg;
+        msg["type"] = "CHAN_MOVE";
+        msg["ch"] = ch;
+        msg["e"] = _channel.epoch();
+        msg["in"] = CHAN_MOVE_DELAY_MS;
+        sendReliableBroadcast(msg);
+        break;
+    }
+    case MeshChannel::HEARTBEAT:
+        _arena.reset();
+        {
+            JsonDocument msg(&_arena);
+            msg["type"] = "CHAN_HB";
+            msg["ch"] = ch;
+            msg["e"] = _channel.epoch();
+            serializeJson(msg, _txBuffer);
+        }
+        _arena.reset();
+        meshBroadcast(_txBuffer);
+        break;
+    case MeshChannel::SWITCH:
+        if (uplink && WiFi.channel() == ch) {
+            // Der Soft-AP ist mit dem Uplink bereits umgezogen
+            _channel.applied(ch, now);
+        } else {
+            Serial.printf("[MESH] Wechsle Mesh auf Kanal %u...\n", ch);
+            startMesh(ch);
+            // Eigener angekündigter Wechsel: Uplink jetzt auf dem neuen Kanal verbinden
+            if (!uplink && _channel.isOwner()) _taskReconnect.forceNextIteration();
+        }
+        break;
+    case MeshChannel::YIELD:
+        Serial.printf("[WLAN] Uplink auf fremdem Kanal, Mesh auf Kanal %u hat Vorrang. Uplink pausiert.\n", ch);
+        WiFi.disconnect();
+        startMesh(ch);
+        break;
+    case MeshChannel::RESCAN: {
+        Serial.println("[MESH] Keine Nachbarn, suche Mesh auf allen Kanälen...");
+        uint8_t found = MeshChannel::scanForMesh(_meshPrefix);
+        if (found && found != ch) startMesh(found);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+// --- BRIDGE ---
+
+void SwarmConfigManager::serviceBridge() {
+    if (!_bridge.loop(millis(), hasUplink())) return;
+    _bridge.setNodeCount(getMeshNodeCount());
+    _arena.reset();
+    {
+        JsonDocument status(&_arena);
+        fillStatus(status);
+        _bridge.publish(status, _txBuffer, millis());
+    }
+    _arena.reset();
+}
+
+void SwarmConfigManager::fillStatus(JsonDocument& doc) {
+    static bool first = true;
+    doc["type"] = "STATUS";
+    doc["up"] = millis() / 1000;
+    doc["heap"] = ESP.getFreeHeap();
+    doc["blk"] = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    doc["nodes"] = getMeshNodeCount();
+    doc["cfg"] = _localVersion;
+    if (WiFi.status() == WL_CONNECTED) doc["rssi"] = WiFi.RSSI();
+    doc["ch"] = _channel.channel();
+    doc["sd"] = _channel.stats().staDrops;
+    if (_neighbours.rejoinMs()) doc["rj"] = _neighbours.rejoinMs();
+    if (_time.valid()) doc["t"] = (uint32_t)time(nullptr);
+    // Erster STATUS nach dem Start meldet den Reset-Grund als Ereignis
+    if (first) doc["boot"] = (int)esp_reset_reason();
+    first = false;
+}
+
+void SwarmConfigManager::handleBridge() {
+    uint32_t base = _localVersion;
+    _bridge.setUrl(_server.arg("u"));
+    _localVersion++;
+    saveConfig();
+    JsonDocument delta;
+    delta["op"] = "url";
+    delta["u"] = _server.arg("u");
+    propagateDelta(delta, base);
+    Serial.println("[WEB] Bridge-URL gesetzt: " + _server.arg("u"));
+    _server.sendHeader("Location", "/"); _server.send(303);
+}
+
+void SwarmConfigManager::handleGroup() {
+    String group = _server.arg("g");
+    group.trim();
+    Preferences prefs;
+    prefs.begin("swarm", false);
+    prefs.putString("group", group);
+    prefs.end();
+    strlcpy(_group, group.c_str(), sizeof(_group));
+    Serial.printf("[WEB] Gruppe gesetzt: '%s'\n", _group);
+    // Auf die neue Gruppe filtern und Version zurücksetzen: der nächste Sync liefert deren Einträge vollständig
+    flushConfig();
+    loadConfigCache();
+    _localVersion = 0;
+    saveConfig();
+    if (_meshStarted) sendSyncRequest(0);
+    _server.sendHeader("Location", "/view"); _server.send(303);
+}
+
+// --- TRACE ---
+
+void SwarmConfigManager::handleTrace() {
+    if (_server.hasArg("capture")) {
+        bool ok = _trace.setCapture(_server.arg("capture") == "1");
+        if (!ok) { _server.send(500, "text/plain", "FEHLER: kein Speicher fuer den Trace-Puffer."); return; }
+        _server.sendHeader("Location", "/"); _server.send(303);
+        return;
+    }
+    MeshTrace::FileHeader hdr = {TRACE_MAGIC, TRACE_VERSION, sizeof(MeshTrace::Record), _trace.count()};
+    size_t total = sizeof(hdr);
+    uint32_t pos;
+    for (const MeshTrace::Record* r = _trace.first(pos); r; r = _trace.next(pos)) total += r->total();
+    _server.sendHeader("Content-Disposition", "attachment; filename=mesh-trace.bin");
+    _server.setContentLength(total);
+    _server.send(200, "application/octet-stream", "");
+    _server.sendContent((const char*)&hdr, sizeof(hdr));
+    for (const MeshTrace::Record* r = _trace.first(pos); r; r = _trace.next(pos)) _server.sendContent((const char*)r, r->total());
+}
+
+void SwarmConfigManager::handleTraceUpload() {
+    HTTPUpload& up = _server.upload();
+    if (up.status == UPLOAD_FILE_START) {
+        Serial.println("[WEB] Trace-Upload: " + up.filename);
+        _trace.loadBegin();
+    } else if (up.status == UPLOAD_FILE_WRITE) {
+        _trace.loadWrite(up.buf, up.currentSize);
+    } else if (up.status == UPLOAD_FILE_END) {
+        _trace.loadFinish();
+    }
+}
+
+// Spielt alle vollständig mitgeschnittenen RX-Nachrichten direkt durch processMessage und misst
+// pro Nachricht Handler-Dauer, Flash-Schreibzugriffe und Heap-Blöcke. Gesendet wird dabei nichts,
+// zustandsbehaftete Module laufen auf Ersatzobjekten und der Config-Stand wird danach zurückgespielt.
+void SwarmConfigManager::handleTraceReplay() {
+    _trace.setCapture(false);
+    // Eigene Duplikaterkennung pro Lauf, die Live-Instanz bleibt unberührt
+    _sandbox = new ReplaySandbox();
+    _sandbox->time = _time;
+    _sandbox->time.setDryRun(true);
+    _sandbox->survey = _survey;
+    _sandbox->ota.begin([](uint32_t, const String&) {}, [](const String&) {},
+                        [this](uint32_t nodeId) { return meshHopsTo(nodeId); }, _otaScratch);
+    _sandbox->bridge.begin(_mesh.getNodeId(), [](uint32_t, const String&, bool) {}, [](const String&) {}, nullptr);
+
+    // Config-Stand sichern: Registry tauschen und kopieren, damit die Handler auf einer Kopie arbeiten
+    NetworkRegistry savedRegistry;
+    savedRegistry.swap(_registry);
+    if (!_registry.copyFrom(savedRegistry)) {
+        _registry.swap(savedRegistry);
+        delete _sandbox;
+        _sandbox = nullptr;
+        _server.send(500, "text/plain", "FEHLER: kein Speicher fuer die Registry-Kopie.");
+        return;
+    }
+    uint32_t savedVersion = _localVersion;
+    uint32_t savedDigest = _configDigest;
+    String savedSyncRes = _syncResCache;
+    String savedUrl = _bridge.url();
+    bool savedSyncReceived = _syncReceived;
+
+    _server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    _server.send(200, "text/csv", "");
+    _server.sendContent("idx,type,from,size,us,flash,blocks\n");
+
+    uint32_t n = 0, totalUs = 0, maxUs = 0;
+    uint32_t flashStart = MeshTrace::flashWrites();
+    uint32_t fallbacksStart = _arenaFallbacks;
+    int32_t blocksTotal = 0;
+    multi_heap_info_t before, after;
+    String msg;
+    char line[96];
+    uint32_t pos;
+    for (const MeshTrace::Record* r = _trace.first(pos); r; r = _trace.next(pos)) {
+        // Gekürzte Nachrichten ließen sich nicht parsen und würden das Ergebnis verfälschen
+        if (r->dir != MeshTrace::RX || r->len < r->size) continue;
+        msg = "";
+        msg.concat(_trace.payload(r), r->len);
+
+        heap_caps_get_info(&before, MALLOC_CAP_8BIT);
+        uint32_t flash = MeshTrace::flashWrites();
+        uint32_t t0 = micros();
+        processMessage(r->peer, msg);
+        uint32_t us = micros() - t0;
+        heap_caps_get_info(&after, MALLOC_CAP_8BIT);
+
+        int32_t blocks = (int32_t)after.allocated_blocks - (int32_t)before.allocated_blocks;
+        snprintf(line, sizeof(line), "%u,%s,%u,%u,%u,%u,%d\n", n, MeshTrace::typeOf(_trace.payload(r), r->len).c_str(),
+                 r->peer, r->size, us, MeshTrace::flashWrites() - flash, blocks);
+        _server.sendContent(line);
+        n++;
+        totalUs += us;
+        maxUs = max(maxUs, us);
+        blocksTotal += blocks;
+    }
+    _registry.swap(savedRegistry);
+    _localVersion = savedVersion;
+    _configDigest = savedDigest;
+    _syncResCache = savedSyncRes;
+    _syncResOtherGroup[0] = '\0';
+    _bridge.setUrl(savedUrl);
+    _syncReceived = savedSyncReceived;
+    delete _sandbox;
+    _sandbox = nullptr;
+
+    snprintf(line, sizeof(line), "# messages=%u total_us=%u max_us=%u\n", n, totalUs, maxUs);
+    _server.sendContent(line);
+    snprintf(line, sizeof(line), "# flash_writes=%u heap_blocks=%d arena_fallbacks=%u\n",
+             MeshTrace::flashWrites() - flashStart, blocksTotal, _arenaFallbacks - fallbacksStart);
+    _server.sendContent(line);
+    _server.sendContent("");
+    Serial.printf("[TRACE] Wiedergabe: %u Nachrichten in %u us (max %u us).\n", n, totalUs, maxUs);
+}
+
+// --- HEAP SOAK ---
+
+void SwarmConfigManager::serviceHeapMonitor() {
+    static unsigned long lastLog = 0;
+    size_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    if (largest < _minLargestBlock) _minLargestBlock = largest;
+    if (millis() - lastLog < HEAP_SOAK_LOG_MS) return;
+    lastLog = millis();
+    Serial.printf("[HEAP] Frei: %u B, größter Block: %u B (min %u B), Arena max %u/%u B, Heap-Fallbacks: %u\n",
+                  ESP.getFreeHeap(), largest, _minLargestBlock, _arena.highWater(), _arena.capacity(), _arenaFallbacks);
+}
+
+String SwarmConfigManager::getHeapHTML() {
+    String out = "<div class='mesh-list'><b>Speicher:</b><br>";
+    out += "• Größter freier Block: " + String(heap_caps_get_largest_free_block(MALLOC_CAP_8BIT)) + " B (min " + String(_minLargestBlock) + " B)<br>";
+    out += "• Mesh-Arena: max " + String(_arena.highWater()) + " / " + String(_arena.capacity()) + " B, Heap-Fallbacks: " + String(_arenaFallbacks) + "<br>";
+    out += "</div>";
+    return out;
+}
+
+// --- MESH OTA ---
+
+void SwarmConfigManager::startMeshOta() {
+    _ota.begin(
+        [this](uint32_t dest, const String& msg) { meshSend(dest, msg); },
+        [this](const String& msg) { meshBroadcast(msg); },
+        [this](uint32_t nodeId) { return meshHopsTo(nodeId); },
+        _otaScratch);
+    _ota.startWorker();
+}
+
+static int hopsInTree(const painlessmesh::protocol::NodeTree& tree, uint32_t nodeId, int depth) {
+    if (tree.nodeId == nodeId) return depth;
+    for (auto&& sub : tree.subs) {
+        int hops = hopsInTree(sub, nodeId, depth + 1);
+        if (hops >= 0) return hops;
+    }
+    return -1;
+}
+
+int SwarmConfigManager::meshHopsTo(uint32_t nodeId) {
+    return hopsInTree(_mesh.asNodeTree(), nodeId, 0);
+}
+
+static uint8_t treeDepth(const painlessmesh::protocol::NodeTree& tree) {
+    uint8_t depth = 0;
+    for (auto&& sub : tree.subs) depth = max(depth, (uint8_t)(treeDepth(sub) + 1));
+    return depth;
+}
+
+uint16_t SwarmConfigManager::getMeshNodeCount() {
+    return _meshStarted ? _mesh.getNodeList(true).size() : 1;
+}
+
+uint8_t SwarmConfigManager::getMeshDepth() {
+    return _meshStarted ? treeDepth(_mesh.asNodeTree()) : 0;
+}
+
+uint32_t SwarmConfigManager::getConfigVersion() {
+    return _localVersion;
+}
+
+void SwarmConfigManager::handleOtaUpload() {
+    HTTPUpload& up = _server.upload();
+    if (up.status == UPLOAD_FILE_START) {
+        Serial.println("[WEB] Firmware-Upload: " + up.filename);
+        _ota.uploadStart();
+    } else if (up.status == UPLOAD_FILE_WRITE) {
+        _ota.uploadWrite(up.buf, up.currentSize);
+    } else if (up.status == UPLOAD_FILE_END) {
+        _ota.uploadFinish(millis());
     }
 }
 
 void SwarmConfigManager::blinkLED() {
     digitalWrite(LED_PIN, HIGH);
-    delay(200);
-    digitalWrite(LED_PIN, LOW);
+    esp_timer_stop(_blinkTimer);
+    esp_timer_start_once(_blinkTimer, BLINK_MS * 1000);
 }
 
 // --- UI & HTML (Zusammengefasst für Stabilität) ---
@@ -275,9 +1198,34 @@ void SwarmConfigManager::handleRoot() {
     html += "<style>body{font-family:sans-serif; background:#f4f7f9; text-align:center; padding:10px;} .card{background:white; padding:20px; border-radius:15px; box-shadow:0 4px 10px rgba(0,0,0,0.1); max-width:400px; margin:auto;} .btn{display:block; padding:12px; background:#1a73e8; color:white; text-decoration:none; border-radius:8px; margin:10px 0; font-weight:bold;} .mesh-list{text-align:left; font-size:0.85em; background:#eee; padding:10px; border-radius:8px; margin:15px 0; border-left:4px solid #1a73e8;} #qrcode{display:flex; justify-content:center; margin:20px;}</style></head><body>";
     html += "<div class='card'><h1>Swarm Admin</h1><p>Free Heap: " + String(ESP.getFreeHeap()) + " B</p><div id='qrcode'></div>";
     html += getMeshStatusHTML();
+    html += getReliabilityHTML();
+    html += getOutboxHTML();
+    html += getHeapHTML();
+    html += getTasksHTML();
+    html += "<div class='mesh-list'><b>Live:</b> <span id='lv-state'>verbinde...</span> (" + _live.statusText() + ")<br>";
+    html += "Heap <span id='lv-heap'>-</span> B, Block <span id='lv-blk'>-</span> B, Last <span id='lv-load'>-</span> %, Outbox <span id='lv-q'>-</span><br>";
+    html += "Config v<span id='lv-cfg'>-</span>, Kanal <span id='lv-ch'>-</span>, Knoten <span id='lv-nodes'>-</span><ul id='lv-list'></ul></div>";
+    html += "<div class='mesh-list'><b>Empfang:</b> " + _inbox.statusText() + "<br>Flash-Worker: " + _configWriter.statusText() + "</div>";
+    html += "<div class='mesh-list'><b>WLAN-Kandidaten:</b> " + _apPool.statusText() + "</div>";
+    html += "<div class='mesh-list'><b>Site Survey:</b> " + _survey.statusText(millis()) + "</div>";
+    html += "<div class='mesh-list'><b>Kanal:</b> " + _channel.statusText(millis()) + "</div>";
+    html += "<div class='mesh-list'><b>Nachbar-Cache:</b> " + _neighbours.statusText(millis()) + "</div>";
+    html += "<div class='mesh-list'><b>Zeit:</b> " + _time.statusText(millis()) + "</div>";
+    html += "<div class='mesh-list'><b>Bridge:</b> " + _bridge.statusText(millis()) + "<br>";
+    html += "<form action='/bridge' method='POST'><input name='u' placeholder='http://host:8080/ingest' value='" + _bridge.url() + "'><input type='submit' value='Speichern'></form></div>";
+    html += "<div class='mesh-list'><b>Trace:</b> " + String(_trace.capturing() ? "läuft" : "aus") + ", " + String(_trace.count()) + " Datensätze (" + String(_trace.bytes()) + " B), verdrängt: " + String(_trace.dropped()) + "<br>";
+    html += "<a href='/trace?capture=" + String(_trace.capturing() ? "0" : "1") + "'>" + String(_trace.capturing() ? "Stoppen" : "Starten") + "</a> | <a href='/trace'>Download</a> | <a href='/trace/replay'>Wiedergabe</a></div>";
+    html += "<div class='mesh-list'><b>Firmware:</b> " + _ota.statusText() + "<br>";
+    html += "<form action='/ota' method='POST' enctype='multipart/form-data'><input type='file' name='fw' accept='.bin'><input type='submit' value='Im Mesh verteilen'></form></div>";
     html += "<a href='/scan' class='btn' style='background:#34a853;'>WLAN Scannen</a>";
     html += "<a href='/view' class='btn'>Netzwerke verwalten</a>";
     html += "<a href='/blink' class='btn' style='background:#fbbc04; color:black;'>Alle finden (Blink)</a>";
+    // Live-Werte per Server-Sent Events: erst "snap", dann nur "diff"; die Seite muss nicht neu geladen werden
+    html += "<script>var N={},es=new EventSource('http://'+location.hostname+':" + String(LIVE_PORT) + LIVE_PATH + "');";
+    html += "function lv(d){for(var k in d){if(k=='n'){for(var i in d.n)N[i]=d.n[i];}else if(k=='x'){d.x.forEach(function(i){delete N[i];});}else{var e=document.getElementById('lv-'+k);if(e)e.textContent=d[k];}}";
+    html += "var h='';for(var i in N)h+='<li>'+i+(N[i]?' ('+N[i]+' dBm)':'')+'</li>';document.getElementById('lv-list').innerHTML=h;}";
+    html += "es.addEventListener('snap',function(e){N={};lv(JSON.parse(e.data));document.getElementById('lv-state').textContent='live';});";
+    html += "es.addEventListener('diff',function(e){lv(JSON.parse(e.data));});es.onerror=function(){document.getElementById('lv-state').textContent='getrennt';};</script>";
     html += "<script>new QRCode(document.getElementById('qrcode'), {text:'"+url+"', width:140, height:140});</script></div></body></html>";
     _server.send(200, "text/html", html);
 }
@@ -286,41 +1234,46 @@ void SwarmConfigManager::handleRoot() {
 
 void SwarmConfigManager::handleScan() {
     int n = WiFi.scanNetworks();
+    // Bekannte Netze gehen in den Site Survey und damit an die Nachbarn
+    _survey.recordScan(n, [this](const char* ssid) { return _apPool.find(ssid) != nullptr; }, millis());
     String html = "<html><body><h2>Scan</h2><table border='1'>";
     for (int i = 0; i < n; ++i) {
-        html += "<tr><td>" + WiFi.SSID(i) + "</td><td><form action='/add' method='POST'><input type='hidden' name='s' value='"+WiFi.SSID(i)+"'><input type='password' name='p'><input type='submit' value='Add'></form></td></tr>";
+        html += "<tr><td>" + WiFi.SSID(i) + "</td><td><form action='/add' method='POST'><input type='hidden' name='s' value='"+WiFi.SSID(i)+"'><input type='password' name='p'><input name='prio' size='2' placeholder='Prio'><input name='g' size='6' placeholder='Gruppe'><input type='submit' value='Add'></form></td></tr>";
     }
     html += "</table><br><a href='/'>Back</a></body></html>";
     _server.send(200, "text/html", html);
 }
 
 void SwarmConfigManager::handleView() {
-    String html = "<html><body><h2>Networks</h2><ul>";
-    if (LittleFS.exists(CONFIG_FILE)) {
-        File f = LittleFS.open(CONFIG_FILE, "r");
-        JsonDocument doc; deserializeJson(doc, f); f.close();
-        JsonArray arr = doc["networks"].as<JsonArray>();
-        for (int i=0; i<arr.size(); i++) {
-            html += "<li>" + arr[i]["ssid"].as<String>() + " <a href='/delete?id=" + String(i) + "'>[Del]</a></li>";
-        }
+    String html = "<html><head><meta charset='UTF-8'></head><body><h2>Networks</h2>";
+    html += "<form action='/group' method='POST'>Gruppe dieses Knotens: <input name='g' value='" + String(_group) + "'><input type='submit' value='Setzen'></form>";
+    html += "<p>" + String(_registry.size()) + " Einträge, Version " + String(_localVersion) + "</p><ul>";
+    for (size_t i = 0; i < _registry.size(); i++) {
+        const NetEntry& e = _registry.at(i);
+        html += "<li>" + String(e.ssid) + " (Prio " + String(e.prio) + (e.group[0] ? ", " + String(e.group) : String("")) + ") <form action='/delete' method='POST' style='display:inline'><input type='hidden' name='s' value='" + String(e.ssid) + "'><input type='submit' value='Del'></form></li>";
     }
     html += "</ul><a href='/'>Back</a></body></html>";
     _server.send(200, "text/html", html);
 }
 
 void SwarmConfigManager::handleDelete() {
-    if (_server.hasArg("id")) {
-        JsonDocument doc;
-        File f = LittleFS.open(CONFIG_FILE, "r"); deserializeJson(doc, f); f.close();
-        doc["networks"].as<JsonArray>().remove(_server.arg("id").toInt());
-        doc["version"] = (doc["version"] | 0) + 1;
-        saveFullConfig(doc, true);
+    // Per SSID statt Position: ein NET_DELTA kann die Reihenfolge seit dem Laden der Liste geändert haben
+    String ssid = _server.arg("s");
+    if (ssid.length() && _registry.find(ssid.c_str()) >= 0) {
+        uint32_t base = _localVersion;
+        _registry.remove(ssid.c_str());
+        _localVersion++;
+        saveConfig();
+        JsonDocument delta;
+        delta["op"] = "del";
+        delta["ssid"] = ssid;
+        propagateDelta(delta, base);
     }
     _server.sendHeader("Location", "/view"); _server.send(303);
 }
 
 void SwarmConfigManager::handleAdd() {
-    if(_server.hasArg("s") && _server.hasArg("p")) addNewNetwork(_server.arg("s"), _server.arg("p"));
+    if(_server.hasArg("s") && _server.hasArg("p")) addNewNetwork(_server.arg("s"), _server.arg("p"), _server.arg("prio").toInt(), _server.arg("g"));
     _server.sendHeader("Location", "/"); _server.send(303);
 }
 
@@ -339,11 +1292,6 @@ void SwarmConfigManager::printSerialQRCode(String url) {
 
 void SwarmConfigManager::sendBlinkCommand() {
     JsonDocument doc; doc["type"] = "BLINK_CMD";
-    String msg; serializeJson(doc, msg);
-    _mesh.sendBroadcast(msg);
+    sendReliableBroadcast(doc);
     blinkLED();
 }
-
-WiFiMulti   SwarmConfigManager::getWifiMulti() {
-    return _wifiMulti;
-}   
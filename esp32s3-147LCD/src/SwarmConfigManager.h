@@ -2,12 +2,29 @@
 #define SWARM_CONFIG_MANAGER_H
 
 #include <WiFi.h>
-#include <WiFiMulti.h>
 #include <WiFiManager.h>
 #include <LittleFS.h>
 #include <ArduinoJson.h>
 #include <WebServer.h>
 #include <painlessMesh.h>
+#include <esp_timer.h>
+
+#include "MeshReliability.h"
+#include "MeshOta.h"
+#include "MeshArena.h"
+#include "MeshTime.h"
+#include "MeshBridge.h"
+#include "NetworkRegistry.h"
+#include "MeshTrace.h"
+#include "MeshChannel.h"
+#include "MeshOutbox.h"
+#include "NeighbourCache.h"
+#include "AdminLive.h"
+#include "ApCandidatePool.h"
+#include "MeshInbox.h"
+#include "ConfigWriter.h"
+#include "SiteSurvey.h"
+#include "MemoryPlacement.h"
 
 
 // =====================
@@ -18,6 +35,28 @@
 #define MESH_PREFIX "ESP32_SWARM_NET"
 #define MESH_PASSWORD "meshpassword123"
 #define MESH_PORT 5555
+#define SYNC_WAIT_MS 15000              // Beim Start höchstens so lange auf SYNC_RES/SYNC_OK warten
+#define SYNC_REQ_INTERVAL_MS 3000
+#define SYNC_REQ_JITTER_MS 1000         // Nach einem Stromausfall fragen nicht alle Knoten gleichzeitig
+#define NBR_UPDATE_MS 10000             // Nachbar-Cache aktualisieren
+#define SURVEY_UPDATE_MS 5000           // Neue eigene Beobachtungen spätestens dann melden
+
+// Arena für das Parsen/Antworten von Mesh-Nachrichten (ohne Heap)
+#define MESH_ARENA_SIZE 16384
+// Vorab reservierter Sendepuffer für NACK/Heartbeat
+#define MESH_TX_RESERVE 512
+// Intervall des Heap-Soak-Logs (größter freier Block)
+#define HEAP_SOAK_LOG_MS 60000
+#define BLINK_MS 200
+#define CONFIG_FLUSH_MS 3000            // Vor Neustart/Deep Sleep höchstens so lange auf den Flash-Worker warten
+
+// =====================
+// SCHEDULER
+// =====================
+#define BUTTON_DEBOUNCE_MS 50
+#define ADMIN_SERVER_TIMEOUT_MS 300000  // Admin-Server nach 5 Minuten beenden
+#define SERVER_POLL_MS 5                // Abfrageintervall solange der Admin-Server läuft
+#define LIVE_UPDATE_MS 500              // Werte für die Live-Ansicht sammeln (gesendet wird gedrosselt)
 
 // =====================
 // ACCESS POINT
@@ -32,7 +71,19 @@ public:
     void setup();
     void loop();
 
-    WiFiMulti getWifiMulti();
+    // Scheduler für eigene periodische Aufgaben (z.B. UI-Refresh in main)
+    Scheduler& scheduler() { return _userScheduler; }
+    // Millisekunden bis zur nächsten fälligen Aufgabe: so lange darf die Hauptschleife schlafen
+    uint32_t msUntilNextDeadline();
+    // Wird zusätzlich im Button-Interrupt aufgerufen (muss IRAM-tauglich sein)
+    void setButtonHook(void (*hook)()) { _buttonHook = hook; }
+
+    // Status für Dashboard/Diagnose
+    uint16_t getMeshNodeCount();
+    uint8_t getMeshDepth();
+    uint32_t getConfigVersion();
+    // Eigene Kennzahl in der Live-Ansicht der Admin-Seite (key als String-Literal, z.B. Loop-Last)
+    void publishMetric(const char* key, int32_t value, int32_t deadband = 0) { _live.setMetric(key, value, deadband); }
 
 private:
     // Variablen
@@ -42,25 +93,124 @@ private:
     bool _meshStarted = false;
     bool _serverActive = false;
     bool _syncReceived = false;
-    unsigned long _serverStartTime = 0;
+    uint32_t _localVersion = 0;
+    uint32_t _arenaFallbacks = 0;
+    size_t _minLargestBlock = SIZE_MAX;
+    volatile bool _buttonPending = false;
+    void (*_buttonHook)() = nullptr;
 
     // Objekte
-    WiFiMulti _wifiMulti;
     WiFiManager _wm;
     WebServer _server;
     painlessMesh _mesh;
     Scheduler _userScheduler;
+    Task _taskReliability;
+    Task _taskOta;
+    Task _taskTime;
+    Task _taskBridge;
+    Task _taskHeap;
+    Task _taskReconnect;
+    Task _taskBattery;
+    Task _taskButton;
+    Task _taskServerTimeout;
+    Task _taskChannel;
+    Task _taskOutbox;
+    Task _taskNeighbours;
+    Task _taskLive;
+    Task _taskInbox;
+    Task _taskSurvey;
+    struct NamedTask {
+        const char* name;
+        Task* task;
+    };
+    const NamedTask _tasks[15] = {
+        {"Reliability", &_taskReliability}, {"OTA", &_taskOta}, {"Zeit", &_taskTime},
+        {"Bridge", &_taskBridge}, {"Heap", &_taskHeap}, {"Reconnect", &_taskReconnect},
+        {"Batterie", &_taskBattery}, {"Button", &_taskButton}, {"Server-Timeout", &_taskServerTimeout},
+        {"Kanal", &_taskChannel}, {"Outbox", &_taskOutbox}, {"Nachbarn", &_taskNeighbours},
+        {"Live", &_taskLive}, {"Inbox", &_taskInbox}, {"Survey", &_taskSurvey},
+    };
+    MeshReliability _reliability;
+    EspOtaStorage _otaStorage;
+    MeshOta _ota;
+    MeshArena _arena;
+    MeshTime _time;
+    MeshBridge _bridge;
+    MeshChannel _channel;
+    MeshOutbox _outbox;
+    NeighbourCache _neighbours;
+    ApCandidatePool _apPool;
+    SiteSurvey _survey;
+    uint32_t _lastUplinkReport = 0;
+    MeshInbox _inbox;
+    ConfigWriter _configWriter;
+    String _rxMsg;              // Nachricht, die der Worker gerade behandelt
+    esp_timer_handle_t _blinkTimer = nullptr;
+    AdminLive _live;
+    uint32_t _configDigest = 0; // Prüfsumme der eigenen Config (Gruppe), für SYNC_OK
+    JsonDocument _deltaBatch;   // NET_DELTA, das noch in der Outbox wartet (Operationen werden angehängt)
+    uint8_t* _otaScratch = nullptr;
+    uint8_t* _bridgeStore = nullptr;
+    String _txBuffer;           // wiederverwendeter Ausgabepuffer
+    String _syncResCache;       // fertig serialisierte SYNC_RES Antwort (eigene Gruppe)
+    String _syncResOther;       // dasselbe für die zuletzt angefragte fremde Gruppe
+    char _syncResOtherGroup[REG_GROUP_LEN] = "";  // "" = _syncResOther ungültig
+    NetworkRegistry _registry;
+    MeshTrace _trace;
+    // Trace-Wiedergabe: Ersatzobjekte statt der Live-Zustände, gesendet wird nichts.
+    // Config-Stand (Registry, Version) wird vorher gesichert und danach zurückgespielt.
+    struct ReplaySandbox {
+        MeshReliability reliability;    // eigene Duplikaterkennung, Live-Epoche und Historie bleiben
+        DryRunOtaStorage otaStorage;
+        MeshOta ota{otaStorage};
+        MeshBridge bridge;
+        MeshTime time;                  // Kopie, im Dry-Run ohne Zugriff auf die Systemuhr
+        SiteSurvey survey;
+    };
+    ReplaySandbox* _sandbox = nullptr;
+    char _group[REG_GROUP_LEN] = "";    // Gruppe dieses Knotens (NVS), "" = hält die ganze Registry
 
     // Interne Logik
     uint32_t getLocalVersion();
-    void updateWiFiMulti();
-    void saveFullConfig(JsonDocument& doc, bool propagate);
-    void addNewNetwork(String ssid, String pass);
+    void loadConfigCache();
+    void updateApPool();
+    void saveConfig();
+    void buildSyncRes(const char* forGroup, String& out);
+    void propagateDelta(JsonDocument& delta, uint32_t base);
+    void handleDelta(uint32_t from, JsonDocument& doc);
+    void applyDeltaOp(JsonObjectConst op);
+    void sendSyncRequest(uint32_t dest);
+    uint32_t configDigest(const char* forGroup);
+    bool hasUplink();
+    void rejoinMesh();
+    void waitForSync();
+    void serviceNeighbours();
+    void serviceLive();
+    void serviceSurvey();
+    void addNewNetwork(String ssid, String pass, int8_t prio = 0, String group = "");
     void sendBlinkCommand();
+    void sendReliableBroadcast(JsonDocument& doc);
+    void handleNack(uint32_t from, JsonDocument& doc);
+    void serviceReliability();
+    void serviceHeapMonitor();
+    void serviceTime();
+    void startMesh(uint8_t channel);
+    void serviceChannel();
+    void setupTasks();
+    void handleButton();
+    static void buttonIsr();
+    void serviceBridge();
+    void fillStatus(JsonDocument& doc);
+    void startMeshOta();
+    int meshHopsTo(uint32_t nodeId);
     void blinkLED();
     
     // UI & Diagnose
     String getMeshStatusHTML();
+    String getReliabilityHTML();
+    String getOutboxHTML();
+    String getHeapHTML();
+    String getTasksHTML();
     String getRSSILevel(int rssi);
     void printSerialQRCode(String url);
 
@@ -70,9 +220,22 @@ private:
     void handleView();
     void handleDelete();
     void handleAdd();
+    void handleOtaUpload();
+    void handleBridge();
+    void handleGroup();
+    void handleTrace();
+    void handleTraceUpload();
+    void handleTraceReplay();
 
     // Mesh Callbacks
     static void meshReceivedWrapper(uint32_t from, String &msg);
+    void meshSend(uint32_t dest, const String& msg, uint8_t flags = 0);
+    void meshBroadcast(const String& msg, uint8_t flags = 0);
+    void kickOutbox();
+    void serviceInbox();
+    void processMessage(uint32_t from, String& msg);
+    void flushConfig();
+    void handleMeshMessage(uint32_t from, JsonDocument& doc);
     static SwarmConfigManager* _instance; 
 };
 
@@ -19,17 +19,18 @@
 #include <Adafruit_GFX.h>
 #include <Adafruit_ST7789.h>
 #include <qrcode.h>
+#include <esp_pm.h>
 
 #include "SwarmConfigManager.h"
+#include "MemoryPlacement.h"
+#include "Dashboard.h"
+#include "PixelPipeline.h"
 
 extern "C"
 {
 #include "lvgl.h"
 }
 
-// Hardware timer for LVGL ticking
-hw_timer_t *lv_timer = NULL;
-
 // =====================
 // SwarmConfigManager 
 // see *.h for defines
@@ -38,15 +39,12 @@ hw_timer_t *lv_timer = NULL;
 // Konstruktor: (isBatteryPowered, MeshName, MeshPassword)
 SwarmConfigManager swarm(false, MESH_PREFIX, MESH_PASSWORD);
 
-uint8_t lastWLANStatus = 0; // Cache for WLAN status: 0 = not connected, 1 = connected
+// Current dashboard values, filled by the update_* functions below
+DashboardModel dash = {};
 
-// WiFi connect timeout per AP. Increase when connecting takes longer.
-const uint32_t connectTimeoutMs = 10000;
+// Busy time of the main loop, used for the load panel
+uint32_t loopBusyUs = 0;
 
-// NTP Info
-const char *strNTP = "at.pool.ntp.org";
-const long gmtOffset_sec = 3600;     // UTC+1 for Austria
-const int daylightOffset_sec = 3600; // +1 hour for DST
 // =====================
 // Display Größe
 // =====================
@@ -63,6 +61,36 @@ const int daylightOffset_sec = 3600; // +1 hour for DST
 #define TFT_RST 39
 #define TFT_BL 48
 
+// =====================
+// Display power / idle
+// =====================
+#define BL_PWM_CHANNEL 0
+#define BL_PWM_FREQ 5000
+#define BL_PWM_BITS 8
+#define BL_FULL 255
+#define BL_DIM 40
+#define UI_DIM_PIXEL_LEVEL 20    // content brightness while dimmed (of PIXEL_LEVEL_FULL)
+#define UI_DIM_AFTER_MS 60000    // dim backlight after 1 min without activity
+#define UI_SLEEP_AFTER_MS 300000 // backlight off + panel sleep after 5 min
+
+// Upper bound for one loop sleep: painlessMesh's own connection tasks are
+// not visible in swarm.msUntilNextDeadline()
+#define LOOP_MAX_SLEEP_MS 10
+#define UI_REFRESH_MS 1000
+
+enum PanelState
+{
+  PANEL_ON,
+  PANEL_DIM,
+  PANEL_SLEEP
+};
+PanelState panelState = PANEL_ON;
+uint8_t flushLevel = PIXEL_LEVEL_FULL;
+uint32_t lastActivity = 0;
+volatile bool uiWakeRequest = false;
+TaskHandle_t loopTaskHandle = NULL;
+Task uiRefreshTask;
+
 // =====================
 // Task Handles
 // =====================
@@ -75,19 +103,26 @@ Adafruit_ST7789 tft = Adafruit_ST7789(TFT_CS, TFT_DC, TFT_RST);
 // =====================
 // LVGL Buffer
 // =====================
-static lv_color_t buf1[LCD_WIDTH * 40];
+// Draw buffer lives in DMA-capable internal RAM; it is sized at runtime between
+// MIN and MAX lines so the network stacks keep their MEM_INTERNAL_RESERVE.
+// Sizing happens after swarm.setup(), when WiFi, lwIP and painlessMesh already
+// hold their memory; below MIN the buffer drops to FLOOR lines before giving up.
+#define LVGL_DRAW_LINES_MAX (LCD_HEIGHT / 2)
+#define LVGL_DRAW_LINES_MIN 40
+#define LVGL_DRAW_LINES_FLOOR 10
+static lv_color_t *buf1 = NULL;
+static bool guiReady = false;
 static lv_disp_draw_buf_t draw_buf;
 
-// =====================
-// LVGL Objekte
-// =====================
-lv_obj_t *label_time;
-lv_obj_t *label_wifi;
-
-// Interrupt Service Routine for LVGL tick
-void IRAM_ATTR lv_tick_handler()
+// BOOT button hook (runs inside the manager's button ISR): mark activity and
+// wake the loop out of its deadline sleep
+void IRAM_ATTR ui_wake_isr()
 {
-  lv_tick_inc(1);
+  uiWakeRequest = true;
+  BaseType_t woken = pdFALSE;
+  if (loopTaskHandle)
+    vTaskNotifyGiveFromISR(loopTaskHandle, &woken);
+  portYIELD_FROM_ISR(woken);
 }
 
 // =====================
@@ -98,14 +133,26 @@ void my_disp_flush(lv_disp_drv_t *disp,
                    const lv_area_t *area,
                    lv_color_t *color_p)
 {
+  uint32_t start = micros();
   uint32_t w = area->x2 - area->x1 + 1;
   uint32_t h = area->y2 - area->y1 + 1;
+  uint16_t *px = (uint16_t *)color_p;
+
+#if !LV_COLOR_16_SWAP
+  // Convert the whole area word-wise up front (the draw buffer is MEM_DMA, i.e.
+  // internal RAM); writePixels then sends the bytes as-is (bigEndian = true)
+  // instead of swapping pixel by pixel while it fills the SPI FIFO.
+  // While dimmed the same pass scales the content down.
+  Pixel_Swap16Scale(px, px, w * h, flushLevel);
+#endif
+  uint32_t convertUs = micros() - start;
 
   tft.startWrite();
   tft.setAddrWindow(area->x1, area->y1, w, h);
-  tft.writePixels((uint16_t *)color_p, w * h);
+  tft.writePixels(px, w * h, true, true);
   tft.endWrite();
 
+  Dashboard_NoteFlush(micros() - start, convertUs);
   lv_disp_flush_ready(disp);
 }
 
@@ -159,46 +206,52 @@ void my_disp_flush(lv_disp_drv_t *disp,
 // =====================
 // Zeit aktualisieren
 // =====================
-// Updates the time label on the LVGL GUI
+// Updates the time in the dashboard model (no wait: a missing clock must not block the loop)
 void update_time()
 {
   struct tm timeinfo;
-  if (!getLocalTime(&timeinfo))
+  if (!getLocalTime(&timeinfo, 0))
+  {
+    strcpy(dash.time, "--:--:--");
     return;
-
-  char buf[16];
-  strftime(buf, sizeof(buf), "%H:%M:%S", &timeinfo);
-  lv_label_set_text(label_time, buf);
+  }
+  strftime(dash.time, sizeof(dash.time), "%H:%M:%S", &timeinfo);
 }
 
 // =====================
 // WLAN Status aktualisieren
 // =====================
-// Checks WiFi status and updates the GUI label with IP, SSID, and RSSI
+// Reads WiFi status, IP, SSID and RSSI into the dashboard model.
+// Reconnecting is left to SwarmConfigManager; this only observes.
 void update_wifi_status()
 {
-  // if (WiFi.status() == WL_CONNECTED)
-  if (swarm.getWifiMulti().run(connectTimeoutMs) == WL_CONNECTED)
+  dash.wifiUp = WiFi.status() == WL_CONNECTED;
+  if (dash.wifiUp)
   {
-    if (lastWLANStatus == 0)
-    {
-      char infoStr[255];
-      sprintf(infoStr, "%s@%s (%ddBm)", WiFi.localIP().toString().c_str(), WiFi.SSID().c_str(), WiFi.RSSI());
-
-      lv_label_set_text(label_wifi, infoStr);
-      lastWLANStatus = 1;
-    }
+    snprintf(dash.wifi, sizeof(dash.wifi), "%s@%s", WiFi.localIP().toString().c_str(), WiFi.SSID().c_str());
+    dash.rssi = WiFi.RSSI();
   }
   else
   {
-    if (lastWLANStatus == 1)
-    {
-      lv_label_set_text(label_wifi, "NO WLAN");
-      lastWLANStatus = 0;
-    }
+    strcpy(dash.wifi, "NO WLAN");
   }
 }
 
+// =====================
+// Mesh/System Status aktualisieren
+// =====================
+// Mesh size and depth, config version, free heap and loop load over the last interval
+void update_system_status(uint32_t intervalMs)
+{
+  dash.meshNodes = swarm.getMeshNodeCount();
+  dash.meshDepth = swarm.getMeshDepth();
+  dash.cfgVersion = swarm.getConfigVersion();
+  dash.heapKb = ESP.getFreeHeap() / 1024;
+  dash.loopLoad = intervalMs ? min((uint32_t)100, loopBusyUs / (intervalMs * 10)) : 0;
+  loopBusyUs = 0;
+  swarm.publishMetric("load", dash.loopLoad, 5);
+}
+
 // =====================
 // Hintergrundtask für WLAN und NTP aktualisieren
 // =====================
@@ -221,13 +274,96 @@ void updateTimeWifiStatusTask(void *pvParameters)
 
 // =====================
 
-// Initializes the GUI: Backlight, SPI, TFT, LVGL, Timer, and UI elements
-void initGUI()
+// =====================
+// Backlight / Panel Power
+// =====================
+void set_backlight(uint8_t level)
 {
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+  ledcWrite(TFT_BL, level);
+#else
+  ledcWrite(BL_PWM_CHANNEL, level);
+#endif
+}
 
-  // Backlight
-  pinMode(TFT_BL, OUTPUT);
-  digitalWrite(TFT_BL, HIGH);
+// Content brightness applied in my_disp_flush; redraws the whole screen so
+// no area is left at the old level
+void set_flush_level(uint8_t level)
+{
+  if (flushLevel == level)
+    return;
+  flushLevel = level;
+  lv_obj_invalidate(lv_scr_act());
+}
+
+// Moves the panel between on, dimmed and asleep based on the idle time.
+// 'activity' restores full brightness and resumes rendering.
+void update_display_power(bool activity)
+{
+  uint32_t now = millis();
+  if (activity)
+  {
+    lastActivity = now;
+    if (panelState == PANEL_SLEEP)
+    {
+      tft.enableSleep(false);
+      Dashboard_Suspend(false);
+    }
+    if (panelState != PANEL_ON)
+    {
+      set_backlight(BL_FULL);
+      set_flush_level(PIXEL_LEVEL_FULL);
+    }
+    panelState = PANEL_ON;
+    return;
+  }
+
+  uint32_t idle = now - lastActivity;
+  if (panelState == PANEL_ON && idle > UI_DIM_AFTER_MS)
+  {
+    set_backlight(BL_DIM);
+    set_flush_level(UI_DIM_PIXEL_LEVEL);
+    panelState = PANEL_DIM;
+  }
+  else if (panelState == PANEL_DIM && idle > UI_SLEEP_AFTER_MS)
+  {
+    // Panel keeps its frame memory in sleep; LVGL is not run until wake-up
+    set_backlight(0);
+    tft.enableSleep(true);
+    Dashboard_Suspend(true);
+    panelState = PANEL_SLEEP;
+  }
+}
+
+// Lets the idle task enter light sleep between deadlines when the SDK supports it
+void enable_light_sleep()
+{
+#if CONFIG_PM_ENABLE && CONFIG_FREERTOS_USE_TICKLESS_IDLE
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+  esp_pm_config_t pm = {};
+#else
+  esp_pm_config_esp32s3_t pm = {};
+#endif
+  pm.max_freq_mhz = 240;
+  pm.min_freq_mhz = 80;
+  pm.light_sleep_enable = true;
+  if (esp_pm_configure(&pm) == ESP_OK)
+    Serial.println("[POWER] Automatic light sleep enabled.");
+#endif
+}
+
+// Initializes the panel: Backlight, SPI, TFT (shows black while the network comes up)
+void initDisplay()
+{
+
+  // Backlight (PWM, so it can be dimmed on idle)
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+  ledcAttach(TFT_BL, BL_PWM_FREQ, BL_PWM_BITS);
+#else
+  ledcSetup(BL_PWM_CHANNEL, BL_PWM_FREQ, BL_PWM_BITS);
+  ledcAttachPin(TFT_BL, BL_PWM_CHANNEL);
+#endif
+  set_backlight(BL_FULL);
 
   // SPI
   SPI.begin(TFT_SCLK, -1, TFT_MOSI, TFT_CS);
@@ -236,17 +372,30 @@ void initGUI()
   tft.init(LCD_HEIGHT, LCD_WIDTH);
   tft.setRotation(1);
   tft.fillScreen(ST77XX_BLACK);
+}
 
-  // LVGL
-  lv_init();
-  lv_timer = timerBegin(0, 80, true); // 80 MHz / 80 = 1 MHz
-
-  // Setup timer interrupt for LVGL ticking
-  timerAttachInterrupt(lv_timer, &lv_tick_handler, true);
-  timerAlarmWrite(lv_timer, 1000, true); // 1 ms
-  timerAlarmEnable(lv_timer);
+// Initializes LVGL and the UI elements. Runs after swarm.setup() so the draw
+// buffer is sized against the heap that is left once the network stacks run.
+// Returns false (panel off, node keeps running headless) if no buffer fits.
+bool initGUI()
+{
+  size_t drawLines = 0;
+  buf1 = (lv_color_t *)memPlaceRows("lvgl-draw-buf", LCD_WIDTH * sizeof(lv_color_t),
+                                    LVGL_DRAW_LINES_MAX, LVGL_DRAW_LINES_MIN, MEM_DMA, &drawLines);
+  if (!buf1)
+    buf1 = (lv_color_t *)memPlaceRows("lvgl-draw-buf", LCD_WIDTH * sizeof(lv_color_t),
+                                      LVGL_DRAW_LINES_MIN - 1, LVGL_DRAW_LINES_FLOOR, MEM_DMA, &drawLines);
+  if (!buf1)
+  {
+    Serial.println("[MEM] Kein Zeichenpuffer für LVGL, Anzeige bleibt aus!");
+    set_backlight(0);
+    tft.enableSleep(true);
+    return false;
+  }
 
-  lv_disp_draw_buf_init(&draw_buf, buf1, NULL, LCD_WIDTH * 40);
+  // LVGL (ticked from esp_timer inside Dashboard_Render, no timer interrupt)
+  lv_init();
+  lv_disp_draw_buf_init(&draw_buf, buf1, NULL, LCD_WIDTH * drawLines);
 
   static lv_disp_drv_t disp_drv;
   lv_disp_drv_init(&disp_drv);
@@ -257,14 +406,8 @@ void initGUI()
   lv_disp_drv_register(&disp_drv);
 
   // UI
-  label_time = lv_label_create(lv_scr_act());
-  lv_label_set_text(label_time, "--:--:--");
-  lv_obj_set_style_text_font(label_time, &lv_font_montserrat_48, 0);
-  lv_obj_align(label_time, LV_ALIGN_CENTER, 0, -20);
-
-  label_wifi = lv_label_create(lv_scr_act());
-  lv_label_set_text(label_wifi, "📡 WLAN...");
-  lv_obj_align(label_wifi, LV_ALIGN_BOTTOM_MID, 0, -10);
+  Dashboard_Init(&disp_drv);
+  return true;
 }
 
 
@@ -277,17 +420,40 @@ void initGUI()
 void setup()
 {
   Serial.begin(115200);
+  loopTaskHandle = xTaskGetCurrentTaskHandle();
 
   // SD Card
   // initSD();
 
-  initGUI();
-  
+  initDisplay();
+
   swarm.setup();
-  
 
-  // WLAN + NTP
-  configTime(3600, 3600, strNTP); // MEZ (+1h)
+  guiReady = initGUI();
+
+  // Boot-time memory map: where every large consumer ended up
+  memPrintMap();
+
+  // Idle handling: button wakes the panel, loop sleeps until the next deadline
+  swarm.setButtonHook(ui_wake_isr);
+  lastActivity = millis();
+
+  // Periodic UI update runs on the manager's scheduler like all other periodic work
+  uiRefreshTask.set(UI_REFRESH_MS, TASK_FOREVER, []()
+                    {
+    static uint32_t last = millis();
+    uint32_t now = millis();
+    update_time();
+    update_wifi_status();
+    update_system_status(now - last);
+    if (guiReady)
+      update_display_power(Dashboard_Update(dash));
+    last = now; });
+  swarm.scheduler().addTask(uiRefreshTask);
+  uiRefreshTask.enable();
+  enable_light_sleep();
+
+  // Time: SwarmConfigManager sets TZ; one NTP gateway per mesh distributes the clock (MeshTime)
 
   // setup async background tasks
   // temp wieder weg
@@ -303,19 +469,22 @@ void setup()
 
 void loop()
 {
-  lv_timer_handler(); // Handle LVGL tasks
+  uint32_t loopStart = micros();
 
-  swarm.loop(); // Handle Mesh, WiFiManager, WebServer, etc.
+  uint32_t uiWaitMs = guiReady ? Dashboard_Render() : UINT32_MAX; // Handle LVGL tasks (frame-capped, render budget)
 
-  // Periodic UI update (every 1 second)
-  static uint32_t last = 0;
-  if (millis() - last > 1000)
+  swarm.loop(); // Runs all scheduler tasks (mesh, UI refresh, ...) and the web server
+
+  if (uiWakeRequest && guiReady)
   {
-    last = millis();
-    update_time();
-    update_wifi_status();
+    uiWakeRequest = false;
+    update_display_power(true);
   }
 
-  delay(5);
+  loopBusyUs += micros() - loopStart;
+
+  // Sleep until the next deadline (LVGL timer, frame cap, scheduler task) or a wake-up notification
+  uint32_t waitMs = min(min(uiWaitMs, swarm.msUntilNextDeadline()), (uint32_t)LOOP_MAX_SLEEP_MS);
+  ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(waitMs));
 
 }
\ No newline at end of file
@@ -0,0 +1,71 @@
+#pragma once
+
+// Minimal Arduino surface for the host (native) tests: just what the tested
+// modules use. String builds on std::string so ArduinoJson treats it as one.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+
+using std::max;
+using std::min;
+
+class String : public std::string
+{
+public:
+  String() {}
+  String(const char *s) : std::string(s ? s : "") {}
+  String(const std::string &s) : std::string(s) {}
+  String(int v) : std::string(std::to_string(v)) {}
+  String(unsigned v) : std::string(std::to_string(v)) {}
+  String(long v) : std::string(std::to_string(v)) {}
+  String(unsigned long v) : std::string(std::to_string(v)) {}
+
+  String substring(size_t from, size_t to = npos) const
+  {
+    if (from > size())
+      return String();
+    return String(substr(from, to == npos ? npos : to - from));
+  }
+  long toInt() const { return strtol(c_str(), nullptr, 10); }
+};
+
+class HostSerial
+{
+public:
+  bool quiet = true;
+
+  void print(const char *s) { if (!quiet) fputs(s, stdout); }
+  void print(const std::string &s) { print(s.c_str()); }
+  void println(const char *s = "") { if (!quiet) puts(s); }
+  void println(const std::string &s) { println(s.c_str()); }
+  void printf(const char *fmt, ...)
+  {
+    if (quiet)
+      return;
+    va_list ap;
+    va_start(ap, fmt);
+    vprintf(fmt, ap);
+    va_end(ap);
+  }
+};
+
+inline HostSerial Serial;
+
+// Simulated clock; tests advance it themselves
+inline uint32_t host_millis = 0;
+inline uint32_t millis() { return host_millis; }
+
+// Reproducible stand-in for the hardware RNG; tests may reseed it
+inline uint32_t esp_random_state = 12345;
+inline uint32_t esp_random()
+{
+  esp_random_state ^= esp_random_state << 13;
+  esp_random_state ^= esp_random_state >> 17;
+  esp_random_state ^= esp_random_state << 5;
+  return esp_random_state;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+// Host stand-in for the mbedtls Base64 API used by MeshOta (same return codes).
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL -0x002A
+#define MBEDTLS_ERR_BASE64_INVALID_CHARACTER -0x002C
+
+static inline int mbedtls_base64_encode(unsigned char *dst, size_t dlen, size_t *olen, const unsigned char *src, size_t slen)
+{
+  static const char map[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  size_t need = ((slen + 2) / 3) * 4;
+  *olen = need + 1;
+  if (dlen < need + 1)
+    return MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL;
+  unsigned char *p = dst;
+  for (size_t i = 0; i < slen; i += 3)
+  {
+    uint32_t v = (uint32_t)src[i] << 16;
+    if (i + 1 < slen)
+      v |= (uint32_t)src[i + 1] << 8;
+    if (i + 2 < slen)
+      v |= src[i + 2];
+    *p++ = map[(v >> 18) & 63];
+    *p++ = map[(v >> 12) & 63];
+    *p++ = i + 1 < slen ? map[(v >> 6) & 63] : '=';
+    *p++ = i + 2 < slen ? map[v & 63] : '=';
+  }
+  *p = 0;
+  *olen = need;
+  return 0;
+}
+
+static inline int mbedtls_base64_decode(unsigned char *dst, size_t dlen, size_t *olen, const unsigned char *src, size_t slen)
+{
+  static const char map[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  uint32_t v = 0;
+  int bits = 0;
+  size_t n = 0;
+  for (size_t i = 0; i < slen && src[i] != '='; i++)
+  {
+    const char *hit = strchr(map, src[i]);
+    if (!src[i] || !hit)
+      return MBEDTLS_ERR_BASE64_INVALID_CHARACTER;
+    v = (v << 6) | (uint32_t)(hit - map);
+    bits += 6;
+    if (bits >= 8)
+    {
+      bits -= 8;
+      if (n >= dlen)
+      {
+        *olen = n + 1;
+        return MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL;
+      }
+      dst[n++] = (uint8_t)(v >> bits);
+    }
+  }
+  *olen = n;
+  return 0;
+}
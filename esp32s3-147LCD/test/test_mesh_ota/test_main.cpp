@@ -0,0 +1,497 @@
+// Mesh-OTA auf dem Host: mehrere MeshOta-Instanzen mit Flash im RAM und einem
+// simulierten Mesh (Nachrichten als JSON, wahlweise mit Verlust). Das Mesh ist
+// vollvermascht oder ein Baum bzw. eine Kette; jeder Hop über den ersten hinaus
+// kostet einen Simulationsschritt.
+// pio test -e native -f test_mesh_ota
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <unity.h>
+#include <deque>
+#include <memory>
+#include <vector>
+#include "MeshOta.h"
+
+#define SIM_STEP_MS 100
+#define SIM_CAPACITY (64 * 1024)
+#define IMAGE_SIZE (OTA_CHUNK_SIZE * 40 + 123)
+
+// Staging-Partition, laufendes Image und die NVS-Schlüssel von EspOtaStorage im RAM
+class MemOtaStorage : public OtaStorage {
+public:
+    std::vector<uint8_t> staged;
+    std::vector<uint8_t> running;
+    String progHash;
+    uint32_t progSize = 0, progNext = 0;
+    String instHash;
+    uint32_t instSize = 0;
+    uint32_t gen = 0;
+    uint32_t restarts = 0;      // Fortschritt nach SHA-Fehler auf 0 zurückgesetzt
+    uint32_t busyInHandler = 0; // Schreib- und NVS-Zugriffe aus handleMessage heraus
+    bool inHandler = false;
+
+    uint32_t capacity() override { return SIM_CAPACITY; }
+    bool write(uint32_t offset, const uint8_t* data, size_t len) override {
+        if (inHandler) busyInHandler++;
+        if (offset + len > SIM_CAPACITY) return false;
+        if (staged.size() < offset + len) staged.resize(offset + len);
+        memcpy(&staged[offset], data, len);
+        return true;
+    }
+    bool readStaged(uint32_t offset, uint8_t* data, size_t len) override {
+        if (offset + len > staged.size()) return false;
+        memcpy(data, &staged[offset], len);
+        return true;
+    }
+    bool readRunning(uint32_t offset, uint8_t* data, size_t len) override {
+        if (offset + len > running.size()) return false;
+        memcpy(data, &running[offset], len);
+        return true;
+    }
+    bool activate() override {
+        running = staged;
+        return true;
+    }
+    bool loadProgress(String& hash, uint32_t& size, uint32_t& next) override {
+        hash = progHash;
+        size = progSize;
+        next = progNext;
+        return hash.length() > 0;
+    }
+    void saveProgress(const String& hash, uint32_t size, uint32_t next) override {
+        if (inHandler) busyInHandler++;
+        if (hash.length() && next == 0 && progNext > 0) restarts++;
+        progHash = hash;
+        progSize = size;
+        progNext = next;
+    }
+    bool installed(String& hash, uint32_t& size) override {
+        hash = instHash;
+        size = instSize;
+        return hash.length() > 0;
+    }
+    void setInstalled(const String& hash, uint32_t size) override {
+        instHash = hash;
+        instSize = size;
+    }
+    uint32_t generation() override { return gen; }
+    void setGeneration(uint32_t g) override { gen = g; }
+};
+
+struct Node {
+    uint32_t id = 0;
+    MemOtaStorage flash;
+    std::unique_ptr<MeshOta> ota;
+    uint8_t scratch[OTA_SCRATCH_SIZE];
+    uint32_t reboots = 0;
+    bool kicked = false;
+    std::vector<uint32_t> known;        // Quellen, deren OTA_HAVE beim Empfang ankam
+    uint32_t stagedAt = 0;              // Schritt, in dem der Knoten Quelle wurde
+};
+
+struct Message {
+    uint32_t from;
+    uint32_t to;        // 0 = Broadcast
+    String body;
+    uint32_t due;       // Zustellung ab diesem Zeitpunkt
+};
+
+class Sim {
+public:
+    std::vector<std::unique_ptr<Node>> nodes;
+    std::deque<Message> wire;
+    uint32_t now = 1000;
+    uint32_t dataSent = 0, dataDropped = 0;
+    uint32_t dropEvery = 0;             // jede n-te OTA_DATA verwerfen, 0 = verlustfrei
+    std::vector<uint32_t> requests;     // Chunk-Indizes aller OTA_REQ
+    bool worker = false;                // Flash-Arbeit wie auf dem Gerät im Worker statt im Aufrufer
+    uint32_t earlyRequests = 0;         // OTA_REQ für Chunk i, bevor Chunk i-1 geschrieben war
+    std::vector<int> parent;            // Baum: Elternknoten je Index (-1 = Wurzel), leer = vollvermascht
+    uint32_t steps = 0;
+    uint32_t farRequests = 0;           // OTA_REQ an eine Quelle, obwohl eine bekannte näher war
+
+    explicit Sim(int count, bool withWorker = false) : worker(withWorker) {
+        for (int i = 0; i < count; i++) {
+            nodes.emplace_back(new Node());
+            nodes.back()->id = 100 + i;
+            boot(*nodes.back());
+        }
+    }
+
+    Node& node(int i) { return *nodes[i]; }
+
+    // Kette 0-1-2-...: Tiefe count-1
+    static Sim* line(int count, bool withWorker = false) {
+        Sim* sim = new Sim(count, withWorker);
+        for (int i = 0; i < count; i++) sim->parent.push_back(i - 1);
+        return sim;
+    }
+
+    // Vollständiger Baum mit Wurzel 0, 'fanout' Kindern je Knoten und 'depth' Ebenen darunter
+    static Sim* tree(int depth, int fanout) {
+        int count = 1, level = 1;
+        for (int d = 0; d < depth; d++) count += (level *= fanout);
+        Sim* sim = new Sim(count);
+        for (int i = 0; i < count; i++) sim->parent.push_back(i ? (i - 1) / fanout : -1);
+        return sim;
+    }
+
+    int depthOf(int i) const {
+        int d = 0;
+        for (; parent[i] >= 0; i = parent[i]) d++;
+        return d;
+    }
+
+    int indexOf(uint32_t id) const { return (int)id - 100; }
+
+    // Weg über den gemeinsamen Vorfahren; vollvermascht immer 1
+    int hops(uint32_t a, uint32_t b) {
+        if (!find(a) || !find(b)) return -1;
+        if (parent.empty()) return 1;
+        int x = indexOf(a), y = indexOf(b), n = 0;
+        while (x != y) {
+            if (depthOf(x) >= depthOf(y)) x = parent[x];
+            else y = parent[y];
+            n++;
+        }
+        return n;
+    }
+
+    void send(uint32_t from, uint32_t to, const String& msg) {
+        if (strstr(msg.c_str(), "\"OTA_REQ\"")) checkNearest(from, to);
+        for (auto& n : nodes) {
+            if (n->id == from || (to && n->id != to)) continue;
+            wire.push_back({from, n->id, msg, now + (hops(from, n->id) - 1) * SIM_STEP_MS});
+        }
+    }
+
+    // Unter allen Quellen, von denen der Knoten weiß, muss die angefragte die nächste sein
+    void checkNearest(uint32_t from, uint32_t to) {
+        Node* asker = find(from);
+        int best = -1;
+        for (uint32_t id : asker->known) {
+            int h = hops(from, id);
+            if (h >= 0 && (best < 0 || h < best)) best = h;
+        }
+        if (best >= 0 && hops(from, to) > best) farRequests++;
+    }
+
+    // Neustart: neue Instanz auf demselben Flash
+    void boot(Node& n) {
+        n.ota.reset(new MeshOta(n.flash));
+        uint32_t self = n.id;
+        n.ota->begin(
+            [this, self](uint32_t to, const String& msg) { send(self, to, msg); },
+            [this, self](const String& msg) { send(self, 0, msg); },
+            [this, self](uint32_t id) { return hops(self, id); },
+            n.scratch);
+        if (worker) {
+            Node* self = &n;
+            n.ota->setWorker([self]() { self->kicked = true; });
+        }
+    }
+
+    // Der Worker-Task: läuft zwischen zwei Loop-Durchläufen
+    void runWorker(Node& n) {
+        if (!n.kicked) return;
+        n.kicked = false;
+        TEST_ASSERT_TRUE(n.ota->runFlashJob());
+        TEST_ASSERT_TRUE(n.ota->flashDone());
+    }
+
+    Node* find(uint32_t id) {
+        for (auto& n : nodes) if (n->id == id) return n.get();
+        return nullptr;
+    }
+
+    void upload(Node& n, const std::vector<uint8_t>& image) {
+        TEST_ASSERT_TRUE(n.ota->uploadStart());
+        for (size_t off = 0; off < image.size(); off += 512) {
+            TEST_ASSERT_TRUE(n.ota->uploadWrite(&image[off], min((size_t)512, image.size() - off)));
+        }
+        TEST_ASSERT_TRUE(n.ota->uploadFinish(now));
+        runWorker(n);
+        n.ota->loop(now);
+    }
+
+    void deliver(const Message& m, Node& to) {
+        JsonDocument doc;
+        TEST_ASSERT_FALSE(deserializeJson(doc, m.body));
+        const char* type = doc["type"] | "";
+        if (strcmp(type, "OTA_DATA") == 0) {
+            dataSent++;
+            if (dropEvery && dataSent % dropEvery == 0) { dataDropped++; return; }
+        } else if (strcmp(type, "OTA_REQ") == 0) {
+            uint32_t i = doc["i"] | 0;
+            requests.push_back(i);
+            Node* asker = find(m.from);
+            if (asker && asker->flash.staged.size() < (size_t)i * OTA_CHUNK_SIZE) earlyRequests++;
+        }
+        to.flash.inHandler = true;
+        to.ota->handleMessage(m.from, doc, now);
+        to.flash.inHandler = false;
+        if (strcmp(type, "OTA_HAVE") == 0 && to.ota->state() == MeshOta::RECEIVING) to.known.push_back(m.from);
+    }
+
+    void step() {
+        // Fällige Nachrichten zustellen, auch die dabei neu entstehenden (ein Hop = sofort)
+        for (bool any = true; any; ) {
+            any = false;
+            for (size_t i = 0; i < wire.size(); ) {
+                if ((int32_t)(wire[i].due - now) > 0) { i++; continue; }
+                Message m = wire[i];
+                wire.erase(wire.begin() + i);
+                if (Node* to = find(m.to)) deliver(m, *to);
+                any = true;
+            }
+        }
+        for (auto& n : nodes) {
+            runWorker(*n);
+            if (n->ota->loop(now)) {
+                n->reboots++;
+                boot(*n);
+            }
+            if (!n->stagedAt && n->ota->state() == MeshOta::STAGED) n->stagedAt = steps;
+        }
+        now += SIM_STEP_MS;
+        steps++;
+    }
+
+    template <typename Pred>
+    bool runUntil(Pred done, uint32_t limitMs) {
+        for (uint32_t end = now + limitMs; now < end; ) {
+            if (done()) return true;
+            step();
+        }
+        return done();
+    }
+};
+
+static std::vector<uint8_t> makeImage(uint32_t seed) {
+    std::vector<uint8_t> image(IMAGE_SIZE);
+    for (uint8_t& b : image) {
+        seed = seed * 1664525u + 1013904223u;
+        b = seed >> 24;
+    }
+    return image;
+}
+
+static bool holds(Node& n, const std::vector<uint8_t>& image) {
+    return n.flash.staged.size() >= image.size() && memcmp(n.flash.staged.data(), image.data(), image.size()) == 0;
+}
+
+static void offer(Node& n, const char* hash, uint32_t gen, uint32_t now) {
+    JsonDocument doc;
+    doc["type"] = "OTA_HAVE";
+    doc["h"] = hash;
+    doc["g"] = gen;
+    doc["sz"] = IMAGE_SIZE;
+    n.ota->handleMessage(999, doc, now);
+}
+
+static const char* HASH_A = "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa";
+static const char* HASH_B = "bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb";
+
+void setUp() {}
+void tearDown() {}
+
+void test_distributes_despite_chunk_loss() {
+    Sim sim(3);
+    sim.dropEvery = 4;
+    std::vector<uint8_t> image = makeImage(1);
+    sim.upload(sim.node(0), image);
+
+    bool done = sim.runUntil([&] {
+        return sim.node(1).ota->state() == MeshOta::STAGED && sim.node(2).ota->state() == MeshOta::STAGED;
+    }, 300000);
+    TEST_ASSERT_TRUE(done);
+    TEST_ASSERT_TRUE(sim.dataDropped > 0);
+    TEST_ASSERT_TRUE(holds(sim.node(1), image));
+    TEST_ASSERT_TRUE(holds(sim.node(2), image));
+
+    // Nach der Ruhezeit aktivieren alle, das neue Image läuft
+    done = sim.runUntil([&] {
+        for (auto& n : sim.nodes) if (n->ota->state() != MeshOta::INSTALLED) return false;
+        return true;
+    }, 3 * OTA_SERVE_IDLE_MS);
+    TEST_ASSERT_TRUE(done);
+    for (auto& n : sim.nodes) {
+        TEST_ASSERT_EQUAL_UINT32(1, n->reboots);
+        TEST_ASSERT_TRUE(n->flash.running == sim.node(0).flash.running);
+        TEST_ASSERT_EQUAL_UINT32(1, n->flash.gen);
+    }
+}
+
+void test_resumes_after_reboot() {
+    Sim sim(2);
+    std::vector<uint8_t> image = makeImage(2);
+    sim.upload(sim.node(0), image);
+    Node& rx = sim.node(1);
+
+    TEST_ASSERT_TRUE(sim.runUntil([&] { return rx.flash.progNext >= 2 * OTA_PROGRESS_EVERY; }, 60000));
+    uint32_t saved = rx.flash.progNext;
+    sim.wire.clear();       // was beim Neustart unterwegs war, ist verloren
+    sim.boot(rx);
+    TEST_ASSERT_EQUAL(MeshOta::RECEIVING, rx.ota->state());
+
+    sim.requests.clear();
+    TEST_ASSERT_TRUE(sim.runUntil([&] { return rx.ota->state() == MeshOta::STAGED; }, 120000));
+    TEST_ASSERT_FALSE(sim.requests.empty());
+    TEST_ASSERT_EQUAL_UINT32(saved, sim.requests.front());
+    TEST_ASSERT_TRUE(holds(rx, image));
+}
+
+void test_hash_mismatch_restarts_reception() {
+    Sim sim(2);
+    std::vector<uint8_t> image = makeImage(3);
+    sim.upload(sim.node(0), image);
+    Node& rx = sim.node(1);
+
+    // Quelle liefert ein verfälschtes Byte: SHA-256 beim Empfänger passt nicht
+    sim.node(0).flash.staged[5000] ^= 0xFF;
+    TEST_ASSERT_TRUE(sim.runUntil([&] { return rx.flash.restarts > 0; }, 60000));
+    TEST_ASSERT_EQUAL(MeshOta::RECEIVING, rx.ota->state());
+
+    sim.node(0).flash.staged[5000] ^= 0xFF;
+    TEST_ASSERT_TRUE(sim.runUntil([&] { return rx.ota->state() == MeshOta::STAGED; }, 120000));
+    TEST_ASSERT_TRUE(holds(rx, image));
+}
+
+void test_installed_accepts_only_newer_generation() {
+    Sim sim(1);
+    Node& n = sim.node(0);
+    n.flash.running = makeImage(4);
+    n.flash.instHash = HASH_A;
+    n.flash.instSize = IMAGE_SIZE;
+    n.flash.gen = 2;
+    sim.boot(n);
+    TEST_ASSERT_EQUAL(MeshOta::INSTALLED, n.ota->state());
+
+    offer(n, HASH_B, 1, sim.now);
+    TEST_ASSERT_EQUAL(MeshOta::INSTALLED, n.ota->state());
+    offer(n, HASH_B, 2, sim.now);
+    TEST_ASSERT_EQUAL(MeshOta::INSTALLED, n.ota->state());
+    offer(n, HASH_B, 3, sim.now);
+    TEST_ASSERT_EQUAL(MeshOta::RECEIVING, n.ota->state());
+    TEST_ASSERT_EQUAL_UINT32(3, n.flash.gen);
+}
+
+void test_rollback_keeps_generation_floor() {
+    Sim sim(1);
+    Node& n = sim.node(0);
+    n.flash.gen = 2;        // Image mit Gen. 2 wurde zurückgerollt: nicht mehr installiert
+    sim.boot(n);
+    TEST_ASSERT_EQUAL(MeshOta::IDLE, n.ota->state());
+
+    offer(n, HASH_A, 2, sim.now);
+    TEST_ASSERT_EQUAL(MeshOta::IDLE, n.ota->state());
+    offer(n, HASH_A, 3, sim.now);
+    TEST_ASSERT_EQUAL(MeshOta::RECEIVING, n.ota->state());
+}
+
+void test_staged_and_receiving_keep_their_image() {
+    Sim sim(2);
+    sim.upload(sim.node(0), makeImage(5));
+    TEST_ASSERT_EQUAL(MeshOta::STAGED, sim.node(0).ota->state());
+    offer(sim.node(0), HASH_B, 9, sim.now);
+    TEST_ASSERT_EQUAL(MeshOta::STAGED, sim.node(0).ota->state());
+
+    TEST_ASSERT_TRUE(sim.runUntil([&] { return sim.node(1).flash.progNext >= OTA_PROGRESS_EVERY; }, 60000));
+    offer(sim.node(1), HASH_B, 9, sim.now);
+    TEST_ASSERT_TRUE(sim.runUntil([&] { return sim.node(1).ota->state() == MeshOta::STAGED; }, 60000));
+    TEST_ASSERT_EQUAL_UINT32(1, sim.node(1).flash.gen);
+}
+
+void test_upload_outranks_seen_generations() {
+    Sim sim(2);
+    offer(sim.node(1), HASH_A, 7, sim.now);     // Gen. 7 im Mesh gesehen
+    sim.upload(sim.node(1), makeImage(6));
+    TEST_ASSERT_EQUAL_UINT32(8, sim.node(1).flash.gen);
+}
+
+void test_flash_work_runs_in_worker() {
+    Sim sim(3, true);
+    std::vector<uint8_t> image = makeImage(7);
+    sim.upload(sim.node(0), image);
+    TEST_ASSERT_EQUAL(MeshOta::STAGED, sim.node(0).ota->state());
+
+    bool done = sim.runUntil([&] {
+        return sim.node(1).ota->state() == MeshOta::STAGED && sim.node(2).ota->state() == MeshOta::STAGED;
+    }, 120000);
+    TEST_ASSERT_TRUE(done);
+    TEST_ASSERT_TRUE(holds(sim.node(1), image));
+    TEST_ASSERT_TRUE(holds(sim.node(2), image));
+    // Schreiben und Fortschritt liefen im Worker; nur das Lesen zum Ausliefern bleibt im Handler
+    for (auto& n : sim.nodes) TEST_ASSERT_EQUAL_UINT32(0, n->flash.busyInHandler);
+    // Der nächste Chunk wird erst angefordert, wenn der vorige im Flash steht
+    TEST_ASSERT_EQUAL_UINT32(0, sim.earlyRequests);
+}
+
+// Upload an der Wurzel, bis alle Knoten Quelle sind; Ergebnis in Simulationsschritten
+static uint32_t distribute(Sim& sim, uint32_t seed) {
+    std::vector<uint8_t> image = makeImage(seed);
+    sim.upload(sim.node(0), image);
+    uint32_t start = sim.steps;
+    bool done = sim.runUntil([&] {
+        for (auto& n : sim.nodes) if (n->ota->state() != MeshOta::STAGED) return false;
+        return true;
+    }, 600000);
+    TEST_ASSERT_TRUE(done);
+    for (auto& n : sim.nodes) TEST_ASSERT_TRUE(holds(*n, image));
+    TEST_ASSERT_EQUAL_UINT32(0, sim.farRequests);
+    return sim.steps - start;
+}
+
+void test_line_fetches_from_nearest_source() {
+    std::unique_ptr<Sim> sim(Sim::line(8));
+    uint32_t rounds = distribute(*sim, 8);
+    char line[96];
+    snprintf(line, sizeof(line), "Kette aus 8: %u Schritte", rounds);
+    TEST_MESSAGE(line);
+    // Jeder Knoten holt vom nächsten Nachbarn, der schon Quelle ist: jede Ebene kostet
+    // ungefähr ein Image vom direkten Nachbarn, nicht mehr
+    for (int i = 1; i < 8; i++) {
+        snprintf(line, sizeof(line), "  Knoten %d: Quelle nach %u", i, sim->node(i).stagedAt);
+        TEST_MESSAGE(line);
+        if (i < 2) continue;
+        uint32_t gap = sim->node(i).stagedAt - sim->node(i - 1).stagedAt;
+        TEST_ASSERT_TRUE(sim->node(i).stagedAt > sim->node(i - 1).stagedAt);
+        TEST_ASSERT_TRUE(gap <= sim->node(1).stagedAt);
+    }
+}
+
+static bool within(uint32_t a, uint32_t b, uint32_t pct) {
+    uint32_t diff = a > b ? a - b : b - a;
+    return diff * 100 <= b * pct;
+}
+
+void test_rounds_track_depth_not_width() {
+    std::unique_ptr<Sim> line4(Sim::line(4)), line8(Sim::line(8));
+    std::unique_ptr<Sim> narrow(Sim::tree(2, 2)), wide(Sim::tree(2, 4)), deep(Sim::tree(3, 2));
+    uint32_t r4 = distribute(*line4, 9), r8 = distribute(*line8, 9);
+    uint32_t rn = distribute(*narrow, 9), rw = distribute(*wide, 9), rd = distribute(*deep, 9);
+    char line[160];
+    snprintf(line, sizeof(line), "Kette 4/8: %u/%u, Baum Tiefe 2 (7 / 21 Knoten): %u/%u, Tiefe 3 (15): %u", r4, r8, rn, rw, rd);
+    TEST_MESSAGE(line);
+    // Dauer wächst mit der Tiefe ...
+    TEST_ASSERT_TRUE(r8 > r4 * 3 / 2);
+    TEST_ASSERT_TRUE(rd > rn);
+    // ... aber nicht mit der Breite: gleiche Tiefe, gleiche Dauer
+    TEST_ASSERT_TRUE(within(rw, rn, 10));
+    TEST_ASSERT_TRUE(within(rd, r4, 10));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_distributes_despite_chunk_loss);
+    RUN_TEST(test_resumes_after_reboot);
+    RUN_TEST(test_hash_mismatch_restarts_reception);
+    RUN_TEST(test_installed_accepts_only_newer_generation);
+    RUN_TEST(test_rollback_keeps_generation_floor);
+    RUN_TEST(test_staged_and_receiving_keep_their_image);
+    RUN_TEST(test_upload_outranks_seen_generations);
+    RUN_TEST(test_flash_work_runs_in_worker);
+    RUN_TEST(test_line_fetches_from_nearest_source);
+    RUN_TEST(test_rounds_track_depth_not_width);
+    return UNITY_END();
+}
@@ -0,0 +1,139 @@
+// Reliable Broadcast unter Paketverlust: ein Absender, mehrere Empfänger, Verlust
+// wie MESH_SIM_LOSS_PCT (nur Nachrichten mit Sequenz, also auch Retransmits).
+// pio test -e native -f test_mesh_reliability -v   (-v zeigt die Messtabelle)
+
+#include <Arduino.h>
+#include <unity.h>
+#include <deque>
+#include <vector>
+#include "MeshReliability.h"
+
+#define SIM_RECEIVERS 4
+#define SIM_MESSAGES 600
+#define SIM_SEND_EVERY_MS 1000      // ein Reliable-Broadcast pro Sekunde
+#define SIM_TICK_MS 100             // wie der Reliability-Task
+#define SIM_LATENCY_MS 50
+#define SIM_DRAIN_MS 60000          // danach noch Heartbeats und NACKs abwarten
+
+struct Result {
+    uint32_t sent = 0;
+    uint32_t delivered = 0;         // eindeutig zugestellt, über alle Empfänger
+    uint32_t nacks = 0;
+    uint32_t retransmits = 0;
+    uint32_t dropped = 0;
+};
+
+// Paket unterwegs: Daten (mit Sequenz) oder NACK an den Absender
+struct Packet {
+    uint32_t due;
+    int receiver;                   // Empfänger der Daten bzw. Absender des NACKs
+    bool nack;
+    uint32_t seqs[REL_MAX_NACK_SEQS];
+    uint8_t count;
+};
+
+static Result simulate(uint32_t lossPct, uint32_t seed) {
+    esp_random_state = seed;
+    MeshReliability sender;
+    std::vector<MeshReliability> rx(SIM_RECEIVERS);
+    std::vector<std::vector<bool>> got(SIM_RECEIVERS, std::vector<bool>(SIM_MESSAGES + 1));
+    std::deque<Packet> wire;
+    Result r;
+    const uint32_t origin = 1;
+
+    auto sendData = [&](int to, uint32_t seq, uint32_t now) {
+        Packet p = {now + SIM_LATENCY_MS, to, false, {seq}, 1};
+        wire.push_back(p);
+    };
+
+    uint32_t end = SIM_MESSAGES * SIM_SEND_EVERY_MS + SIM_DRAIN_MS;
+    uint32_t lastHb = 0;
+    for (uint32_t now = SIM_TICK_MS; now <= end; now += SIM_TICK_MS) {
+        // Absender: neuer Broadcast, Heartbeat
+        if (now % SIM_SEND_EVERY_MS == 0 && sender.lastSeq() < SIM_MESSAGES) {
+            uint32_t seq = sender.nextSeq();
+            sender.remember(seq, String("m") + String(seq));
+            for (int i = 0; i < SIM_RECEIVERS; i++) sendData(i, seq, now);
+        }
+        if (sender.lastSeq() && now - lastHb > REL_HB_INTERVAL_MS) {
+            for (auto& m : rx) m.noteHighest(origin, sender.epoch(), sender.lastSeq(), now);
+            lastHb = now;
+        }
+
+        // Zustellen, was fällig ist
+        for (size_t n = wire.size(); n; n--) {
+            Packet p = wire.front();
+            wire.pop_front();
+            if ((int32_t)(now - p.due) < 0) { wire.push_back(p); continue; }
+            if (p.nack) {
+                for (uint8_t i = 0; i < p.count; i++) {
+                    if (!sender.lookup(p.seqs[i])) continue;
+                    sender.countRetransmit();
+                    sendData(p.receiver, p.seqs[i], now);
+                }
+                continue;
+            }
+            if (lossPct && esp_random() % 100 < lossPct) { r.dropped++; continue; }
+            if (rx[p.receiver].accept(origin, sender.epoch(), p.seqs[0], now) == MeshReliability::FRESH) {
+                got[p.receiver][p.seqs[0]] = true;
+            }
+        }
+
+        // Empfänger: fällige NACKs
+        for (int i = 0; i < SIM_RECEIVERS; i++) {
+            Packet p = {now + SIM_LATENCY_MS, i, true, {}, 0};
+            uint32_t o, ep;
+            while (rx[i].pollNack(now, o, ep, p.seqs, p.count)) {
+                rx[i].countNack();
+                wire.push_back(p);
+            }
+        }
+    }
+
+    r.sent = sender.stats().sent;
+    r.retransmits = sender.stats().retransmits;
+    for (int i = 0; i < SIM_RECEIVERS; i++) {
+        r.nacks += rx[i].stats().nacksSent;
+        for (uint32_t s = 1; s <= SIM_MESSAGES; s++) r.delivered += got[i][s];
+    }
+    return r;
+}
+
+static void report(uint32_t lossPct, const Result& r) {
+    uint32_t expected = r.sent * SIM_RECEIVERS;
+    char line[160];
+    snprintf(line, sizeof(line), "loss %2u %%: delivered %5.1f %%, NACK %.3f, RTX %.3f per message and receiver",
+             lossPct, 100.0 * r.delivered / expected, (double)r.nacks / expected, (double)r.retransmits / expected);
+    TEST_MESSAGE(line);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_lossless_needs_no_repair() {
+    Result r = simulate(0, 1);
+    report(0, r);
+    TEST_ASSERT_EQUAL_UINT32(SIM_MESSAGES * SIM_RECEIVERS, r.delivered);
+    TEST_ASSERT_EQUAL_UINT32(0, r.nacks);
+    TEST_ASSERT_EQUAL_UINT32(0, r.retransmits);
+}
+
+void test_delivery_under_loss() {
+    const uint32_t losses[] = {5, 10, 20, 30};
+    for (uint32_t loss : losses) {
+        Result r = simulate(loss, 1000 + loss);
+        report(loss, r);
+        uint32_t expected = r.sent * SIM_RECEIVERS;
+        // Nach drei NACKs gibt der Empfänger auf: Restverlust wächst etwa mit loss^4
+        if (loss <= 10) TEST_ASSERT_TRUE(r.delivered * 1000ULL >= expected * 995ULL);
+        else if (loss <= 20) TEST_ASSERT_TRUE(r.delivered * 100ULL >= expected * 99ULL);
+        else TEST_ASSERT_TRUE(r.delivered * 100ULL >= expected * 96ULL);
+    }
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_lossless_needs_no_repair);
+    RUN_TEST(test_delivery_under_loss);
+    return UNITY_END();
+}
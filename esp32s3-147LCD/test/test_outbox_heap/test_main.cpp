@@ -0,0 +1,111 @@
+// Heap-Soak für die Sende-Warteschlange: der Dauerbetrieb (NACK, Heartbeats,
+// STATUS, weitergereichte STATUS, SYNC_RES aus dem Cache) darf nach dem
+// Aufwärmen keine einzige Allokation mehr auslösen. Gezählt wird über einen
+// globalen operator new; simuliert werden SOAK_HOURS Stunden Verkehr.
+// pio test -e native -f test_outbox_heap -v   (-v zeigt die Zählung)
+
+#include <Arduino.h>
+#include <unity.h>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include "MeshOutbox.h"
+
+#define SOAK_HOURS 6
+#define SOAK_TICK_MS 100            // wie der Outbox-Task bei voller Schlange
+#define SOAK_WARMUP_S 60            // danach haben alle Slots ihre Puffer
+
+static std::atomic<uint32_t> allocations{0};
+
+void* operator new(size_t size) {
+    allocations++;
+    void* p = malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+struct Sink {
+    uint32_t sent = 0;
+    uint32_t bytes = 0;
+};
+
+void setUp() {}
+void tearDown() {}
+
+static void test_classifies_without_copy() {
+    MeshOutbox box;
+    Sink sink;
+    box.begin([&](uint32_t, const String& msg) { sink.sent++; sink.bytes += msg.length(); }, [](String&) {});
+    host_millis = 1000;
+
+    box.push(7, String("{\"type\":\"STATUS\",\"up\":1}"));
+    box.push(7, String("{\"type\":\"STATUS\",\"up\":2}"));
+    // Weitergereicht: darf den eigenen STATUS nicht ersetzen
+    box.push(7, String("{\"type\":\"STATUS\",\"up\":3,\"f\":9,\"fh\":1}"), MeshOutbox::NO_COALESCE);
+    TEST_ASSERT_EQUAL_UINT32(1, box.stats(MeshOutbox::BULK).coalesced);
+    TEST_ASSERT_EQUAL_UINT32(2, box.queued(MeshOutbox::BULK));
+    TEST_ASSERT_TRUE(box.pending("STATUS", 7));
+    TEST_ASSERT_FALSE(box.pending("STATUS", 8));
+
+    // Präfix eines bekannten Typs ist kein Treffer, unbekannte Typen laufen als CONFIG
+    box.push(0, String("{\"type\":\"NAC\"}"));
+    box.push(0, String("{\"type\":\"NACK\",\"ep\":1}"));
+    TEST_ASSERT_EQUAL_UINT32(1, box.queued(MeshOutbox::CONFIG));
+    TEST_ASSERT_EQUAL_UINT32(1, box.queued(MeshOutbox::CONTROL));
+    TEST_ASSERT_EQUAL(MeshOutbox::CONFIG, MeshOutbox::classify("NET_DELTA"));
+    TEST_ASSERT_EQUAL(MeshOutbox::BULK, MeshOutbox::classify("OTA_DATA"));
+}
+
+static void test_steady_state_does_not_allocate() {
+    MeshOutbox box;
+    Sink sink;
+    box.begin([&](uint32_t, const String& msg) { sink.sent++; sink.bytes += msg.length(); }, [](String&) {});
+
+    // Vorgefertigte Nachrichten wie im Betrieb: _txBuffer, _syncResCache und weitergereichte STATUS
+    String nack("{\"type\":\"NACK\",\"ep\":3,\"seqs\":[17,18,19]}");
+    String seqHb("{\"type\":\"SEQ_HB\",\"ep\":3,\"hi\":12345}");
+    String timeSync("{\"type\":\"TIME_SYNC\",\"s\":1760000000,\"us\":123456,\"nt\":987654321}");
+    String status("{\"type\":\"STATUS\",\"up\":3600,\"heap\":182344,\"rssi\":-61,\"n\":12,\"cfg\":42,\"ch\":6,\"sd\":0}");
+    String forwarded("{\"type\":\"STATUS\",\"up\":3590,\"heap\":179020,\"rssi\":-70,\"n\":12,\"cfg\":42,\"f\":3141,\"fh\":1}");
+    String syncRes("{\"type\":\"SYNC_RES\",\"version\":42,\"networks\":[");
+    for (int i = 0; i < 12; i++) syncRes += "{\"s\":\"Netz-" + std::to_string(i) + "\",\"p\":\"geheimespasswort\",\"r\":1},";
+    syncRes += "{\"s\":\"letztes\",\"p\":\"x\",\"r\":0}]}";
+
+    uint32_t warm = 0;
+    const uint32_t ticks = SOAK_HOURS * 3600UL * 1000 / SOAK_TICK_MS;
+    for (uint32_t t = 0; t < ticks; t++) {
+        host_millis = t * SOAK_TICK_MS;
+        uint32_t sec = host_millis / 1000;
+        bool second = host_millis % 1000 == 0;
+        if (t == SOAK_WARMUP_S * 1000 / SOAK_TICK_MS) warm = allocations;
+
+        if (second && sec % 2 == 0) box.push(1 + sec % 5, nack);
+        if (second && sec % 5 == 0) box.push(0, seqHb);
+        if (second && sec % 30 == 0) box.push(0, timeSync);
+        if (second && sec % 60 == 0) box.push(99, status);
+        if (second && sec % 60 == 30) box.push(99, forwarded, MeshOutbox::NO_COALESCE);
+        if (second && sec % 20 == 7) box.push(2 + sec % 3, syncRes);
+        box.service(host_millis);
+    }
+    uint32_t steady = allocations - warm;
+
+    char line[160];
+    snprintf(line, sizeof(line), "%u h: %u Nachrichten (%u KB) gesendet, %u Allokationen beim Aufwärmen, %u danach",
+             SOAK_HOURS, sink.sent, sink.bytes / 1024, warm, steady);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_TRUE(sink.sent > 0);
+    TEST_ASSERT_EQUAL_UINT32(0, box.stats(MeshOutbox::CONTROL).dropped + box.stats(MeshOutbox::BULK).dropped);
+    TEST_ASSERT_EQUAL_UINT32(0, steady);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_classifies_without_copy);
+    RUN_TEST(test_steady_state_does_not_allocate);
+    return UNITY_END();
+}
@@ -0,0 +1,233 @@
+// Pixel_Swap16, Pixel_Swap16Scale and Pixel_Fill16 against per-pixel references
+// for every length up to a few words and every 2-byte phase of src/dst, in place
+// and out of place, plus timings on one full-width LVGL draw buffer.
+// pio test -e native -f test_pixel_pipeline -v   (-v shows the timings)
+
+#include <Arduino.h>
+#include <unity.h>
+#include <chrono>
+#include <vector>
+#include "PixelPipeline.h"
+
+#define PX_MAX_LEN 67               // covers the 8-pixel loop, the word tail and an odd pixel
+#define PX_GUARD 4                  // pixels around the target that must stay untouched
+#define PX_BENCH_PIXELS (172 * 160) // LCD_WIDTH x LVGL_DRAW_LINES_MAX
+#define PX_BENCH_ROUNDS 200
+#define PX_BENCH_LEVEL 20           // UI_DIM_PIXEL_LEVEL
+
+static void swap_reference(uint16_t *dst, const uint16_t *src, size_t n)
+{
+  for (size_t i = 0; i < n; i++)
+    dst[i] = (uint16_t)((src[i] << 8) | (src[i] >> 8));
+}
+
+static uint16_t scale_reference(uint16_t p, uint8_t level)
+{
+  uint32_t r = (p >> 11) * level >> 5;
+  uint32_t g = ((p >> 5) & 0x3F) * level >> 5;
+  uint32_t b = (p & 0x1F) * level >> 5;
+  return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void swap_scale_reference(uint16_t *dst, const uint16_t *src, size_t n, uint8_t level)
+{
+  for (size_t i = 0; i < n; i++)
+  {
+    uint16_t v = level >= PIXEL_LEVEL_FULL ? src[i] : scale_reference(src[i], level);
+    dst[i] = (uint16_t)((v << 8) | (v >> 8));
+  }
+}
+
+static void fill_pattern(uint16_t *p, size_t n, uint16_t seed)
+{
+  for (size_t i = 0; i < n; i++)
+    p[i] = (uint16_t)(seed + i * 0x1357u);
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_swap_matches_reference()
+{
+  // uint32_t backing keeps offsets 0/1 exactly at the two 2-byte phases of a word
+  uint32_t srcWords[(PX_MAX_LEN + 2 * PX_GUARD + 2) / 2 + 1];
+  uint32_t dstWords[(PX_MAX_LEN + 2 * PX_GUARD + 2) / 2 + 1];
+  uint16_t expect[PX_MAX_LEN + 2 * PX_GUARD + 2];
+  for (size_t srcOff = 0; srcOff < 2; srcOff++)
+  {
+    for (size_t dstOff = 0; dstOff < 2; dstOff++)
+    {
+      for (size_t n = 0; n <= PX_MAX_LEN; n++)
+      {
+        uint16_t *src = (uint16_t *)srcWords + PX_GUARD + srcOff;
+        uint16_t *dstBase = (uint16_t *)dstWords;
+        uint16_t *dst = dstBase + PX_GUARD + dstOff;
+        fill_pattern((uint16_t *)srcWords, sizeof(srcWords) / 2, (uint16_t)n);
+        fill_pattern(dstBase, sizeof(dstWords) / 2, 0xA5A5);
+        memcpy(expect, dstBase, sizeof(expect));
+        swap_reference(expect + PX_GUARD + dstOff, src, n);
+
+        Pixel_Swap16(dst, src, n);
+        TEST_ASSERT_EQUAL_MEMORY(expect, dstBase, sizeof(expect));
+      }
+    }
+  }
+}
+
+static void test_swap_in_place()
+{
+  uint32_t words[(PX_MAX_LEN + 2 * PX_GUARD + 2) / 2 + 1];
+  uint16_t expect[PX_MAX_LEN + 2 * PX_GUARD + 2];
+  for (size_t off = 0; off < 2; off++)
+  {
+    for (size_t n = 0; n <= PX_MAX_LEN; n++)
+    {
+      uint16_t *base = (uint16_t *)words;
+      uint16_t *px = base + PX_GUARD + off;
+      fill_pattern(base, sizeof(words) / 2, (uint16_t)(n * 7));
+      memcpy(expect, base, sizeof(expect));
+      swap_reference(expect + PX_GUARD + off, expect + PX_GUARD + off, n);
+
+      Pixel_Swap16(px, px, n);
+      TEST_ASSERT_EQUAL_MEMORY(expect, base, sizeof(expect));
+    }
+  }
+}
+
+static void test_swap_twice_restores()
+{
+  std::vector<uint16_t> buf(PX_BENCH_PIXELS), orig(PX_BENCH_PIXELS);
+  fill_pattern(orig.data(), orig.size(), 0x0F0F);
+  buf = orig;
+  Pixel_Swap16(buf.data(), buf.data(), buf.size());
+  TEST_ASSERT_EQUAL_HEX16(__builtin_bswap16(orig[1]), buf[1]);
+  Pixel_Swap16(buf.data(), buf.data(), buf.size());
+  TEST_ASSERT_EQUAL_MEMORY(orig.data(), buf.data(), orig.size() * 2);
+}
+
+static void test_scale_matches_reference()
+{
+  static const uint8_t levels[] = {0, 1, 7, 16, 20, 31, PIXEL_LEVEL_FULL, 255};
+  uint32_t srcWords[(PX_MAX_LEN + 2 * PX_GUARD + 2) / 2 + 1];
+  uint32_t dstWords[(PX_MAX_LEN + 2 * PX_GUARD + 2) / 2 + 1];
+  uint16_t expect[PX_MAX_LEN + 2 * PX_GUARD + 2];
+  for (uint8_t level : levels)
+  {
+    for (size_t srcOff = 0; srcOff < 2; srcOff++)
+    {
+      for (size_t dstOff = 0; dstOff < 2; dstOff++)
+      {
+        for (size_t n = 0; n <= PX_MAX_LEN; n++)
+        {
+          uint16_t *src = (uint16_t *)srcWords + PX_GUARD + srcOff;
+          uint16_t *dstBase = (uint16_t *)dstWords;
+          uint16_t *dst = dstBase + PX_GUARD + dstOff;
+          fill_pattern((uint16_t *)srcWords, sizeof(srcWords) / 2, (uint16_t)(n + level));
+          fill_pattern(dstBase, sizeof(dstWords) / 2, 0xA5A5);
+          memcpy(expect, dstBase, sizeof(expect));
+          swap_scale_reference(expect + PX_GUARD + dstOff, src, n, level);
+
+          Pixel_Swap16Scale(dst, src, n, level);
+          TEST_ASSERT_EQUAL_MEMORY(expect, dstBase, sizeof(expect));
+        }
+      }
+    }
+  }
+}
+
+static void test_scale_in_place_keeps_white_and_black()
+{
+  // Full white scales each channel on its own, without carries into the next one
+  uint16_t px[3] = {0xFFFF, 0x0000, 0xF800};
+  Pixel_Swap16Scale(px, px, 3, 16);
+  TEST_ASSERT_EQUAL_HEX16(__builtin_bswap16(0x7BEF), px[0]);
+  TEST_ASSERT_EQUAL_HEX16(0x0000, px[1]);
+  TEST_ASSERT_EQUAL_HEX16(__builtin_bswap16(0x7800), px[2]);
+}
+
+static void test_fill()
+{
+  uint32_t words[(PX_MAX_LEN + 2 * PX_GUARD + 2) / 2 + 1];
+  uint16_t expect[PX_MAX_LEN + 2 * PX_GUARD + 2];
+  for (int swap = 0; swap < 2; swap++)
+  {
+    for (size_t off = 0; off < 2; off++)
+    {
+      for (size_t n = 0; n <= PX_MAX_LEN; n++)
+      {
+        uint16_t *base = (uint16_t *)words;
+        fill_pattern(base, sizeof(words) / 2, 0x5A5A);
+        memcpy(expect, base, sizeof(expect));
+        for (size_t i = 0; i < n; i++)
+          expect[PX_GUARD + off + i] = swap ? 0x34F8 : 0xF834;
+
+        Pixel_Fill16(base + PX_GUARD + off, 0xF834, n, swap);
+        TEST_ASSERT_EQUAL_MEMORY(expect, base, sizeof(expect));
+      }
+    }
+  }
+}
+
+template <typename Fn>
+static double ns_per_pixel(Fn fn, uint16_t *buf)
+{
+  auto t0 = std::chrono::steady_clock::now();
+  for (int r = 0; r < PX_BENCH_ROUNDS; r++)
+    fn(buf, buf, PX_BENCH_PIXELS);
+  auto t1 = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(t1 - t0).count() / ((double)PX_BENCH_ROUNDS * PX_BENCH_PIXELS);
+}
+
+static void scale_reference_dim(uint16_t *dst, const uint16_t *src, size_t n)
+{
+  swap_scale_reference(dst, src, n, PX_BENCH_LEVEL);
+}
+
+static void scale_dim(uint16_t *dst, const uint16_t *src, size_t n)
+{
+  Pixel_Swap16Scale(dst, src, n, PX_BENCH_LEVEL);
+}
+
+static void fill_black(uint16_t *dst, const uint16_t *, size_t n)
+{
+  Pixel_Fill16(dst, 0, n, true);
+}
+
+static void test_swap_benchmark()
+{
+  // Host timing of the per-frame conversion in my_disp_flush: the per-pixel
+  // loop (what writePixels(..., bigEndian = false) does per pixel) against the
+  // word-wise one, for the plain swap and the dimmed swap. Device timings come
+  // from the "convert" share in the [UI] frame log.
+  std::vector<uint16_t> buf(PX_BENCH_PIXELS);
+  fill_pattern(buf.data(), buf.size(), 1);
+  double ref = ns_per_pixel(swap_reference, buf.data());
+  double word = ns_per_pixel(Pixel_Swap16, buf.data());
+  // Even rounds: the buffer is back to its pattern
+  std::vector<uint16_t> expect(PX_BENCH_PIXELS);
+  fill_pattern(expect.data(), expect.size(), 1);
+  TEST_ASSERT_EQUAL_MEMORY(expect.data(), buf.data(), expect.size() * 2);
+
+  double refDim = ns_per_pixel(scale_reference_dim, buf.data());
+  fill_pattern(buf.data(), buf.size(), 1);
+  double wordDim = ns_per_pixel(scale_dim, buf.data());
+  double fill = ns_per_pixel(fill_black, buf.data());
+  char line[160];
+  snprintf(line, sizeof(line), "%u px: swap %.3f -> %.3f ns/px, dimmed swap %.3f -> %.3f ns/px, fill %.3f ns/px",
+           (unsigned)PX_BENCH_PIXELS, ref, word, refDim, wordDim, fill);
+  TEST_MESSAGE(line);
+  TEST_ASSERT_EQUAL_HEX16(0, buf[PX_BENCH_PIXELS - 1]);
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_swap_matches_reference);
+  RUN_TEST(test_swap_in_place);
+  RUN_TEST(test_swap_twice_restores);
+  RUN_TEST(test_scale_matches_reference);
+  RUN_TEST(test_scale_in_place_keeps_white_and_black);
+  RUN_TEST(test_fill);
+  RUN_TEST(test_swap_benchmark);
+  return UNITY_END();
+}
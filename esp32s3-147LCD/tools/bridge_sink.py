@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+"""Lokaler Ersatz-Endpunkt für die Mesh-Bridge.
+
+Nimmt die MessagePack-Batches der Bridge per HTTP-POST an, dekodiert sie und
+gibt jeden Datensatz als JSON-Zeile aus. Nur Standardbibliothek.
+
+    python3 tools/bridge_sink.py --port 8080 [--slow 1.5] [--fail 0.2]
+
+Bridge-URL auf der Admin-Seite dann z.B. http://<pc-ip>:8080/ingest.
+--slow verzögert jede Antwort (Backpressure testen), --fail beantwortet einen
+Anteil der Anfragen mit 503 (Backoff/Retry testen).
+"""
+import argparse
+import json
+import random
+import struct
+import sys
+import time
+from http.server import BaseHTTPRequestHandler, HTTPServer
+
+
+def unpack(buf, pos=0):
+    """Minimaler MessagePack-Decoder (alles, was ArduinoJson erzeugt)."""
+    b = buf[pos]
+    pos += 1
+    if b <= 0x7f:
+        return b, pos
+    if 0x80 <= b <= 0x8f:
+        return unpack_map(buf, pos, b & 0x0f)
+    if 0x90 <= b <= 0x9f:
+        return unpack_array(buf, pos, b & 0x0f)
+    if 0xa0 <= b <= 0xbf:
+        n = b & 0x1f
+        return buf[pos:pos + n].decode(), pos + n
+    if b >= 0xe0:
+        return b - 0x100, pos
+    if b == 0xc0:
+        return None, pos
+    if b in (0xc2, 0xc3):
+        return b == 0xc3, pos
+    fixed = {0xca: ">f", 0xcb: ">d", 0xcc: ">B", 0xcd: ">H", 0xce: ">I", 0xcf: ">Q",
+             0xd0: ">b", 0xd1: ">h", 0xd2: ">i", 0xd3: ">q"}
+    if b in fixed:
+        fmt = fixed[b]
+        size = struct.calcsize(fmt)
+        return struct.unpack_from(fmt, buf, pos)[0], pos + size
+    if b in (0xd9, 0xda, 0xdb):
+        size = {0xd9: 1, 0xda: 2, 0xdb: 4}[b]
+        n = int.from_bytes(buf[pos:pos + size], "big")
+        pos += size
+        return buf[pos:pos + n].decode(), pos + n
+    if b in (0xdc, 0xdd):
+        size = 2 if b == 0xdc else 4
+        return unpack_array(buf, pos + size, int.from_bytes(buf[pos:pos + size], "big"))
+    if b in (0xde, 0xdf):
+        size = 2 if b == 0xde else 4
+        return unpack_map(buf, pos + size, int.from_bytes(buf[pos:pos + size], "big"))
+    raise ValueError("MessagePack-Typ 0x%02x nicht unterstützt" % b)
+
+
+def unpack_array(buf, pos, n):
+    out = []
+    for _ in range(n):
+        v, pos = unpack(buf, pos)
+        out.append(v)
+    return out, pos
+
+
+def unpack_map(buf, pos, n):
+    out = {}
+    for _ in range(n):
+        k, pos = unpack(buf, pos)
+        v, pos = unpack(buf, pos)
+        out[k] = v
+    return out, pos
+
+
+class Sink(BaseHTTPRequestHandler):
+    slow = 0.0
+    fail = 0.0
+    batches = 0
+    records = 0
+
+    def do_POST(self):
+        body = self.rfile.read(int(self.headers.get("Content-Length", 0)))
+        if self.slow:
+            time.sleep(self.slow)
+        if random.random() < self.fail:
+            self.send_response(503)
+            self.end_headers()
+            print("# 503 (simuliert), %d B verworfen" % len(body), file=sys.stderr)
+            return
+        batch, _ = unpack(body)
+        Sink.batches += 1
+        Sink.records += len(batch["r"])
+        for rec in batch["r"]:
+            print(json.dumps({"bridge": batch["b"], "t": batch["t"], **rec}), flush=True)
+        print("# Batch %d: %d Datensätze, %d B (gesamt %d Datensätze)"
+              % (Sink.batches, len(batch["r"]), len(body), Sink.records), file=sys.stderr)
+        self.send_response(204)
+        self.end_headers()
+
+    def log_message(self, fmt, *args):
+        pass
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--port", type=int, default=8080)
+    ap.add_argument("--slow", type=float, default=0.0, help="Antwortverzögerung in s")
+    ap.add_argument("--fail", type=float, default=0.0, help="Anteil 503-Antworten (0..1)")
+    args = ap.parse_args()
+    Sink.slow, Sink.fail = args.slow, args.fail
+    HTTPServer(("", args.port), Sink).serve_forever()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,153 @@
+#!/usr/bin/env python3
+"""Mesh-Trace holen, auswerten und als Benchmark wiedergeben.
+
+    python3 tools/mesh_trace.py fetch  http://<knoten> trace.bin
+    python3 tools/mesh_trace.py show   trace.bin [--list]
+    python3 tools/mesh_trace.py replay http://<bench-knoten> [trace.bin] [--runs 3]
+
+'show' fasst einen Mitschnitt pro Nachrichtentyp zusammen (Anzahl, Bytes,
+Handler-Dauer auf dem Knoten). 'replay' lädt einen Mitschnitt auf einen Knoten,
+der alle empfangenen Nachrichten so schnell wie möglich durch
+meshReceivedWrapper() und die Speicherschicht schickt. Ohne Datei wird der
+Mitschnitt im Knoten selbst wiedergegeben. Ausgegeben werden Latenz-Perzentile
+pro Typ, ausgelöste Flash-Schreibzugriffe und Heap-Blöcke.
+
+Achtung: Die Wiedergabe wirkt auf den Zustand des Knotens, z.B. Config-Version
+und Netzliste. Am besten einen eigenen Bench-Knoten benutzen. Nur Standardbibliothek.
+"""
+import argparse
+import struct
+import sys
+import urllib.request
+import uuid
+from collections import defaultdict
+
+FILE_HEADER = struct.Struct("<IHHI")        # magic, version, recordHeader, records
+RECORD = struct.Struct("<IIIHHB3x")         # ms, peer, handlerUs, len, size, dir
+MAGIC = 0x4352544D
+DIRS = {1: "RX", 2: "TX"}
+
+
+def parse(data):
+    magic, version, rec_hdr, count = FILE_HEADER.unpack_from(data, 0)
+    if magic != MAGIC or rec_hdr != RECORD.size:
+        sys.exit("Keine gültige Trace-Datei (magic/Version passt nicht)")
+    pos = FILE_HEADER.size
+    out = []
+    while pos + RECORD.size <= len(data):
+        ms, peer, us, ln, size, direction = RECORD.unpack_from(data, pos)
+        payload = data[pos + RECORD.size:pos + RECORD.size + ln]
+        out.append({"ms": ms, "peer": peer, "us": us, "len": ln, "size": size,
+                    "dir": DIRS.get(direction, "?"), "type": msg_type(payload), "payload": payload})
+        pos += (RECORD.size + ln + 3) & ~3
+    return out
+
+
+def msg_type(payload):
+    key = b'"type":"'
+    i = payload.find(key)
+    if i < 0:
+        return "?"
+    j = payload.find(b'"', i + len(key))
+    return payload[i + len(key):j].decode(errors="replace") if j > 0 else "?"
+
+
+def pct(values, p):
+    if not values:
+        return 0
+    values = sorted(values)
+    return values[min(len(values) - 1, int(len(values) * p / 100))]
+
+
+def table(rows, header):
+    widths = [max(len(str(r[i])) for r in rows + [header]) for i in range(len(header))]
+    for r in [header] + rows:
+        print("  ".join(str(c).rjust(w) for c, w in zip(r, widths)))
+
+
+def cmd_fetch(args):
+    data = urllib.request.urlopen(args.url.rstrip("/") + "/trace", timeout=30).read()
+    with open(args.file, "wb") as f:
+        f.write(data)
+    print("%d Datensätze, %d B -> %s" % (len(parse(data)), len(data), args.file))
+
+
+def cmd_show(args):
+    recs = parse(open(args.file, "rb").read())
+    if not recs:
+        print("Leerer Mitschnitt")
+        return
+    if args.list:
+        for r in recs:
+            print("%10d %s %10d %-10s %5d B %6d us%s" % (r["ms"], r["dir"], r["peer"], r["type"], r["size"], r["us"],
+                                                       " (gekürzt)" if r["len"] < r["size"] else ""))
+    span = max(1, recs[-1]["ms"] - recs[0]["ms"]) / 1000.0
+    groups = defaultdict(list)
+    for r in recs:
+        groups[(r["dir"], r["type"])].append(r)
+    rows = []
+    for (d, t), rs in sorted(groups.items()):
+        us = [r["us"] for r in rs] if d == "RX" else []
+        rows.append([d, t, len(rs), "%.2f" % (len(rs) / span), sum(r["size"] for r in rs),
+                     pct(us, 50), pct(us, 95), max(us) if us else 0])
+    print("Mitschnitt über %.1f s, %d Datensätze" % (span, len(recs)))
+    table(rows, ["Dir", "Typ", "Anzahl", "/s", "Bytes", "p50 us", "p95 us", "max us"])
+
+
+def post_trace(url, data):
+    boundary = uuid.uuid4().hex
+    body = (("--%s\r\nContent-Disposition: form-data; name=\"trace\"; filename=\"trace.bin\"\r\n"
+             "Content-Type: application/octet-stream\r\n\r\n" % boundary).encode()
+            + data + ("\r\n--%s--\r\n" % boundary).encode())
+    req = urllib.request.Request(url, data=body, method="POST",
+                                 headers={"Content-Type": "multipart/form-data; boundary=" + boundary})
+    return urllib.request.urlopen(req, timeout=120).read().decode()
+
+
+def cmd_replay(args):
+    url = args.url.rstrip("/") + "/trace/replay"
+    data = open(args.file, "rb").read() if args.file else None
+    per_type = defaultdict(list)
+    flash = defaultdict(int)
+    blocks = defaultdict(int)
+    for run in range(args.runs):
+        # Die Datei muss jedes Mal neu geladen werden: der Puffer im Knoten ist derselbe
+        text = post_trace(url, data) if data else urllib.request.urlopen(url, timeout=120).read().decode()
+        for line in text.splitlines():
+            if line.startswith("#"):
+                print("Lauf %d: %s" % (run + 1, line[2:]))
+                continue
+            if line.startswith("idx"):
+                continue
+            idx, typ, peer, size, us, fl, bl = line.split(",")
+            per_type[typ].append(int(us))
+            flash[typ] += int(fl)
+            blocks[typ] += int(bl)
+    rows = [[t, len(v), pct(v, 50), pct(v, 95), pct(v, 99), max(v), flash[t], blocks[t]]
+            for t, v in sorted(per_type.items())]
+    if rows:
+        table(rows, ["Typ", "Anzahl", "p50 us", "p95 us", "p99 us", "max us", "Flash", "Blöcke"])
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = ap.add_subparsers(dest="cmd", required=True)
+    p = sub.add_parser("fetch")
+    p.add_argument("url")
+    p.add_argument("file")
+    p.set_defaults(func=cmd_fetch)
+    p = sub.add_parser("show")
+    p.add_argument("file")
+    p.add_argument("--list", action="store_true", help="alle Datensätze einzeln ausgeben")
+    p.set_defaults(func=cmd_show)
+    p = sub.add_parser("replay")
+    p.add_argument("url")
+    p.add_argument("file", nargs="?")
+    p.add_argument("--runs", type=int, default=1)
+    p.set_defaults(func=cmd_replay)
+    args = ap.parse_args()
+    args.func(args)
+
+
+if __name__ == "__main__":
+    main()